@@ -0,0 +1,486 @@
+// Headless benchmark of the map build pipeline. Prints one CSV row per map
+// and stage so results can be diffed between releases:
+//
+//   map,tiles,stage,seconds,peak_bytes,allocations
+//
+// Usage: MapBench [-n iterations] [tmx files...]
+//        MapBench -check
+// With no files, map.tmx, map2.tmx and generated 250x250, 500x500 and
+// 1000x1000 maps are measured. -check instead loads generated fixtures and
+// prints one pass/fail row per check, exiting non-zero if any fails.
+
+#include "tmx.h"
+#include "tile_map.h"
+#include "game.h"
+#include "application.h"
+#include "texture_manager.h"
+#include "sparse_graph.h"
+#include "cell_space_partition.h"
+#include "composite_collider.h"
+#include "graph_functions.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Every allocation carries a header holding its size so frees can be subtracted
+	const size_t HEADER_SIZE = 16;
+
+	std::atomic<size_t> gCurrentBytes(0);
+	std::atomic<size_t> gPeakBytes(0);
+	std::atomic<size_t> gAllocations(0);
+
+	void* allocate(size_t size)
+	{
+		char* pBlock = static_cast<char*>(std::malloc(size + HEADER_SIZE));
+		if (!pBlock) throw std::bad_alloc();
+		*reinterpret_cast<size_t*>(pBlock) = size;
+
+		++gAllocations;
+		size_t current = gCurrentBytes += size;
+		size_t peak = gPeakBytes;
+		while (current > peak && !gPeakBytes.compare_exchange_weak(peak, current)) {}
+
+		return pBlock + HEADER_SIZE;
+	}
+
+	void deallocate(void* p)
+	{
+		if (!p) return;
+		char* pBlock = static_cast<char*>(p) - HEADER_SIZE;
+		gCurrentBytes -= *reinterpret_cast<size_t*>(pBlock);
+		std::free(pBlock);
+	}
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void operator delete(void* p) noexcept { deallocate(p); }
+void operator delete[](void* p) noexcept { deallocate(p); }
+void operator delete(void* p, size_t) noexcept { deallocate(p); }
+void operator delete[](void* p, size_t) noexcept { deallocate(p); }
+
+namespace te
+{
+	typedef SparseGraph<NavGraphNode, NavGraphEdge> NavGraph;
+	typedef CellSpacePartition<const NavGraph::Node*> NavCellSpace;
+
+	struct Sample
+	{
+		double seconds;
+		size_t peakBytes;
+		size_t allocations;
+	};
+
+	class Stage
+	{
+	public:
+		Stage()
+			: mStart(std::chrono::steady_clock::now())
+			, mBaseBytes(gCurrentBytes)
+			, mBaseAllocations(gAllocations)
+		{
+			gPeakBytes = mBaseBytes;
+		}
+
+		Sample finish() const
+		{
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - mStart;
+			return Sample{ elapsed.count(), gPeakBytes - mBaseBytes, gAllocations - mBaseAllocations };
+		}
+
+	private:
+		std::chrono::steady_clock::time_point mStart;
+		size_t mBaseBytes;
+		size_t mBaseAllocations;
+	};
+
+	struct Result
+	{
+		std::string stage;
+		Sample best;
+	};
+
+	// The CSV rows of a map of walls and floor with a solid border
+	static std::string makeSyntheticCsv(int size)
+	{
+		std::string csv;
+		// Fixed seed so every run measures the same map
+		unsigned int seed = 12345;
+		for (int y = 0; y < size; ++y)
+		{
+			for (int x = 0; x < size; ++x)
+			{
+				seed = seed * 1103515245 + 12345;
+				bool border = x == 0 || y == 0 || x == size - 1 || y == size - 1;
+				bool wall = border || (seed >> 16) % 100 < 15;
+				csv += wall ? '2' : '1';
+				if (x < size - 1 || y < size - 1) csv += ',';
+			}
+			csv += '\n';
+		}
+		return csv;
+	}
+
+	// Two rooms joined by a corridor one tile long through the wall at x = size / 2
+	static std::string makeCorridorCsv(int size)
+	{
+		std::string csv;
+		for (int y = 0; y < size; ++y)
+		{
+			for (int x = 0; x < size; ++x)
+			{
+				bool border = x == 0 || y == 0 || x == size - 1 || y == size - 1;
+				bool wall = border || (x == size / 2 && y != size / 2);
+				csv += wall ? '2' : '1';
+				if (x < size - 1 || y < size - 1) csv += ',';
+			}
+			csv += '\n';
+		}
+		return csv;
+	}
+
+	static std::string makeCsvData(const std::string& csv)
+	{
+		return "  <data encoding=\"csv\">\n" + csv + "  </data>\n";
+	}
+
+	// data is the layer's whole <data> element
+	static void writeSyntheticMap(const std::string& filename, int size, const std::string& data)
+	{
+		std::ofstream out(filename, std::ios::trunc);
+		if (!out)
+		{
+			throw std::runtime_error("Unable to write " + filename + ".");
+		}
+
+		out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+		out << "<map version=\"1.0\" orientation=\"orthogonal\" renderorder=\"right-down\" width=\"" << size << "\" height=\"" << size << "\" tilewidth=\"16\" tileheight=\"16\">\n";
+		out << " <tileset firstgid=\"1\" name=\"synthetic\" tilewidth=\"16\" tileheight=\"16\" tilecount=\"2\">\n";
+		out << "  <image source=\"synthetic.png\" width=\"32\" height=\"16\"/>\n";
+		out << "  <tile id=\"1\">\n   <objectgroup draworder=\"index\">\n";
+		out << "    <object id=\"0\" x=\"0\" y=\"0\" width=\"16\" height=\"16\"/>\n";
+		out << "   </objectgroup>\n  </tile>\n </tileset>\n";
+		out << " <layer name=\"Ground\" width=\"" << size << "\" height=\"" << size << "\">\n";
+		out << data;
+		out << " </layer>\n";
+		out << " <objectgroup name=\"Entities\">\n";
+		out << "  <object id=\"1\" name=\"Player\" x=\"24\" y=\"24\" width=\"16\" height=\"16\"/>\n";
+		out << " </objectgroup>\n</map>\n";
+	}
+
+	struct Check
+	{
+		std::string name;
+		std::function<bool()> run;
+	};
+
+	// Loads a generated map with the given <data> element, then removes it
+	static std::unique_ptr<TMX> loadFixture(int size, const std::string& data)
+	{
+		const std::string filename = "fixture.tmx";
+		writeSyntheticMap(filename, size, data);
+		std::unique_ptr<TMX> pTMX;
+		try
+		{
+			pTMX = std::make_unique<TMX>(filename, 0);
+		}
+		catch (...)
+		{
+			std::remove(filename.c_str());
+			throw;
+		}
+		std::remove(filename.c_str());
+		return pTMX;
+	}
+
+	// Whether loading the fixture fails with exactly the given message
+	static bool isRejected(int size, const std::string& data, const std::string& message)
+	{
+		try
+		{
+			loadFixture(size, data);
+		}
+		catch (std::exception& ex)
+		{
+			return ex.what() == message;
+		}
+		return false;
+	}
+
+	static bool haveSameTiles(const TMX& a, const TMX& b)
+	{
+		if (a.getWidth() != b.getWidth() || a.getHeight() != b.getHeight() || a.getNumLayers() != b.getNumLayers()) return false;
+		for (int layer = 0; layer < a.getNumLayers(); ++layer)
+		{
+			for (int y = 0; y < a.getHeight(); ++y)
+			{
+				for (int x = 0; x < a.getWidth(); ++x)
+				{
+					if (a.getTile(layer, x, y) != b.getTile(layer, x, y)) return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// Runs the game's map code without opening a window
+	class CheckApplication : public Application
+	{
+	private:
+		std::unique_ptr<sf::RenderWindow> makeWindow() const { return nullptr; }
+		std::unique_ptr<Game> makeGame() { return nullptr; }
+	};
+
+	class CheckGame : public Game
+	{
+	public:
+		CheckGame(Application& app, const sf::Transform& pixelToWorldTransform)
+			: Game(app, pixelToWorldTransform)
+		{}
+
+		void processInput(const sf::Event&) {}
+
+		using Game::setTileMap;
+	};
+
+	static bool haveSameNavGraph(const NavGraph& a, const NavGraph& b)
+	{
+		if (a.numNodes() != b.numNodes()) return false;
+		std::vector<int> aEdges, bEdges;
+		for (int node = 0; node < a.numNodes(); ++node)
+		{
+			if (a.isPresent(node) != b.isPresent(node)) return false;
+			if (!a.isPresent(node)) continue;
+
+			aEdges.clear();
+			bEdges.clear();
+			a.forEachEdge(node, [&aEdges](int to, double) { aEdges.push_back(to); });
+			b.forEachEdge(node, [&bEdges](int to, double) { bEdges.push_back(to); });
+			std::sort(aEdges.begin(), aEdges.end());
+			std::sort(bEdges.begin(), bEdges.end());
+			if (aEdges != bEdges) return false;
+		}
+		return true;
+	}
+
+	// Blocks the tile of a corridor through TileMap::setTile and compares the
+	// patched nav graph with one built from scratch for the same tiles
+	static bool checkCorridorBlocked()
+	{
+		const int size = 9;
+		const sf::Transform transform = sf::Transform().scale(1.f / 16, 1.f / 16);
+		const std::string data = makeCsvData(makeCorridorCsv(size));
+		std::shared_ptr<TMX> pTMX = loadFixture(size, data);
+		std::unique_ptr<TMX> pFresh = loadFixture(size, data);
+
+		CheckApplication app;
+		sf::Image image;
+		image.create(32, 16);
+		app.getTextureManager().load("synthetic.png", image);
+
+		CheckGame game(app, transform);
+		auto pTileMap = std::make_unique<TileMap>(game, app.getTextureManager(), pTMX);
+		TileMap& map = *pTileMap;
+		game.setTileMap(std::move(pTileMap));
+
+		map.setTile(0, size / 2, size / 2, 2);
+		pFresh->setTile(0, size / 2, size / 2, 2);
+		pFresh->compile();
+		std::unique_ptr<NavGraph> pNavGraph(pFresh->makeNavGraph(transform));
+		return haveSameNavGraph(map.getNavGraph(), *pNavGraph);
+	}
+
+	static std::vector<Check> makeChecks()
+	{
+		const int size = 64;
+		const std::string csv = makeSyntheticCsv(size);
+
+		std::vector<Check> checks;
+		checks.push_back({ "cdata_layer", [=]() {
+			auto pPlain = loadFixture(size, makeCsvData(csv));
+			auto pCData = loadFixture(size, makeCsvData("<![CDATA[" + csv + "]]>"));
+			return haveSameTiles(*pPlain, *pCData);
+		} });
+		checks.push_back({ "csv_gid_overflow", [=]() {
+			return isRejected(size, makeCsvData("99999999999999999999" + csv.substr(1)), "Malformed CSV layer data.");
+		} });
+		checks.push_back({ "xml_gid_overflow", [=]() {
+			std::string data = "  <data>\n   <tile gid=\"99999999999999999999\"/>\n";
+			for (int i = 1; i < size * size; ++i) data += "   <tile gid=\"1\"/>\n";
+			return isRejected(size, data + "  </data>\n", "Malformed number in attribute 'gid' on <tile>.");
+		} });
+		checks.push_back({ "nav_corridor_blocked", checkCorridorBlocked });
+		return checks;
+	}
+
+	// Returns the number of checks that failed
+	static int runChecks()
+	{
+		int numFailed = 0;
+		std::printf("check,result\n");
+		for (auto& check : makeChecks())
+		{
+			bool passed = false;
+			try
+			{
+				passed = check.run();
+			}
+			catch (std::exception& ex)
+			{
+				std::fprintf(stderr, "%s: %s\n", check.name.c_str(), ex.what());
+			}
+			std::printf("%s,%s\n", check.name.c_str(), passed ? "pass" : "fail");
+			if (!passed) ++numFailed;
+		}
+		return numFailed;
+	}
+
+	static std::vector<Result> benchmarkMap(const std::string& filename, int iterations, int& numTiles)
+	{
+		std::vector<Result> results;
+		auto record = [&results](const std::string& stage, const Sample& sample) {
+			auto iter = std::find_if(results.begin(), results.end(), [&stage](const Result& result) { return result.stage == stage; });
+			if (iter == results.end())
+			{
+				results.push_back({ stage, sample });
+			}
+			else if (sample.seconds < iter->best.seconds)
+			{
+				iter->best = sample;
+			}
+		};
+
+		for (int i = 0; i < iterations; ++i)
+		{
+			std::unique_ptr<TMX> pTMX;
+			{
+				Stage stage;
+				pTMX = std::make_unique<TMX>(filename, 0);
+				record("TMX::TMX", stage.finish());
+			}
+			TMX& tmx = *pTMX;
+			numTiles = tmx.getWidth() * tmx.getHeight();
+
+			{
+				Stage stage;
+				tmx.compile();
+				record("TMX::compile", stage.finish());
+			}
+
+			{
+				std::vector<std::vector<sf::VertexArray>> layers;
+				Stage stage;
+				tmx.makeVertices({ 0, 0, tmx.getWidth(), tmx.getHeight() }, layers);
+				record("TMX::makeVertices", stage.finish());
+			}
+
+			const sf::Transform transform = sf::Transform().scale(1.f / 16, 1.f / 16);
+
+			{
+				Stage stage;
+				std::unique_ptr<CompositeCollider> pCollider(tmx.makeCollider(transform));
+				record("TMX::makeCollider", stage.finish());
+			}
+
+			std::unique_ptr<NavGraph> pNavGraph;
+			{
+				Stage stage;
+				pNavGraph = std::unique_ptr<NavGraph>(tmx.makeNavGraph(transform));
+				record("TMX::makeNavGraph", stage.finish());
+			}
+
+			{
+				Stage stage;
+				volatile float length = calculateAverageGraphEdgeLength(*pNavGraph);
+				(void)length;
+				record("calculateAverageGraphEdgeLength", stage.finish());
+			}
+
+			{
+				Stage stage;
+				sf::FloatRect bounds = transform.transformRect({ 0, 0, (float)tmx.getTileWidth() * tmx.getWidth(), (float)tmx.getTileHeight() * tmx.getHeight() });
+				NavCellSpace cellSpace(bounds.left + bounds.width, bounds.top + bounds.height, std::max(tmx.getWidth() / 4, 1), std::max(tmx.getHeight() / 4, 1), pNavGraph->numNodes());
+				NavGraph::ConstNodeIterator nodeIter(*pNavGraph);
+				for (const NavGraph::Node* pNode = nodeIter.begin(); !nodeIter.end(); pNode = nodeIter.next())
+				{
+					cellSpace.addEntity(pNode);
+				}
+				record("CellSpacePartition", stage.finish());
+			}
+		}
+
+		return results;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		int iterations = 3;
+		std::vector<std::string> files;
+		for (int i = 1; i < argc; ++i)
+		{
+			if (std::string(argv[i]) == "-check")
+			{
+				return te::runChecks() == 0 ? 0 : 1;
+			}
+			if (std::string(argv[i]) == "-n" && i + 1 < argc)
+			{
+				iterations = std::max(std::atoi(argv[++i]), 1);
+			}
+			else
+			{
+				files.push_back(argv[i]);
+			}
+		}
+
+		std::vector<std::string> generated;
+		if (files.empty())
+		{
+			files = { "map.tmx", "map2.tmx" };
+			for (int size : { 250, 500, 1000 })
+			{
+				std::string filename = "synthetic_" + std::to_string(size) + ".tmx";
+				te::writeSyntheticMap(filename, size, te::makeCsvData(te::makeSyntheticCsv(size)));
+				files.push_back(filename);
+				generated.push_back(filename);
+			}
+		}
+
+		std::printf("map,tiles,stage,seconds,peak_bytes,allocations\n");
+		for (auto& file : files)
+		{
+			int numTiles = 0;
+			auto results = te::benchmarkMap(file, iterations, numTiles);
+			for (auto& result : results)
+			{
+				std::printf("%s,%d,%s,%.6f,%zu,%zu\n", file.c_str(), numTiles, result.stage.c_str(), result.best.seconds, result.best.peakBytes, result.best.allocations);
+			}
+			std::fflush(stdout);
+		}
+
+		for (auto& file : generated)
+		{
+			std::remove(file.c_str());
+		}
+	}
+	catch (std::exception& ex)
+	{
+		std::cerr << ex.what() << std::endl;
+		return 1;
+	}
+}
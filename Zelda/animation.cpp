@@ -1,5 +1,6 @@
 #include "animation.h"
 #include "texture_manager.h"
+#include "xml_parse.h"
 
 #include <rapidxml.hpp>
 #include <rapidxml_utils.hpp>
@@ -11,20 +12,20 @@ namespace te
 		rapidxml::file<> animFile(filename.c_str());
 		rapidxml::xml_document<> animXML;
 		animXML.parse<0>(animFile.data());
-		rapidxml::xml_node<char>* pListNode = animXML.first_node("animations");
+		const XmlNode& listNode = getXmlChild(animXML, "animations");
 
 		std::vector<Animation> animations;
-		for (auto pAnimNode = pListNode->first_node("animation"); pAnimNode != 0; pAnimNode = pAnimNode->next_sibling("animation"))
+		for (const XmlNode* pAnimNode = listNode.first_node("animation"); pAnimNode != 0; pAnimNode = pAnimNode->next_sibling("animation"))
 		{
-			TextureID name = TextureManager::getID(pAnimNode->first_attribute("name")->value());
-			int mpc = std::stoi(pAnimNode->first_attribute("millisecondsPerClip")->value());
+			TextureID name = TextureManager::getID(getXmlString(*pAnimNode, "name"));
+			int mpc = getXmlInt(*pAnimNode, "millisecondsPerClip");
 
 			std::vector<Clip> clips;
-			for (auto pClipNode = pAnimNode->first_node("clip"); pClipNode != 0; pClipNode = pClipNode->next_sibling("clip"))
+			for (const XmlNode* pClipNode = pAnimNode->first_node("clip"); pClipNode != 0; pClipNode = pClipNode->next_sibling("clip"))
 			{
 				//std::string textureStr = dir + pClipNode->first_attribute("texture")->value();
 				//textureManager.load(textureStr);
-				TextureID id = TextureManager::getID(pClipNode->first_attribute("sprite")->value());
+				TextureID id = TextureManager::getID(getXmlString(*pClipNode, "sprite"));
 				clips.push_back({
 					//TextureManager::getID(textureStr),
 					id,
@@ -68,6 +68,32 @@ namespace te
 	}
 	void Application::render(sf::RenderTarget& target, Game& game)
 	{
-		target.draw(game);
+		if (game.isLoading())
+		{
+			renderLoadingScreen(target, game.getLoadingProgress());
+		}
+		else
+		{
+			target.draw(game);
+		}
+	}
+	void Application::renderLoadingScreen(sf::RenderTarget& target, float progress)
+	{
+		target.setView(target.getDefaultView());
+		sf::Vector2f size = target.getView().getSize();
+
+		sf::Vector2f barSize(size.x * 0.5f, 8.f);
+		sf::RectangleShape frame(barSize);
+		frame.setPosition((size - barSize) * 0.5f);
+		frame.setFillColor(sf::Color::Transparent);
+		frame.setOutlineColor(sf::Color::White);
+		frame.setOutlineThickness(1.f);
+
+		sf::RectangleShape bar(sf::Vector2f(barSize.x * progress, barSize.y));
+		bar.setPosition(frame.getPosition());
+		bar.setFillColor(sf::Color::White);
+
+		target.draw(frame);
+		target.draw(bar);
 	}
 }
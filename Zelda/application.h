@@ -35,6 +35,7 @@ namespace te
 		virtual void processInput(const sf::Event& evt, Game& game);
 		virtual void update(const sf::Time& dt, Game& game);
 		virtual void render(sf::RenderTarget& target, Game& game);
+		virtual void renderLoadingScreen(sf::RenderTarget& target, float progress);
 
 		std::unique_ptr<TextureManager> mpTextureManager;
 		std::unique_ptr<Game> mpGame;
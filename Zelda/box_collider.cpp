@@ -3,27 +3,20 @@
 
 #include "wall.h"
 
+#include <algorithm>
 #include <array>
 
 namespace te
 {
+	// The distance below which b2TestOverlap reports two padded polygons as overlapping
+	const float BoxCollider::OVERLAP_DISTANCE = 2 * b2_polygonRadius + 10 * b2_epsilon;
+
 	BoxCollider::BoxCollider(const sf::FloatRect& rect)
 		: mRect(rect)
-		, mShape()
 		, mWalls()
 	{
-		const b2Vec2 points[4]{
-			b2Vec2{rect.left, rect.top},
-			b2Vec2{rect.left + rect.width, rect.top},
-			b2Vec2{rect.left + rect.width, rect.top + rect.height},
-			b2Vec2{rect.left, rect.top + rect.height}
-		};
-		mShape.Set(points, 4);
-
-		mWalls.push_back(Wall2f({ rect.left, rect.top }, { rect.left, rect.top + rect.height }));
-		mWalls.push_back(Wall2f({ rect.left, rect.top + rect.height }, { rect.left + rect.width, rect.top + rect.height }));
-		mWalls.push_back(Wall2f({ rect.left + rect.width, rect.top + rect.height }, { rect.left + rect.width, rect.top }));
-		mWalls.push_back(Wall2f({ rect.left + rect.width, rect.top }, { rect.left, rect.top }));
+		const std::array<Wall2f, 4> walls = makeWalls(rect);
+		mWalls.assign(walls.begin(), walls.end());
 	}
 
 	const std::vector<Wall2f>& BoxCollider::getWalls() const
@@ -33,16 +26,12 @@ namespace te
 
 	bool BoxCollider::contains(float x, float y) const
 	{
-		b2Transform transform;
-		transform.SetIdentity();
-		return mShape.TestPoint(transform, b2Vec2(x, y));
+		return x >= mRect.left && x <= mRect.left + mRect.width && y >= mRect.top && y <= mRect.top + mRect.height;
 	}
 
 	bool BoxCollider::intersects(const BoxCollider& o) const
 	{
-		b2Transform transform;
-		transform.SetIdentity();
-		return b2TestOverlap(&mShape, 0, &o.mShape, 0, transform, transform);
+		return overlaps(mRect, o.mRect);
 	}
 
 	bool BoxCollider::intersects(const BoxCollider& o, sf::FloatRect& collision) const
@@ -72,7 +61,38 @@ namespace te
 
 	b2Fixture* BoxCollider::createFixture(b2Body& body, float density) const
 	{
-		return body.CreateFixture(&mShape, density);
+		const b2PolygonShape shape = makeShape(mRect);
+		return body.CreateFixture(&shape, density);
+	}
+
+	bool BoxCollider::overlaps(const sf::FloatRect& a, const sf::FloatRect& b)
+	{
+		const float gapX = std::max({ b.left - (a.left + a.width), a.left - (b.left + b.width), 0.f });
+		const float gapY = std::max({ b.top - (a.top + a.height), a.top - (b.top + b.height), 0.f });
+		return gapX * gapX + gapY * gapY < OVERLAP_DISTANCE * OVERLAP_DISTANCE;
+	}
+
+	b2PolygonShape BoxCollider::makeShape(const sf::FloatRect& rect)
+	{
+		const b2Vec2 points[4]{
+			b2Vec2{rect.left, rect.top},
+			b2Vec2{rect.left + rect.width, rect.top},
+			b2Vec2{rect.left + rect.width, rect.top + rect.height},
+			b2Vec2{rect.left, rect.top + rect.height}
+		};
+		b2PolygonShape shape;
+		shape.Set(points, 4);
+		return shape;
+	}
+
+	std::array<Wall2f, 4> BoxCollider::makeWalls(const sf::FloatRect& rect)
+	{
+		return { {
+			Wall2f({ rect.left, rect.top }, { rect.left, rect.top + rect.height }),
+			Wall2f({ rect.left, rect.top + rect.height }, { rect.left + rect.width, rect.top + rect.height }),
+			Wall2f({ rect.left + rect.width, rect.top + rect.height }, { rect.left + rect.width, rect.top }),
+			Wall2f({ rect.left + rect.width, rect.top }, { rect.left, rect.top })
+		} };
 	}
 
 	void BoxCollider::draw(sf::RenderTarget& target, sf::RenderStates states) const
@@ -5,6 +5,9 @@
 #include "wall.h"
 #include <Box2D/Box2D.h>
 
+#include <array>
+#include <vector>
+
 namespace te
 {
 	class BoxCollider : public Collider
@@ -25,11 +28,17 @@ namespace te
 		sf::FloatRect getRect() const;
 
 		b2Fixture* createFixture(b2Body& body, float density = 0) const;
+
+		// Box2D's overlap test for the boxes' polygons, which are padded by
+		// b2_polygonRadius, so boxes closer than OVERLAP_DISTANCE still overlap
+		static const float OVERLAP_DISTANCE;
+		static bool overlaps(const sf::FloatRect& a, const sf::FloatRect& b);
+		static b2PolygonShape makeShape(const sf::FloatRect& rect);
+		static std::array<Wall2f, 4> makeWalls(const sf::FloatRect& rect);
 	private:
 		virtual void draw(sf::RenderTarget&, sf::RenderStates) const;
 
 		sf::FloatRect mRect;
-		b2PolygonShape mShape;
 		std::vector<Wall2f> mWalls;
 	};
 }
@@ -1,6 +1,8 @@
 #ifndef TE_CELL_SPACE_PARTITION_H
 #define TE_CELL_SPACE_PARTITION_H
 
+#include "vector_ops.h"
+
 #include <SFML/Graphics.hpp>
 
 #include <list>
@@ -24,7 +26,7 @@ namespace te
 	public:
 		CellSpacePartition(float width, float height, int cellsX, int cellsY, int maxEntities)
 			: mCells()
-			, mNeighbors(maxEntities, Entity())
+			, mNeighbors(maxEntities + 1, Entity())
 			, mCurrNeighbor(mNeighbors.begin())
 			, mSpaceWidth(width)
 			, mSpaceHeight(height)
@@ -49,6 +51,12 @@ namespace te
 			mCells[index].members.push_back(entity);
 		}
 
+		inline void removeEntity(const Entity& entity)
+		{
+			int index = positionToIndex(entity->getPosition());
+			mCells[index].members.remove(entity);
+		}
+
 		inline void updateEntity(const Entity& entity, sf::Vector2f oldPosition)
 		{}
 
@@ -80,15 +88,24 @@ namespace te
 			typename std::vector<Entity>::iterator currNeighbor = mNeighbors.begin();
 			sf::FloatRect queryBox{ targetPos.x - queryRadius, targetPos.y - queryRadius, 2 * queryRadius, 2 * queryRadius };
 
-			for (auto& cell : mCells)
+			// Only visit the cells the query box overlaps
+			int left = cellX(queryBox.left);
+			int right = cellX(queryBox.left + queryBox.width);
+			int top = cellY(queryBox.top);
+			int bottom = cellY(queryBox.top + queryBox.height);
+			for (int y = top; y <= bottom; ++y)
 			{
-				if (cell.boundingBox.intersects(queryBox) && !cell.members.empty())
+				for (int x = left; x <= right; ++x)
 				{
-					for (auto& member : cell.members)
+					auto& cell = mCells[y * mNumCellsX + x];
+					if (cell.boundingBox.intersects(queryBox) && !cell.members.empty())
 					{
-						if (distanceSq(member->getPosition(), targetPos) < queryRadius * queryRadius)
+						for (auto& member : cell.members)
 						{
-							*currNeighbor++ = member;
+							if (distanceSq(member->getPosition(), targetPos) < queryRadius * queryRadius)
+							{
+								*currNeighbor++ = member;
+							}
 						}
 					}
 				}
@@ -98,15 +115,21 @@ namespace te
 		}
 
 	private:
+		inline int cellX(float x) const
+		{
+			int cell = (int)(mNumCellsX * x / mSpaceWidth);
+			return cell < 0 ? 0 : (cell >= mNumCellsX ? mNumCellsX - 1 : cell);
+		}
+
+		inline int cellY(float y) const
+		{
+			int cell = (int)(mNumCellsY * y / mSpaceHeight);
+			return cell < 0 ? 0 : (cell >= mNumCellsY ? mNumCellsY - 1 : cell);
+		}
+
 		inline int positionToIndex(const sf::Vector2f& position) const
 		{
-			int index = (int)(mNumCellsX * position.x / mSpaceWidth) +
-				((int)(mNumCellsY * position.y / mSpaceHeight) * mNumCellsX);
-			if (index > (int)mCells.size() - 1)
-			{
-				index = (int)mCells.size() - 1;
-			}
-			return index;
+			return cellX(position.x) + cellY(position.y) * mNumCellsX;
 		}
 
 		std::vector<Cell<Entity>> mCells;
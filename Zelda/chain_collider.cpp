@@ -0,0 +1,200 @@
+#include "chain_collider.h"
+#include "box_collider.h"
+#include "composite_collider.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace te
+{
+	// Clips the segment to the rectangle, false when they do not meet
+	static bool clipSegment(sf::Vector2f& a, sf::Vector2f& b, const sf::FloatRect& rect)
+	{
+		const sf::Vector2f d = b - a;
+		const float p[4] = { -d.x, d.x, -d.y, d.y };
+		const float q[4] = { a.x - rect.left, rect.left + rect.width - a.x, a.y - rect.top, rect.top + rect.height - a.y };
+		float t0 = 0, t1 = 1;
+		for (int i = 0; i < 4; ++i)
+		{
+			if (p[i] == 0)
+			{
+				if (q[i] < 0) return false;
+			}
+			else if (p[i] < 0)
+			{
+				t0 = std::max(t0, q[i] / p[i]);
+			}
+			else
+			{
+				t1 = std::min(t1, q[i] / p[i]);
+			}
+		}
+		if (t0 > t1) return false;
+		b = a + d * t1;
+		a = a + d * t0;
+		return true;
+	}
+
+	ChainCollider::ChainCollider(const std::vector<sf::Vector2f>& points, bool loop)
+		: mPoints(points)
+		, mbLoop(loop)
+		, mBounds()
+		, mWalls()
+	{
+		if (mPoints.size() < (mbLoop ? 3u : 2u)) throw std::runtime_error("Too few points for ChainCollider.");
+
+		auto xs = std::minmax_element(mPoints.begin(), mPoints.end(), [](const sf::Vector2f& a, const sf::Vector2f& b) { return a.x < b.x; });
+		auto ys = std::minmax_element(mPoints.begin(), mPoints.end(), [](const sf::Vector2f& a, const sf::Vector2f& b) { return a.y < b.y; });
+		mBounds = { xs.first->x, ys.first->y, xs.second->x - xs.first->x, ys.second->y - ys.first->y };
+
+		const size_t numEdges = mbLoop ? mPoints.size() : mPoints.size() - 1;
+		mWalls.reserve(numEdges);
+		for (size_t i = 0; i < numEdges; ++i)
+		{
+			mWalls.push_back(Wall2f(mPoints[i], mPoints[(i + 1) % mPoints.size()]));
+		}
+	}
+
+	const std::vector<Wall2f>& ChainCollider::getWalls() const
+	{
+		return mWalls;
+	}
+
+	bool ChainCollider::contains(float x, float y) const
+	{
+		if (!mbLoop || !mBounds.contains(x, y)) return false;
+
+		bool inside = false;
+		for (size_t i = 0, j = mPoints.size() - 1; i < mPoints.size(); j = i++)
+		{
+			const sf::Vector2f& a = mPoints[i];
+			const sf::Vector2f& b = mPoints[j];
+			if ((a.y > y) != (b.y > y) && x < a.x + (y - a.y) / (b.y - a.y) * (b.x - a.x))
+			{
+				inside = !inside;
+			}
+		}
+		return inside;
+	}
+
+	bool ChainCollider::intersects(const BoxCollider& o) const
+	{
+		sf::FloatRect collision;
+		return intersects(o, collision);
+	}
+
+	bool ChainCollider::intersects(const BoxCollider& o, sf::FloatRect& collision) const
+	{
+		return intersects(o.getRect(), collision);
+	}
+
+	bool ChainCollider::intersects(const sf::FloatRect& rect, sf::FloatRect& collision) const
+	{
+		if (mBounds.left > rect.left + rect.width || mBounds.left + mBounds.width < rect.left ||
+			mBounds.top > rect.top + rect.height || mBounds.top + mBounds.height < rect.top)
+		{
+			return false;
+		}
+
+		// The collision is the bounds of the parts of the edges inside the box
+		bool result = false;
+		sf::Vector2f min, max;
+		for (auto& wall : mWalls)
+		{
+			sf::Vector2f a = wall.getFrom(), b = wall.getTo();
+			if (!clipSegment(a, b, rect)) continue;
+			if (!result)
+			{
+				min = max = a;
+				result = true;
+			}
+			min = { std::min({ min.x, a.x, b.x }), std::min({ min.y, a.y, b.y }) };
+			max = { std::max({ max.x, a.x, b.x }), std::max({ max.y, a.y, b.y }) };
+		}
+
+		if (result)
+		{
+			collision = { min.x, min.y, max.x - min.x, max.y - min.y };
+			return true;
+		}
+		if (contains(rect.left + rect.width / 2, rect.top + rect.height / 2))
+		{
+			collision = rect;
+			return true;
+		}
+		return false;
+	}
+
+	bool ChainCollider::intersects(const CompositeCollider& o) const
+	{
+		return o.intersects(*this);
+	}
+
+	bool ChainCollider::intersects(const CompositeCollider& o, sf::FloatRect& collision) const
+	{
+		return o.intersects(*this, collision);
+	}
+
+	ChainCollider ChainCollider::transform(const sf::Transform& t) const
+	{
+		std::vector<sf::Vector2f> points(mPoints.size());
+		std::transform(mPoints.begin(), mPoints.end(), points.begin(), [&t](const sf::Vector2f& point) {
+			return t.transformPoint(point);
+		});
+		return { points, mbLoop };
+	}
+
+	const std::vector<sf::Vector2f>& ChainCollider::getPoints() const
+	{
+		return mPoints;
+	}
+
+	bool ChainCollider::isLoop() const
+	{
+		return mbLoop;
+	}
+
+	sf::FloatRect ChainCollider::getBounds() const
+	{
+		return mBounds;
+	}
+
+	b2Fixture* ChainCollider::createFixture(b2Body& body, float density) const
+	{
+		std::vector<b2Vec2> vertices;
+		vertices.reserve(mPoints.size());
+		for (auto& point : mPoints)
+		{
+			vertices.push_back(b2Vec2(point.x, point.y));
+		}
+
+		if (!mbLoop && vertices.size() == 2)
+		{
+			b2EdgeShape edge;
+			edge.Set(vertices[0], vertices[1]);
+			return body.CreateFixture(&edge, density);
+		}
+
+		b2ChainShape chain;
+		if (mbLoop)
+			chain.CreateLoop(vertices.data(), (int32)vertices.size());
+		else
+			chain.CreateChain(vertices.data(), (int32)vertices.size());
+		return body.CreateFixture(&chain, density);
+	}
+
+	void ChainCollider::draw(sf::RenderTarget& target, sf::RenderStates states) const
+	{
+		sf::VertexArray lines(sf::LinesStrip);
+		const sf::Color color(255, 0, 0, 200);
+		for (auto& point : mPoints)
+		{
+			lines.append(sf::Vertex(point, color));
+		}
+		if (mbLoop)
+		{
+			lines.append(sf::Vertex(mPoints.front(), color));
+		}
+		target.draw(lines, states);
+	}
+}
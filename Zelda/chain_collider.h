@@ -0,0 +1,46 @@
+#ifndef TE_CHAIN_COLLIDER_H
+#define TE_CHAIN_COLLIDER_H
+
+#include "collider.h"
+#include "wall.h"
+#include <Box2D/Box2D.h>
+
+#include <vector>
+
+namespace te
+{
+	// A run of connected edges; a loop joins the last point back to the first
+	// and encloses the area inside it
+	class ChainCollider : public Collider
+	{
+	public:
+		ChainCollider(const std::vector<sf::Vector2f>& points, bool loop);
+
+		const std::vector<Wall2f>& getWalls() const;
+
+		bool contains(float x, float y) const;
+
+		bool intersects(const BoxCollider&) const;
+		bool intersects(const BoxCollider&, sf::FloatRect& collision) const;
+		bool intersects(const CompositeCollider&) const;
+		bool intersects(const CompositeCollider&, sf::FloatRect& collision) const;
+		bool intersects(const sf::FloatRect& box, sf::FloatRect& collision) const;
+
+		ChainCollider transform(const sf::Transform&) const;
+		const std::vector<sf::Vector2f>& getPoints() const;
+		bool isLoop() const;
+		sf::FloatRect getBounds() const;
+
+		// Two point chains become an edge shape
+		b2Fixture* createFixture(b2Body& body, float density = 0) const;
+	private:
+		virtual void draw(sf::RenderTarget&, sf::RenderStates) const;
+
+		std::vector<sf::Vector2f> mPoints;
+		bool mbLoop;
+		sf::FloatRect mBounds;
+		std::vector<Wall2f> mWalls;
+	};
+}
+
+#endif
@@ -3,11 +3,8 @@
 
 #include <SFML/Graphics.hpp>
 
-#include <vector>
-
 namespace te
 {
-	class Wall2f;
 	class BoxCollider;
 	class CompositeCollider;
 
@@ -25,8 +22,6 @@ namespace te
 	{
 	public:
 		virtual ~Collider();
-
-		virtual const std::vector<Wall2f>& getWalls() const = 0;
 	};
 }
 
@@ -1,119 +1,540 @@
 #include "composite_collider.h"
+#include "simd.h"
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
 
 namespace te
 {
+	// The largest collision offered, the lowest index winning ties, which is
+	// what a scan in index order keeps
+	struct LargestCollision
+	{
+		sf::FloatRect rect = { 0, 0, 0, 0 };
+		int index = -1;
+
+		// An empty collision only counts when nothing has been kept, and not
+		// at all unless acceptEmpty
+		void offer(const sf::FloatRect& collision, int collisionIndex, bool acceptEmpty)
+		{
+			const float area = collision.width * collision.height;
+			const float bestArea = rect.width * rect.height;
+			if ((index < 0 && acceptEmpty) || area > bestArea || (area == bestArea && index >= 0 && collisionIndex < index))
+			{
+				rect = collision;
+				index = collisionIndex;
+			}
+		}
+	};
+
+	// A scan of the boxes then the chains: boxes must beat an empty collision,
+	// chains must beat the boxes' best, and the first chain is kept when no box hit
+	static sf::FloatRect pickCollision(bool boxHit, const LargestCollision& boxes, bool chainHit, const LargestCollision& chains)
+	{
+		if (!boxHit) return chains.rect;
+		if (chainHit && chains.rect.width * chains.rect.height > boxes.rect.width * boxes.rect.height) return chains.rect;
+		return boxes.rect;
+	}
+
+	static b2AABB toAABB(const sf::FloatRect& rect)
+	{
+		b2AABB aabb;
+		aabb.lowerBound.Set(rect.left, rect.top);
+		aabb.upperBound.Set(rect.left + rect.width, rect.top + rect.height);
+		return aabb;
+	}
+
+	// The rect's bounds as sf::Rect::intersects takes them, for rects of negative size too
+	static void getBounds(const sf::FloatRect& rect, float& minX, float& minY, float& maxX, float& maxY)
+	{
+		minX = std::min(rect.left, rect.left + rect.width);
+		maxX = std::max(rect.left, rect.left + rect.width);
+		minY = std::min(rect.top, rect.top + rect.height);
+		maxY = std::max(rect.top, rect.top + rect.height);
+	}
+
+	void CompositeCollider::addBox(const sf::FloatRect& rect)
+	{
+		mpTree.reset();
+		float minX, minY, maxX, maxY;
+		getBounds(rect, minX, minY, maxX, maxY);
+		mBoxMinX.push_back(minX);
+		mBoxMinY.push_back(minY);
+		mBoxMaxX.push_back(maxX);
+		mBoxMaxY.push_back(maxY);
+	}
+
 	void CompositeCollider::addCollider(const BoxCollider& collider)
 	{
-		mBoxColliders.push_back(collider);
-		std::vector<Wall2f> walls = collider.getWalls();
-		mWalls.insert(mWalls.end(), walls.begin(), walls.end());
+		addBox(collider.getRect());
 	}
 
-	const std::vector<Wall2f>& CompositeCollider::getWalls() const
+	void CompositeCollider::addCollider(const ChainCollider& collider)
 	{
-		return mWalls;
+		mpTree.reset();
+		mChainColliders.push_back(collider);
 	}
 
-	//std::vector<Wall2f> CompositeCollider::getWalls() const
-	//{
-	//	std::vector<Wall2f> walls;
-	//	std::for_each(mBoxColliders.begin(), mBoxColliders.end(), [&walls](const BoxCollider& collider) {
-	//		std::vector<Wall2f> currWalls = collider.getWalls();
-	//		walls.insert(walls.end(), currWalls.begin(), currWalls.end());
-	//	});
-	//	return walls;
-	//}
+	void CompositeCollider::addColliders(const CompositeCollider& collider)
+	{
+		mpTree.reset();
+		mBoxMinX.insert(mBoxMinX.end(), collider.mBoxMinX.begin(), collider.mBoxMinX.end());
+		mBoxMinY.insert(mBoxMinY.end(), collider.mBoxMinY.begin(), collider.mBoxMinY.end());
+		mBoxMaxX.insert(mBoxMaxX.end(), collider.mBoxMaxX.begin(), collider.mBoxMaxX.end());
+		mBoxMaxY.insert(mBoxMaxY.end(), collider.mBoxMaxY.begin(), collider.mBoxMaxY.end());
+		mChainColliders.insert(mChainColliders.end(), collider.mChainColliders.begin(), collider.mChainColliders.end());
+	}
 
-	bool CompositeCollider::contains(float x, float y) const
+	void CompositeCollider::removeCollider(int index)
 	{
-		for (auto it = mBoxColliders.begin(); it != mBoxColliders.end(); ++it)
+		mpTree.reset();
+		for (auto pBounds : { &mBoxMinX, &mBoxMinY, &mBoxMaxX, &mBoxMaxY })
 		{
-			if (it->contains(x, y)) return true;
+			(*pBounds)[index] = pBounds->back();
+			pBounds->pop_back();
 		}
-		return false;
 	}
 
-	bool CompositeCollider::intersects(const BoxCollider& o) const
+	void CompositeCollider::removeChainColliders()
 	{
-		for (auto& boxCollider : mBoxColliders)
-			if (boxCollider.intersects(o)) return true;
-		return false;
+		mpTree.reset();
+		mChainColliders.clear();
 	}
 
-	bool CompositeCollider::intersects(const BoxCollider& o, sf::FloatRect& collision) const
+	int CompositeCollider::getNumColliders() const
 	{
-		bool result = false;
+		return mBoxMinX.size();
+	}
 
-		sf::FloatRect currBest = { 0, 0, 0, 0 };
-		sf::FloatRect currCollision;
-		for (auto& boxCollider : mBoxColliders)
+	sf::FloatRect CompositeCollider::getBox(int index) const
+	{
+		return { mBoxMinX[index], mBoxMinY[index], mBoxMaxX[index] - mBoxMinX[index], mBoxMaxY[index] - mBoxMinY[index] };
+	}
+
+	std::array<Wall2f, 4> CompositeCollider::getBoxWalls(int index) const
+	{
+		return BoxCollider::makeWalls(getBox(index));
+	}
+
+	int CompositeCollider::getNumChainColliders() const
+	{
+		return mChainColliders.size();
+	}
+
+	const ChainCollider& CompositeCollider::getChainCollider(int index) const
+	{
+		return mChainColliders[index];
+	}
+
+	void CompositeCollider::clear()
+	{
+		mpTree.reset();
+		mBoxMinX.clear();
+		mBoxMinY.clear();
+		mBoxMaxX.clear();
+		mBoxMaxY.clear();
+		mChainColliders.clear();
+	}
+
+	std::vector<Wall2f> CompositeCollider::getWalls() const
+	{
+		std::vector<Wall2f> walls;
+		walls.reserve(mBoxMinX.size() * 4);
+		for (int i = 0; i < getNumColliders(); ++i)
 		{
-			if (boxCollider.intersects(o, currCollision))
+			const std::array<Wall2f, 4> boxWalls = getBoxWalls(i);
+			walls.insert(walls.end(), boxWalls.begin(), boxWalls.end());
+		}
+		for (auto& collider : mChainColliders)
+		{
+			walls.insert(walls.end(), collider.getWalls().begin(), collider.getWalls().end());
+		}
+		return walls;
+	}
+
+#ifdef TE_SSE
+	// Bounds of four boxes, one to a lane
+	struct BoxLanes
+	{
+		__m128 minX, minY, maxX, maxY;
+	};
+
+	// The boxes at indices, the last one repeated to fill the lanes
+	static BoxLanes loadBoxes(const std::vector<float>& minX, const std::vector<float>& minY, const std::vector<float>& maxX, const std::vector<float>& maxY, const int* indices, int count)
+	{
+		const int i = indices[0];
+		if (count == 4 && indices[1] == i + 1 && indices[2] == i + 2 && indices[3] == i + 3)
+		{
+			return { _mm_loadu_ps(&minX[i]), _mm_loadu_ps(&minY[i]), _mm_loadu_ps(&maxX[i]), _mm_loadu_ps(&maxY[i]) };
+		}
+		const int i1 = indices[std::min(1, count - 1)], i2 = indices[std::min(2, count - 1)], i3 = indices[count - 1];
+		return {
+			_mm_setr_ps(minX[i], minX[i1], minX[i2], minX[i3]),
+			_mm_setr_ps(minY[i], minY[i1], minY[i2], minY[i3]),
+			_mm_setr_ps(maxX[i], maxX[i1], maxX[i2], maxX[i3]),
+			_mm_setr_ps(maxY[i], maxY[i1], maxY[i2], maxY[i3])
+		};
+	}
+#endif
+
+	// Hands the boxes of a batch from forEachNear to boxFn one at a time
+	template <class BoxFn>
+	static auto eachBox(BoxFn boxFn)
+	{
+		return [boxFn](const int* indices, int count) {
+			return std::any_of(indices, indices + count, boxFn);
+		};
+	}
+
+	template <class BoxesFn, class ChainFn>
+	bool CompositeCollider::forEachNear(const sf::FloatRect& rect, BoxesFn boxesFn, ChainFn chainFn) const
+	{
+		const int numBoxes = (int)mBoxMinX.size();
+		int indices[4];
+		if (!mpTree)
+		{
+			for (int i = 0; i < numBoxes; i += 4)
 			{
-				if (currCollision.width * currCollision.height > currBest.width * currBest.height)
+				const int count = std::min(numBoxes - i, 4);
+				for (int lane = 0; lane < count; ++lane)
 				{
-					currBest = currCollision;
+					indices[lane] = i + lane;
 				}
-				result = true;
+				if (boxesFn(indices, count)) return true;
 			}
+			for (int i = 0; i < (int)mChainColliders.size(); ++i)
+			{
+				if (chainFn(i)) return true;
+			}
+			return false;
 		}
 
-		collision = currBest;
-		return result;
+		// Boxes from the tree are gathered four at a time
+		struct Callback
+		{
+			const b2DynamicTree& tree;
+			int numBoxes;
+			BoxesFn& boxesFn;
+			ChainFn& chainFn;
+			int* indices;
+			int count;
+			bool found;
+
+			bool QueryCallback(int32 proxyId)
+			{
+				const int index = (int)(std::intptr_t)tree.GetUserData(proxyId);
+				if (index >= numBoxes)
+				{
+					found = chainFn(index - numBoxes);
+				}
+				else
+				{
+					indices[count++] = index;
+					if (count == 4)
+					{
+						found = boxesFn(indices, count);
+						count = 0;
+					}
+				}
+				return !found;
+			}
+		} callback{ *mpTree, numBoxes, boxesFn, chainFn, indices, 0, false };
+		mpTree->Query(&callback, toAABB(rect));
+		if (!callback.found && callback.count > 0)
+		{
+			callback.found = boxesFn(indices, callback.count);
+		}
+		return callback.found;
+	}
+
+	bool CompositeCollider::boxContains(int i, float x, float y) const
+	{
+		return x >= mBoxMinX[i] && x <= mBoxMaxX[i] && y >= mBoxMinY[i] && y <= mBoxMaxY[i];
+	}
+
+	bool CompositeCollider::boxOverlaps(int i, const sf::FloatRect& rect) const
+	{
+		float minX, minY, maxX, maxY;
+		getBounds(rect, minX, minY, maxX, maxY);
+		const float gapX = std::max(std::max(minX - mBoxMaxX[i], mBoxMinX[i] - maxX), 0.f);
+		const float gapY = std::max(std::max(minY - mBoxMaxY[i], mBoxMinY[i] - maxY), 0.f);
+		return gapX * gapX + gapY * gapY < BoxCollider::OVERLAP_DISTANCE * BoxCollider::OVERLAP_DISTANCE;
+	}
+
+	bool CompositeCollider::boxIntersects(int i, const sf::FloatRect& rect, sf::FloatRect& collision) const
+	{
+		float minX, minY, maxX, maxY;
+		getBounds(rect, minX, minY, maxX, maxY);
+		const float left = std::max(mBoxMinX[i], minX), right = std::min(mBoxMaxX[i], maxX);
+		const float top = std::max(mBoxMinY[i], minY), bottom = std::min(mBoxMaxY[i], maxY);
+		if (left >= right || top >= bottom) return false;
+		collision = { left, top, right - left, bottom - top };
+		return true;
+	}
+
+	template <class Fn>
+	void CompositeCollider::forEachBoxIntersection(const sf::FloatRect& rect, const int* indices, int count, Fn fn) const
+	{
+#ifdef TE_SSE
+		float minX, minY, maxX, maxY;
+		getBounds(rect, minX, minY, maxX, maxY);
+		const BoxLanes boxes = loadBoxes(mBoxMinX, mBoxMinY, mBoxMaxX, mBoxMaxY, indices, count);
+		const __m128 l = _mm_max_ps(boxes.minX, _mm_set1_ps(minX));
+		const __m128 r = _mm_min_ps(boxes.maxX, _mm_set1_ps(maxX));
+		const __m128 t = _mm_max_ps(boxes.minY, _mm_set1_ps(minY));
+		const __m128 b = _mm_min_ps(boxes.maxY, _mm_set1_ps(maxY));
+		// Lanes past count repeat a box and are left out
+		int mask = _mm_movemask_ps(_mm_and_ps(_mm_cmplt_ps(l, r), _mm_cmplt_ps(t, b))) & ((1 << count) - 1);
+		if (mask == 0) return;
+
+		alignas(16) float left[4], top[4], right[4], bottom[4];
+		_mm_store_ps(left, l);
+		_mm_store_ps(top, t);
+		_mm_store_ps(right, r);
+		_mm_store_ps(bottom, b);
+		for (int lane = 0; mask != 0; ++lane, mask >>= 1)
+		{
+			if (mask & 1)
+			{
+				fn(indices[lane], sf::FloatRect(left[lane], top[lane], right[lane] - left[lane], bottom[lane] - top[lane]));
+			}
+		}
+#else
+		sf::FloatRect collision;
+		for (int lane = 0; lane < count; ++lane)
+		{
+			if (boxIntersects(indices[lane], rect, collision)) fn(indices[lane], collision);
+		}
+#endif
+	}
+
+	bool CompositeCollider::contains(float x, float y) const
+	{
+		return forEachNear({ x, y, 0, 0 }, [this, x, y](const int* indices, int count) {
+#ifdef TE_SSE
+			const BoxLanes boxes = loadBoxes(mBoxMinX, mBoxMinY, mBoxMaxX, mBoxMaxY, indices, count);
+			const __m128 pointX = _mm_set1_ps(x), pointY = _mm_set1_ps(y);
+			const __m128 insideX = _mm_and_ps(_mm_cmple_ps(boxes.minX, pointX), _mm_cmpge_ps(boxes.maxX, pointX));
+			const __m128 insideY = _mm_and_ps(_mm_cmple_ps(boxes.minY, pointY), _mm_cmpge_ps(boxes.maxY, pointY));
+			return _mm_movemask_ps(_mm_and_ps(insideX, insideY)) != 0;
+#else
+			return std::any_of(indices, indices + count, [this, x, y](int i) { return boxContains(i, x, y); });
+#endif
+		}, [this, x, y](int i) {
+			return mChainColliders[i].contains(x, y);
+		});
+	}
+
+	bool CompositeCollider::overlaps(const sf::FloatRect& rect) const
+	{
+		sf::FloatRect collision;
+		return forEachNear(rect, [this, &rect](const int* indices, int count) {
+#ifdef TE_SSE
+			float minX, minY, maxX, maxY;
+			getBounds(rect, minX, minY, maxX, maxY);
+			const BoxLanes boxes = loadBoxes(mBoxMinX, mBoxMinY, mBoxMaxX, mBoxMaxY, indices, count);
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 gapX = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(minX), boxes.maxX), _mm_sub_ps(boxes.minX, _mm_set1_ps(maxX))), zero);
+			const __m128 gapY = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(minY), boxes.maxY), _mm_sub_ps(boxes.minY, _mm_set1_ps(maxY))), zero);
+			const __m128 gapSq = _mm_add_ps(_mm_mul_ps(gapX, gapX), _mm_mul_ps(gapY, gapY));
+			return _mm_movemask_ps(_mm_cmplt_ps(gapSq, _mm_set1_ps(BoxCollider::OVERLAP_DISTANCE * BoxCollider::OVERLAP_DISTANCE))) != 0;
+#else
+			return std::any_of(indices, indices + count, [this, &rect](int i) { return boxOverlaps(i, rect); });
+#endif
+		}, [this, &rect, &collision](int i) {
+			return mChainColliders[i].intersects(rect, collision);
+		});
+	}
+
+	bool CompositeCollider::intersects(const sf::FloatRect& rect, sf::FloatRect& collision) const
+	{
+		bool boxHit = false, chainHit = false;
+		LargestCollision boxes, chains;
+		auto offerBox = [&boxes, &boxHit](int i, const sf::FloatRect& currCollision) {
+			boxes.offer(currCollision, i, false);
+			boxHit = true;
+		};
+		sf::FloatRect currCollision;
+		forEachNear(rect, [this, &rect, &offerBox](const int* indices, int count) {
+			forEachBoxIntersection(rect, indices, count, offerBox);
+			return false;
+		}, [&](int i) {
+			if (mChainColliders[i].intersects(rect, currCollision))
+			{
+				chains.offer(currCollision, i, true);
+				chainHit = true;
+			}
+			return false;
+		});
+
+		collision = pickCollision(boxHit, boxes, chainHit, chains);
+		return boxHit || chainHit;
+	}
+
+	bool CompositeCollider::intersects(const BoxCollider& o) const
+	{
+		return overlaps(o.getRect());
+	}
+
+	bool CompositeCollider::intersects(const BoxCollider& o, sf::FloatRect& collision) const
+	{
+		return intersects(o.getRect(), collision);
 	}
 
 	bool CompositeCollider::intersects(const CompositeCollider& o) const
 	{
-		for (auto& boxCollider : mBoxColliders)
-			if (o.intersects(boxCollider)) return true;
+		for (int i = 0; i < o.getNumColliders(); ++i)
+		{
+			if (overlaps(o.getBox(i))) return true;
+		}
+		for (auto& other : o.mChainColliders)
+		{
+			if (intersects(other)) return true;
+		}
 		return false;
 	}
 
-	bool CompositeCollider::intersects(const CompositeCollider& o, sf::FloatRect& collision) const
+	// Chains only collide with boxes; two chains never meet as both belong to static geometry
+	bool CompositeCollider::intersects(const ChainCollider& o) const
+	{
+		sf::FloatRect collision;
+		return forEachNear(o.getBounds(), eachBox([this, &o, &collision](int i) {
+			return o.intersects(getBox(i), collision);
+		}), [](int) {
+			return false;
+		});
+	}
+
+	bool CompositeCollider::intersects(const ChainCollider& o, sf::FloatRect& collision) const
 	{
 		bool result = false;
+		LargestCollision boxes;
+		sf::FloatRect currCollision;
+		auto testBox = [&](int i) {
+			if (o.intersects(getBox(i), currCollision))
+			{
+				boxes.offer(currCollision, i, true);
+				result = true;
+			}
+			return false;
+		};
+		forEachNear(o.getBounds(), eachBox(testBox), [](int) {
+			return false;
+		});
 
-		sf::FloatRect currBest = { 0, 0, 0, 0 };
+		collision = boxes.rect;
+		return result;
+	}
+
+	bool CompositeCollider::intersects(const CompositeCollider& o, sf::FloatRect& collision) const
+	{
+		// Each of this composite's colliders near one of o's is tested against
+		// all of o, as a scan over this composite would; a collider near several
+		// of o's is tested again with the same result
+		bool boxHit = false, chainHit = false;
+		LargestCollision boxes, chains;
 		sf::FloatRect currCollision;
-		for (auto& boxCollider : mBoxColliders)
+		auto testBox = [&](int i) {
+			if (o.intersects(getBox(i), currCollision))
+			{
+				boxes.offer(currCollision, i, false);
+				boxHit = true;
+			}
+			return false;
+		};
+		auto testChain = [&](int i) {
+			if (o.intersects(mChainColliders[i], currCollision))
+			{
+				chains.offer(currCollision, i, true);
+				chainHit = true;
+			}
+			return false;
+		};
+		if (!mpTree)
 		{
-			if (o.intersects(boxCollider, currCollision))
+			for (int i = 0; i < getNumColliders(); ++i)
 			{
-				if (currCollision.width * currCollision.height > currBest.width * currBest.height)
-				{
-					currBest = currCollision;
-				}
+				testBox(i);
+			}
+			for (int i = 0; i < (int)mChainColliders.size(); ++i)
+			{
+				testChain(i);
+			}
+		}
+		else
+		{
+			for (int i = 0; i < o.getNumColliders(); ++i)
+			{
+				forEachNear(o.getBox(i), eachBox(testBox), testChain);
+			}
+			for (auto& other : o.mChainColliders)
+			{
+				forEachNear(other.getBounds(), eachBox(testBox), [](int) { return false; });
 			}
 		}
 
-		collision = currBest;
-		return result;
+		collision = pickCollision(boxHit, boxes, chainHit, chains);
+		return boxHit || chainHit;
 	}
 
 	CompositeCollider CompositeCollider::transform(const sf::Transform& t) const
 	{
 		CompositeCollider newComposite;
-		newComposite.mBoxColliders.reserve(mBoxColliders.size());
-		for (auto& collider : mBoxColliders)
+		for (auto pBounds : { &newComposite.mBoxMinX, &newComposite.mBoxMinY, &newComposite.mBoxMaxX, &newComposite.mBoxMaxY })
+			pBounds->reserve(mBoxMinX.size());
+		for (int i = 0; i < getNumColliders(); ++i)
+			newComposite.addBox(t.transformRect(getBox(i)));
+		newComposite.mChainColliders.reserve(mChainColliders.size());
+		for (auto& collider : mChainColliders)
 			newComposite.addCollider(collider.transform(t));
 		return newComposite;
 	}
 
-	void CompositeCollider::createFixtures(b2Body& body, std::vector<b2Fixture*>& outFixtures) const
+	void CompositeCollider::buildTree()
+	{
+		auto pTree = std::make_shared<b2DynamicTree>();
+		for (int i = 0; i < getNumColliders(); ++i)
+		{
+			pTree->CreateProxy(toAABB(getBox(i)), (void*)(std::intptr_t)i);
+		}
+		for (int i = 0; i < (int)mChainColliders.size(); ++i)
+		{
+			pTree->CreateProxy(toAABB(mChainColliders[i].getBounds()), (void*)(std::intptr_t)(mBoxMinX.size() + i));
+		}
+		mpTree = std::move(pTree);
+	}
+
+	void CompositeCollider::createFixtures(b2Body& body, std::vector<b2Fixture*>& outFixtures, std::vector<b2Fixture*>& outChainFixtures) const
 	{
 		outFixtures.clear();
-		outFixtures.reserve(mBoxColliders.size());
-		for (auto& boxCollider : mBoxColliders)
+		outFixtures.reserve(mBoxMinX.size());
+		for (int i = 0; i < getNumColliders(); ++i)
+		{
+			const b2PolygonShape shape = BoxCollider::makeShape(getBox(i));
+			outFixtures.push_back(body.CreateFixture(&shape, 0));
+		}
+		outChainFixtures.clear();
+		outChainFixtures.reserve(mChainColliders.size());
+		for (auto& chainCollider : mChainColliders)
 		{
-			outFixtures.push_back(boxCollider.createFixture(body));
+			outChainFixtures.push_back(chainCollider.createFixture(body));
 		}
 	}
 
 	void CompositeCollider::draw(sf::RenderTarget& target, sf::RenderStates states) const
 	{
-		std::for_each(mBoxColliders.begin(), mBoxColliders.end(), [&target, &states](const BoxCollider& collider) {
+		const sf::Color fillColor(255, 0, 0, 50);
+		sf::VertexArray boxes(sf::Quads, mBoxMinX.size() * 4);
+		for (size_t i = 0; i < mBoxMinX.size(); ++i)
+		{
+			boxes[i * 4 + 0] = sf::Vertex({ mBoxMinX[i], mBoxMinY[i] }, fillColor);
+			boxes[i * 4 + 1] = sf::Vertex({ mBoxMaxX[i], mBoxMinY[i] }, fillColor);
+			boxes[i * 4 + 2] = sf::Vertex({ mBoxMaxX[i], mBoxMaxY[i] }, fillColor);
+			boxes[i * 4 + 3] = sf::Vertex({ mBoxMinX[i], mBoxMaxY[i] }, fillColor);
+		}
+		target.draw(boxes, states);
+		std::for_each(mChainColliders.begin(), mChainColliders.end(), [&target, &states](const ChainCollider& collider) {
 			target.draw(collider, states);
 		});
 	}
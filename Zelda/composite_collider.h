@@ -3,8 +3,11 @@
 
 #include "collider.h"
 #include "box_collider.h"
+#include "chain_collider.h"
 #include "wall.h"
 
+#include <array>
+#include <memory>
 #include <vector>
 
 namespace te
@@ -14,23 +17,66 @@ namespace te
 	class CompositeCollider : public Collider
 	{
 	public:
+		void addBox(const sf::FloatRect& rect);
 		void addCollider(const BoxCollider& collider);
-		//virtual std::vector<Wall2f> getWalls() const;
-		const std::vector<Wall2f>& getWalls() const;
+		void addCollider(const ChainCollider& collider);
+		void addColliders(const CompositeCollider& collider);
+		// Replaces the box collider at index with the last one
+		void removeCollider(int index);
+		void removeChainColliders();
+		int getNumColliders() const;
+		sf::FloatRect getBox(int index) const;
+		// The walls getWalls() gives for the box at index
+		std::array<Wall2f, 4> getBoxWalls(int index) const;
+		int getNumChainColliders() const;
+		const ChainCollider& getChainCollider(int index) const;
+		void clear();
+		// Walls of the boxes, four to a box and made from their bounds, then
+		// those of the chains
+		std::vector<Wall2f> getWalls() const;
 
 		bool contains(float x, float y) const;
 		bool intersects(const BoxCollider&) const;
 		bool intersects(const BoxCollider&, sf::FloatRect&) const;
 		bool intersects(const CompositeCollider&) const;
 		bool intersects(const CompositeCollider&, sf::FloatRect&) const;
+		bool intersects(const ChainCollider&) const;
+		bool intersects(const ChainCollider&, sf::FloatRect&) const;
 
 		CompositeCollider transform(const sf::Transform&) const;
-		void createFixtures(b2Body& body, std::vector<b2Fixture*>& outFixtures) const;
+		// Indexes the colliders in an AABB tree so intersection tests only visit
+		// colliders near the other one. Changing the colliders drops the tree.
+		void buildTree();
+		// Fixtures of the box colliders, in order, then of the chain colliders
+		void createFixtures(b2Body& body, std::vector<b2Fixture*>& outFixtures, std::vector<b2Fixture*>& outChainFixtures) const;
 
 	private:
 		virtual void draw(sf::RenderTarget&, sf::RenderStates) const;
-		std::vector<BoxCollider> mBoxColliders;
-		std::vector<Wall2f> mWalls;
+
+		bool overlaps(const sf::FloatRect& rect) const;
+		bool intersects(const sf::FloatRect& rect, sf::FloatRect& collision) const;
+		bool boxContains(int index, float x, float y) const;
+		bool boxOverlaps(int index, const sf::FloatRect& rect) const;
+		bool boxIntersects(int index, const sf::FloatRect& rect, sf::FloatRect& collision) const;
+
+		// Calls boxesFn(indices, count) with up to four boxes at a time and
+		// chainFn(index) with each chain, until one returns true. With a tree
+		// only the colliders that may overlap rect are passed.
+		template <class BoxesFn, class ChainFn>
+		bool forEachNear(const sf::FloatRect& rect, BoxesFn boxesFn, ChainFn chainFn) const;
+		// Calls fn(index, collision) for each of the count boxes at indices
+		// that the rect intersects, testing the four at once
+		template <class Fn>
+		void forEachBoxIntersection(const sf::FloatRect& rect, const int* indices, int count, Fn fn) const;
+
+		// Box colliders as separate bound arrays so they can be tested four at a time
+		std::vector<float> mBoxMinX;
+		std::vector<float> mBoxMinY;
+		std::vector<float> mBoxMaxX;
+		std::vector<float> mBoxMaxY;
+		std::vector<ChainCollider> mChainColliders;
+		// Shared by copies, which hold the same colliders until they change
+		std::shared_ptr<const b2DynamicTree> mpTree;
 	};
 }
 
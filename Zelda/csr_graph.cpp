@@ -0,0 +1,75 @@
+#include "csr_graph.h"
+
+namespace te
+{
+	CsrGraph::CsrGraph()
+		: mPositionX()
+		, mPositionY()
+		, mPresent()
+		, mEdgeBegin()
+		, mEdgeEnd()
+		, mEdgeCapacity()
+		, mEdgeTargets()
+		, mEdgeCosts()
+		, mNumEdges(0)
+	{}
+
+	int CsrGraph::numNodes() const
+	{
+		return (int)mPresent.size();
+	}
+
+	int CsrGraph::numEdges() const
+	{
+		return mNumEdges;
+	}
+
+	bool CsrGraph::isPresent(int node) const
+	{
+		return node >= 0 && node < numNodes() && mPresent[node] != 0;
+	}
+
+	sf::Vector2f CsrGraph::getPosition(int node) const
+	{
+		return { mPositionX[node], mPositionY[node] };
+	}
+
+	int CsrGraph::getEdgeBegin(int node) const
+	{
+		return mEdgeBegin[node];
+	}
+
+	int CsrGraph::getEdgeEnd(int node) const
+	{
+		return mEdgeEnd[node];
+	}
+
+	int CsrGraph::getEdgeTarget(int edge) const
+	{
+		return mEdgeTargets[edge];
+	}
+
+	double CsrGraph::getEdgeCost(int edge) const
+	{
+		return mEdgeCosts[edge];
+	}
+
+	void CsrGraph::compact()
+	{
+		std::vector<int> targets;
+		std::vector<double> costs;
+		targets.reserve(mNumEdges);
+		costs.reserve(mNumEdges);
+		for (int node = 0; node < numNodes(); ++node)
+		{
+			const int begin = (int)targets.size();
+			targets.insert(targets.end(), mEdgeTargets.begin() + mEdgeBegin[node], mEdgeTargets.begin() + mEdgeEnd[node]);
+			costs.insert(costs.end(), mEdgeCosts.begin() + mEdgeBegin[node], mEdgeCosts.begin() + mEdgeEnd[node]);
+			mEdgeBegin[node] = begin;
+			mEdgeEnd[node] = (int)targets.size();
+			mEdgeCapacity[node] = mEdgeEnd[node] - begin;
+		}
+		mEdgeTargets.swap(targets);
+		mEdgeCosts.swap(costs);
+	}
+}
@@ -0,0 +1,149 @@
+#ifndef TE_CSR_GRAPH_H
+#define TE_CSR_GRAPH_H
+
+#include <SFML/Graphics.hpp>
+
+#include <vector>
+
+namespace te
+{
+	// Snapshot of a graph of positioned nodes in compressed sparse rows: the
+	// edges from node n are those from getEdgeBegin(n) up to getEdgeEnd(n), in
+	// the order the graph lists them. Node indices are the graph's; removed
+	// nodes are kept as absent nodes without edges.
+	class CsrGraph
+	{
+	public:
+		CsrGraph();
+		template <class Graph>
+		explicit CsrGraph(const Graph& graph);
+
+		// Copies the given nodes and their edges from the graph again. A row
+		// that no longer fits where it was is moved to the end of the edges,
+		// which are packed again once half of them are unused.
+		template <class Graph>
+		void update(const Graph& graph, const std::vector<int>& nodes);
+
+		int numNodes() const;
+		int numEdges() const;
+		bool isPresent(int node) const;
+		sf::Vector2f getPosition(int node) const;
+
+		int getEdgeBegin(int node) const;
+		int getEdgeEnd(int node) const;
+		int getEdgeTarget(int edge) const;
+		double getEdgeCost(int edge) const;
+
+		// Calls fn(to, cost) for each edge from node
+		template <class Fn>
+		void forEachEdge(int node, Fn fn) const;
+
+	private:
+		void compact();
+
+		std::vector<float> mPositionX;
+		std::vector<float> mPositionY;
+		std::vector<char> mPresent;
+		// The row of node n is mEdgeBegin[n] up to mEdgeEnd[n], with room up
+		// to mEdgeBegin[n] + mEdgeCapacity[n]
+		std::vector<int> mEdgeBegin;
+		std::vector<int> mEdgeEnd;
+		std::vector<int> mEdgeCapacity;
+		std::vector<int> mEdgeTargets;
+		std::vector<double> mEdgeCosts;
+		int mNumEdges;
+	};
+
+	template <class Graph>
+	CsrGraph::CsrGraph(const Graph& graph)
+		: mPositionX(graph.numNodes(), 0)
+		, mPositionY(graph.numNodes(), 0)
+		, mPresent(graph.numNodes(), 0)
+		, mEdgeBegin(graph.numNodes(), 0)
+		, mEdgeEnd(graph.numNodes(), 0)
+		, mEdgeCapacity(graph.numNodes(), 0)
+		, mEdgeTargets()
+		, mEdgeCosts()
+		, mNumEdges(0)
+	{
+		for (int node = 0; node < graph.numNodes(); ++node)
+		{
+			mEdgeBegin[node] = (int)mEdgeTargets.size();
+			if (graph.isPresent(node))
+			{
+				const sf::Vector2f position = graph.getNode(node).getPosition();
+				mPositionX[node] = position.x;
+				mPositionY[node] = position.y;
+				mPresent[node] = 1;
+				graph.forEachEdge(node, [this](int to, double cost) {
+					mEdgeTargets.push_back(to);
+					mEdgeCosts.push_back(cost);
+				});
+			}
+			mEdgeEnd[node] = (int)mEdgeTargets.size();
+			mEdgeCapacity[node] = mEdgeEnd[node] - mEdgeBegin[node];
+		}
+		mNumEdges = (int)mEdgeTargets.size();
+	}
+
+	template <class Graph>
+	void CsrGraph::update(const Graph& graph, const std::vector<int>& nodes)
+	{
+		if (graph.numNodes() > numNodes())
+		{
+			const size_t numNodes = graph.numNodes();
+			mPositionX.resize(numNodes, 0);
+			mPositionY.resize(numNodes, 0);
+			mPresent.resize(numNodes, 0);
+			mEdgeBegin.resize(numNodes, (int)mEdgeTargets.size());
+			mEdgeEnd.resize(numNodes, (int)mEdgeTargets.size());
+			mEdgeCapacity.resize(numNodes, 0);
+		}
+
+		for (int node : nodes)
+		{
+			mNumEdges -= mEdgeEnd[node] - mEdgeBegin[node];
+			mEdgeEnd[node] = mEdgeBegin[node];
+			mPresent[node] = graph.isPresent(node) ? 1 : 0;
+			if (!mPresent[node])
+			{
+				continue;
+			}
+
+			const sf::Vector2f position = graph.getNode(node).getPosition();
+			mPositionX[node] = position.x;
+			mPositionY[node] = position.y;
+
+			int numEdges = 0;
+			graph.forEachEdge(node, [&numEdges](int, double) { ++numEdges; });
+			if (numEdges > mEdgeCapacity[node])
+			{
+				mEdgeBegin[node] = mEdgeEnd[node] = (int)mEdgeTargets.size();
+				mEdgeCapacity[node] = numEdges;
+				mEdgeTargets.resize(mEdgeTargets.size() + numEdges);
+				mEdgeCosts.resize(mEdgeCosts.size() + numEdges);
+			}
+			graph.forEachEdge(node, [this, node](int to, double cost) {
+				mEdgeTargets[mEdgeEnd[node]] = to;
+				mEdgeCosts[mEdgeEnd[node]++] = cost;
+			});
+			mNumEdges += numEdges;
+		}
+
+		if ((int)mEdgeTargets.size() > 2 * mNumEdges + numNodes())
+		{
+			compact();
+		}
+	}
+
+	template <class Fn>
+	void CsrGraph::forEachEdge(int node, Fn fn) const
+	{
+		for (int edge = mEdgeBegin[node]; edge < mEdgeEnd[node]; ++edge)
+		{
+			fn(mEdgeTargets[edge], mEdgeCosts[edge]);
+		}
+	}
+}
+
+#endif
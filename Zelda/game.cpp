@@ -3,14 +3,23 @@
 #include "vector_ops.h"
 #include "entity_manager.h"
 #include "message_dispatcher.h"
+#include "path_manager.h"
 #include "scene_node.h"
 
 namespace te
 {
+	namespace
+	{
+		// Node expansions shared by all pending path searches each update
+		const int NUM_SEARCH_CYCLES_PER_UPDATE = 1000;
+		const int MAX_ACTIVE_SEARCHES = 8;
+	}
+
 	Game::Game(Application& app, const sf::Transform& pixelToWorldTransform)
 		: mApp(app)
 		, mpEntityManager(EntityManager::make())
 		, mpMessageDispatcher(MessageDispatcher::make(*mpEntityManager))
+		, mpPathManager(PathManager::make(NUM_SEARCH_CYCLES_PER_UPDATE, MAX_ACTIVE_SEARCHES))
 		, mpWorld(new b2World(b2Vec2(0, 0)))
 		, mTileMapID(-1)
 		, mpTileMap(nullptr)
@@ -24,20 +33,18 @@ namespace te
 	bool Game::isPathObstructed(sf::Vector2f a, sf::Vector2f b, float boundingRadius) const
 	{
 		throwIfNoMap();
-		auto& walls = mpTileMap->getWalls();
-
-		sf::Vector2f toB = normalize(b - a);
-		sf::Vector2f currPos = a;
-
-		while (distanceSq(currPos, b) > boundingRadius * boundingRadius)
-		{
-			currPos += toB * 0.5f * boundingRadius;
-			for (auto& wall : walls)
-				if (wall.intersects(currPos, boundingRadius))
-					return true;
-		}
+		if (mpTileMap->isTileAligned())
+			return mpTileMap->getOccupancy().isObstructed({ a, b, boundingRadius });
+		return mpTileMap->getWallGrid().isObstructed({ a, b, boundingRadius });
+	}
 
-		return false;
+	void Game::isPathObstructed(const std::vector<WallGrid::Sweep>& paths, std::vector<char>& outObstructed) const
+	{
+		throwIfNoMap();
+		if (mpTileMap->isTileAligned())
+			mpTileMap->getOccupancy().isObstructed(paths, outObstructed);
+		else
+			mpTileMap->getWallGrid().isObstructed(paths, outObstructed);
 	}
 
 	const TileMap& Game::getMap() const
@@ -56,9 +63,20 @@ namespace te
 	{
 		mpMessageDispatcher->dispatchDelayedMessages(dt);
 		mpWorld->Step(dt.asSeconds(), 8, 3);
+		mpPathManager->updateSearches();
 		mpSceneGraph->update(dt);
 	}
 
+	bool Game::isLoading() const
+	{
+		return false;
+	}
+
+	float Game::getLoadingProgress() const
+	{
+		return 1;
+	}
+
 	Application& Game::getApplication()
 	{
 		return mApp;
@@ -74,6 +92,11 @@ namespace te
 		return *mpMessageDispatcher;
 	}
 
+	PathManager& Game::getPathManager() const
+	{
+		return *mpPathManager;
+	}
+
 	b2World& Game::getPhysicsWorld() { return *mpWorld; }
 	const b2World& Game::getPhysicsWorld() const { return *mpWorld; }
 
@@ -84,6 +107,10 @@ namespace te
 	{
 		if (pTileMap)
 		{
+			if (mpEntityManager->hasEntity(mTileMapID))
+			{
+				mpSceneGraph->detachNode(*mpTileMap);
+			}
 			mTileMapID = pTileMap->getID();
 			mpTileMap = pTileMap.get();
 			mpSceneGraph->attachNode(std::move(pTileMap));
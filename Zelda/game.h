@@ -1,9 +1,12 @@
 #ifndef TE_GAME_H
 #define TE_GAME_H
 
+#include "wall_grid.h"
+
 #include <SFML/Graphics.hpp>
 
 #include <memory>
+#include <vector>
 
 class b2World;
 
@@ -13,6 +16,7 @@ namespace te
 	class TileMap;
 	class EntityManager;
 	class MessageDispatcher;
+	class PathManager;
 	class SceneNode;
 	class TextureManager;
 
@@ -22,16 +26,23 @@ namespace te
 		virtual ~Game();
 
 		bool isPathObstructed(sf::Vector2f a, sf::Vector2f b, float boundingRadius = 0) const;
+		// One flag per path in outObstructed
+		void isPathObstructed(const std::vector<WallGrid::Sweep>& paths, std::vector<char>& outObstructed) const;
 		const TileMap& getMap() const;
 		TileMap& getMap();
 
 		virtual void processInput(const sf::Event& evt) = 0;
 		virtual void update(const sf::Time& dt);
 
+		// While loading, the application shows a loading screen instead of drawing the game
+		virtual bool isLoading() const;
+		virtual float getLoadingProgress() const;
+
 		Application& getApplication();
 
 		EntityManager& getEntityManager() const;
 		MessageDispatcher& getMessageDispatcher() const;
+		PathManager& getPathManager() const;
 
 		b2World& getPhysicsWorld();
 		const b2World& getPhysicsWorld() const;
@@ -54,6 +65,8 @@ namespace te
 
 		std::unique_ptr<EntityManager> mpEntityManager;
 		std::unique_ptr<MessageDispatcher> mpMessageDispatcher;
+		// Outlives the entities whose planners it holds
+		std::unique_ptr<PathManager> mpPathManager;
 
 		std::unique_ptr<b2World> mpWorld;
 		int mTileMapID;
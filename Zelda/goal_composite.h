@@ -18,7 +18,21 @@ namespace te
 			mSubgoals.push_front(std::make_unique<U>(args...));
 		}
 
+		virtual bool handleMessage(const Telegram& msg)
+		{
+			return forwardMessageToFrontMostSubgoal(msg);
+		}
+
 	protected:
+		bool forwardMessageToFrontMostSubgoal(const Telegram& msg)
+		{
+			if (!mSubgoals.empty())
+			{
+				return mSubgoals.front()->handleMessage(msg);
+			}
+			return false;
+		}
+
 		Status processSubgoals(const sf::Time& dt)
 		{
 			while (!mSubgoals.empty() && (mSubgoals.front()->isCompleted() || mSubgoals.front()->hasFailed()))
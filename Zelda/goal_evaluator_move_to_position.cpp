@@ -11,7 +11,7 @@ namespace te
 
 	void GoalEvaluator_MoveToPosition::setGoal(ZeldaEntity& entity)
 	{
-		if (!entity.getSteering().isSeekEnabled())
+		if (!entity.getSteering().isSeekEnabled() && !entity.getPathPlanner().hasPendingRequest())
 		{
 			entity.getBrain().addSubgoal<Goal_MoveToPosition>(entity, sf::Vector2f(16.f * 14, 16.f * 14));
 		}
@@ -1,19 +1,20 @@
 #include "goal_follow_path.h"
 #include "goal_seek_to_position.h"
+#include "zelda_entity.h"
 
 namespace te
 {
-	Goal_FollowPath::Goal_FollowPath(ZeldaEntity& owner, const std::list<sf::Vector2f>& path)
+	Goal_FollowPath::Goal_FollowPath(ZeldaEntity& owner, std::vector<sf::Vector2f> path)
 		: mOwner(owner)
-		, mPath(path)
+		, mPath(std::move(path))
+		, mNextWaypoint(0)
 	{}
 
 	void Goal_FollowPath::activate()
 	{
 		setStatus(Status::ACTIVE);
 
-		sf::Vector2f waypoint = mPath.front();
-		mPath.pop_front();
+		sf::Vector2f waypoint = mPath[mNextWaypoint++];
 
 		addSubgoal<Goal_SeekToPosition>(mOwner, waypoint);
 	}
@@ -27,7 +28,19 @@ namespace te
 
 		setStatus(processSubgoals(dt));
 
-		if (isCompleted() && !mPath.empty())
+		// Long paths are planned a stretch at a time
+		PathPlanner& planner = mOwner.getPathPlanner();
+		if (isCompleted() && mNextWaypoint == mPath.size() && planner.hasUnrefinedPath())
+		{
+			mPath.clear();
+			mNextWaypoint = 0;
+			if (!planner.refinePath(mPath))
+			{
+				setStatus(Status::FAILED);
+			}
+		}
+
+		if (isCompleted() && mNextWaypoint < mPath.size())
 		{
 			activate();
 		}
@@ -5,6 +5,8 @@
 
 #include <SFML/Graphics.hpp>
 
+#include <vector>
+
 namespace te
 {
 	class ZeldaEntity;
@@ -12,14 +14,16 @@ namespace te
 	class Goal_FollowPath : public GoalComposite<ZeldaEntity>
 	{
 	public:
-		Goal_FollowPath(ZeldaEntity& owner, const std::list<sf::Vector2f>& path);
+		Goal_FollowPath(ZeldaEntity& owner, std::vector<sf::Vector2f> path);
 
 		void activate();
 		Status process(const sf::Time& dt);
 		void terminate();
 	private:
 		ZeldaEntity& mOwner;
-		std::list<sf::Vector2f> mPath;
+		// Refined stretches of a long path reuse its storage
+		std::vector<sf::Vector2f> mPath;
+		size_t mNextWaypoint;
 	};
 }
 
@@ -1,12 +1,14 @@
 #include "goal_move_to_position.h"
 #include "zelda_entity.h"
 #include "goal_follow_path.h"
+#include "message_dispatcher.h"
 
 namespace te
 {
 	Goal_MoveToPosition::Goal_MoveToPosition(ZeldaEntity& owner, sf::Vector2f position)
 		: mOwner(owner)
 		, mPosition(position)
+		, mbPlanning(false)
 	{}
 
 	void Goal_MoveToPosition::activate()
@@ -15,11 +17,7 @@ namespace te
 
 		removeAllSubgoals();
 
-		std::list<sf::Vector2f> path;
-		if (mOwner.getPathPlanner().createPathToPosition(mPosition, path))
-		{
-			addSubgoal<Goal_FollowPath>(mOwner, std::move(path));
-		}
+		mbPlanning = mOwner.getPathPlanner().requestPathToPosition(mPosition);
 	}
 
 	Goal<ZeldaEntity>::Status Goal_MoveToPosition::process(const sf::Time& dt)
@@ -29,6 +27,16 @@ namespace te
 			activate();
 		}
 
+		if (mbPlanning)
+		{
+			// The path went to another goal
+			if (!mOwner.getPathPlanner().hasPendingRequest())
+			{
+				activate();
+			}
+			return getStatus();
+		}
+
 		setStatus(processSubgoals(dt));
 
 		if (hasFailed())
@@ -39,5 +47,43 @@ namespace te
 		return getStatus();
 	}
 
-	void Goal_MoveToPosition::terminate() {}
+	void Goal_MoveToPosition::terminate()
+	{
+		if (mbPlanning)
+		{
+			mOwner.getPathPlanner().cancelRequest();
+			mbPlanning = false;
+		}
+	}
+
+	bool Goal_MoveToPosition::handleMessage(const Telegram& msg)
+	{
+		if (forwardMessageToFrontMostSubgoal(msg))
+		{
+			return true;
+		}
+
+		if (!mbPlanning)
+		{
+			return false;
+		}
+
+		switch (msg.msg)
+		{
+		case PathPlanner::PathReady:
+		{
+			std::vector<sf::Vector2f> path;
+			mOwner.getPathPlanner().getPath(path);
+			addSubgoal<Goal_FollowPath>(mOwner, std::move(path));
+			mbPlanning = false;
+			return true;
+		}
+		case PathPlanner::NoPathAvailable:
+			setStatus(Status::FAILED);
+			mbPlanning = false;
+			return true;
+		}
+
+		return false;
+	}
 }
@@ -17,10 +17,13 @@ namespace te
 		void activate();
 		Status process(const sf::Time& dt);
 		void terminate();
+		bool handleMessage(const Telegram& msg);
 
 	private:
 		ZeldaEntity& mOwner;
 		sf::Vector2f mPosition;
+		// Waiting on the path planner for a path to follow
+		bool mbPlanning;
 	};
 }
 
@@ -0,0 +1,29 @@
+#ifndef TE_GRAPH_FUNCTIONS_H
+#define TE_GRAPH_FUNCTIONS_H
+
+#include "vector_ops.h"
+
+namespace te
+{
+	template <class GraphType>
+	float calculateAverageGraphEdgeLength(const GraphType& graph)
+	{
+		float totalLength = 0;
+		int numEdgesCounted = 0;
+
+		typename GraphType::ConstNodeIterator nodeIter(graph);
+		for (const typename GraphType::Node* pNode = nodeIter.begin(); !nodeIter.end(); pNode = nodeIter.next())
+		{
+			typename GraphType::ConstEdgeIterator edgeIter(graph, pNode->getIndex());
+			for (const typename GraphType::Edge* pEdge = edgeIter.begin(); !edgeIter.end(); pEdge = edgeIter.next())
+			{
+				++numEdgesCounted;
+				totalLength += distance(graph.getNode(pEdge->getFrom()).getPosition(), graph.getNode(pEdge->getTo()).getPosition());
+			}
+		}
+
+		return totalLength / numEdgesCounted;
+	}
+}
+
+#endif
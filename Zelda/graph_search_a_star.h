@@ -1,11 +1,13 @@
 #ifndef TE_GRAPH_SEARCH_A_STAR_H
 #define TE_GRAPH_SEARCH_A_STAR_H
 
-#include "indexed_priority_queue.h"
+#include "csr_graph.h"
+#include "graph_search_workspace.h"
 #include "vector_ops.h"
 
-#include <vector>
 #include <list>
+#include <memory>
+#include <vector>
 
 namespace te
 {
@@ -19,96 +21,116 @@ namespace te
 		{
 			return distance(graph.getNode(node1).getPosition(), graph.getNode(node2).getPosition());
 		}
+
+		static double calculate(const CsrGraph& graph, int node1, int node2)
+		{
+			return distance(graph.getPosition(node1), graph.getPosition(node2));
+		}
 	};
 
 	template <class Graph, class Heuristic>
 	class GraphSearchAStar
 	{
 	public:
-		typedef typename Graph::Edge Edge;
+		typedef GraphSearchWorkspace Workspace;
 
 		GraphSearchAStar(const Graph& graph, int source, int target)
 			: mGraph(graph)
-			, mGCosts(graph.numNodes(), 0.f)
-			, mFCosts(graph.numNodes(), 0.f)
-			, mShortestPathTree(graph.numNodes(), nullptr)
-			, mSearchFrontier(graph.numNodes(), nullptr)
+			, mpOwnedWorkspace(std::make_unique<Workspace>())
+			, mWorkspace(*mpOwnedWorkspace)
+			, mSource(source)
+			, mTarget(target)
+		{
+			search();
+		}
+
+		// Searches in a workspace shared with other searches; the results
+		// are valid until the workspace's next search
+		GraphSearchAStar(const Graph& graph, int source, int target, Workspace& workspace)
+			: mGraph(graph)
+			, mpOwnedWorkspace()
+			, mWorkspace(workspace)
 			, mSource(source)
 			, mTarget(target)
 		{
 			search();
 		}
 
-		std::vector<const Edge*> getAllPaths() const
+		// The node each node was settled from, or Workspace::NO_PARENT
+		std::vector<int> getAllPaths() const
 		{
-			return mShortestPathTree;
+			std::vector<int> shortestPathTree(mGraph.numNodes());
+			for (int i = 0; i < mGraph.numNodes(); ++i)
+			{
+				shortestPathTree[i] = mWorkspace.getTreeParent(i);
+			}
+			return shortestPathTree;
 		}
 
 		std::list<int> getPathToTarget() const
 		{
-			std::list<int> path;
+			std::vector<int> path;
+			getPathToTarget(path);
+			return std::list<int>(path.begin(), path.end());
+		}
+
+		// The nodes from the target back to the source, reusing outPath's storage
+		void getPathToTarget(std::vector<int>& outPath) const
+		{
+			outPath.clear();
 
-			if (mTarget < 0 || mTarget >= mGraph.numNodes() || mSearchFrontier[mTarget] == 0) return path;
+			if (mTarget < 0 || mTarget >= mGraph.numNodes() || mWorkspace.getFrontierParent(mTarget) == Workspace::NO_PARENT) return;
 
 			int nd = mTarget;
 
-			path.push_back(nd);
+			outPath.push_back(nd);
 
 			while (nd != mSource)
 			{
-				nd = mShortestPathTree[nd]->getFrom();
-				path.push_back(nd);
+				nd = mWorkspace.getTreeParent(nd);
+				outPath.push_back(nd);
 			}
-
-			return path;
 		}
 
 	private:
 		void search()
 		{
-			IndexedPriorityQueue<double> pq(mFCosts);
+			mWorkspace.begin(mGraph.numNodes());
+			mWorkspace.setCosts(mSource, 0, 0);
+			IndexedPriorityQueue<double>& pq = mWorkspace.getQueue();
 			pq.insert(mSource);
 
 			while (!pq.empty())
 			{
 				int nextClosestNode = pq.pop();
-				mShortestPathTree[nextClosestNode] = mSearchFrontier[nextClosestNode];
+				mWorkspace.setTreeParent(nextClosestNode, mWorkspace.getFrontierParent(nextClosestNode));
 
 				if (nextClosestNode == mTarget) return;
 
-				typename Graph::ConstEdgeIterator constEdgeIter(mGraph, nextClosestNode);
-				for (const Edge* pEdge = constEdgeIter.begin(); !constEdgeIter.end(); pEdge = constEdgeIter.next())
-				{
-					double hCost = Heuristic::calculate(mGraph, mTarget, pEdge->getTo());
-					double gCost = mGCosts[nextClosestNode] + pEdge->getCost();
+				const double nextGCost = mWorkspace.getGCost(nextClosestNode);
+				mGraph.forEachEdge(nextClosestNode, [&](int to, double cost) {
+					double gCost = nextGCost + cost;
 
-					if (mSearchFrontier[pEdge->getTo()] == nullptr)
+					if (mWorkspace.getFrontierParent(to) == Workspace::NO_PARENT)
 					{
-						mFCosts[pEdge->getTo()] = gCost + hCost;
-						mGCosts[pEdge->getTo()] = gCost;
-						pq.insert(pEdge->getTo());
-						mSearchFrontier[pEdge->getTo()] = pEdge;
+						mWorkspace.setCosts(to, gCost, gCost + Heuristic::calculate(mGraph, mTarget, to));
+						pq.insert(to);
+						mWorkspace.setFrontierParent(to, nextClosestNode);
 					}
 
-					else if ((gCost < mGCosts[pEdge->getTo()]) && (mShortestPathTree[pEdge->getTo()] == nullptr))
+					else if ((gCost < mWorkspace.getGCost(to)) && (mWorkspace.getTreeParent(to) == Workspace::NO_PARENT))
 					{
-						mGCosts[pEdge->getTo()] = gCost;
-
-						std::vector<size_t> elems = pq.popAll();
-						mFCosts[pEdge->getTo()] = gCost + hCost;
-						pq.assignElements(std::move(elems));
-
-						mSearchFrontier[pEdge->getTo()] = pEdge;
+						mWorkspace.setCosts(to, gCost, gCost + Heuristic::calculate(mGraph, mTarget, to));
+						pq.changePriority(to);
+						mWorkspace.setFrontierParent(to, nextClosestNode);
 					}
-				}
+				});
 			}
 		}
 
 		const Graph& mGraph;
-		std::vector<double> mGCosts;
-		std::vector<double> mFCosts;
-		std::vector<const Edge*> mShortestPathTree;
-		std::vector<const Edge*> mSearchFrontier;
+		std::unique_ptr<Workspace> mpOwnedWorkspace;
+		Workspace& mWorkspace;
 		int mSource;
 		int mTarget;
 	};
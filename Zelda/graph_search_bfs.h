@@ -1,8 +1,11 @@
 #ifndef TE_GRAPH_SEARCH_BFS_H
 #define TE_GRAPH_SEARCH_BFS_H
 
+#include <list>
 #include <memory>
 #include <queue>
+#include <utility>
+#include <vector>
 
 namespace te
 {
@@ -48,36 +51,32 @@ namespace te
 	private:
 		bool search()
 		{
-			std::queue<const Edge*> q;
-			const Edge start(mSource, mSource, 0);
-			q.push(&start);
+			// Pairs of the node a step comes from and the node it reaches
+			std::queue<std::pair<int, int>> q;
+			q.push({ mSource, mSource });
 			mVisited[mSource] = Visited;
 			while (!q.empty())
 			{
-				const Edge* next = q.front();
+				const std::pair<int, int> next = q.front();
 				q.pop();
-				mRoute[next->getTo()] = next->getFrom();
-				if (next->getTo() == mTarget)
+				mRoute[next.second] = next.first;
+				if (next.second == mTarget)
 				{
 					return true;
 				}
 
-				Graph::ConstEdgeIterator iter(*mpGraph, next->getTo());
-				for (const Edge* pE = iter.begin(); !iter.end(); pE = iter.next())
-				{
-					if (mVisited[pE->getTo()] == Unvisited)
+				mpGraph->forEachEdge(next.second, [this, &q, &next](int to, double) {
+					if (mVisited[to] == Unvisited)
 					{
-						q.push(pE);
-						mVisited[pE->getTo()] = Visited;
+						q.push({ next.second, to });
+						mVisited[to] = Visited;
 					}
-				}
+				});
 			}
 			return false;
 		}
 
 		enum { Visited, Unvisited, NoParentAssigned };
-		typedef typename Graph::Node Node;
-		typedef typename Graph::Edge Edge;
 
 		std::shared_ptr<Graph> mpGraph;
 		int mSource;
@@ -1,9 +1,11 @@
 #ifndef TE_GRAPH_SEARCH_H
 #define TE_GRAPH_SEARCH_H
 
-#include <vector>
-#include <stack>
+#include <list>
 #include <memory>
+#include <stack>
+#include <utility>
+#include <vector>
 
 namespace te
 {
@@ -49,35 +51,31 @@ namespace te
 	private:
 		bool search()
 		{
-			std::stack<const Edge*> stack;
-			Edge start(mSource, mSource, 0);
-			stack.push(&start);
+			// Pairs of the node a step comes from and the node it reaches
+			std::stack<std::pair<int, int>> stack;
+			stack.push({ mSource, mSource });
 
 			while (!stack.empty())
 			{
-				const Edge* next = stack.top();
+				const std::pair<int, int> next = stack.top();
 				stack.pop();
-				mRoute[next->getTo()] = next->getFrom();
-				mVisited[next->getTo()] = Visited;
-				if (next->getTo() == mTarget)
+				mRoute[next.second] = next.first;
+				mVisited[next.second] = Visited;
+				if (next.second == mTarget)
 				{
 					return true;
 				}
-				Graph::ConstEdgeIterator iter(*mpGraph, next->getTo());
-				for (const Edge* pE = iter.begin(); !iter.end(); pE = iter.next())
-				{
-					if (mVisited[pE->getTo()] == Unvisited)
+				mpGraph->forEachEdge(next.second, [this, &stack, &next](int to, double) {
+					if (mVisited[to] == Unvisited)
 					{
-						stack.push(pE);
+						stack.push({ next.second, to });
 					}
-				}
+				});
 			}
 			return false;
 		}
 
 		enum { Visited, Unvisited, NoParentAssigned };
-		typedef typename Graph::Node Node;
-		typedef typename Graph::Edge Edge;
 
 		std::shared_ptr<Graph> mpGraph;
 		int mSource;
@@ -1,9 +1,11 @@
 #ifndef TE_GRAPH_SEARCH_DIJKSTRA_H
 #define TE_GRAPH_SEARCH_DIJKSTRA_H
 
-#include "indexed_priority_queue.h"
+#include "graph_search_workspace.h"
 
+#include <list>
 #include <memory>
+#include <vector>
 
 namespace te
 {
@@ -11,92 +13,114 @@ namespace te
 	class GraphSearchDijkstra
 	{
 	public:
+		typedef GraphSearchWorkspace Workspace;
+
 		GraphSearchDijkstra(const Graph& graph, int source, int target = -1)
 			: mGraph(graph)
-			, mShortestPathTree(mGraph.numNodes())
-			, mCostToThisNode(mGraph.numNodes())
-			, mSearchFrontier(mGraph.numNodes())
+			, mpOwnedWorkspace(std::make_unique<Workspace>())
+			, mWorkspace(*mpOwnedWorkspace)
 			, mSource(source)
 			, mTarget(target)
 		{
 			search();
 		}
 
-		std::vector<const typename Graph::Edge*> getAllPaths() const
+		// Searches in a workspace shared with other searches; the results
+		// are valid until the workspace's next search
+		GraphSearchDijkstra(const Graph& graph, int source, int target, Workspace& workspace)
+			: mGraph(graph)
+			, mpOwnedWorkspace()
+			, mWorkspace(workspace)
+			, mSource(source)
+			, mTarget(target)
 		{
-			return mShortestPathTree;
+			search();
+		}
+
+		// The node each node was settled from, or Workspace::NO_PARENT
+		std::vector<int> getAllPaths() const
+		{
+			std::vector<int> shortestPathTree(mGraph.numNodes());
+			for (int i = 0; i < mGraph.numNodes(); ++i)
+			{
+				shortestPathTree[i] = mWorkspace.getTreeParent(i);
+			}
+			return shortestPathTree;
 		}
 
 		std::list<int> getPathToTarget() const
 		{
-			std::list<int> path;
+			std::vector<int> path;
+			getPathToTarget(path);
+			return std::list<int>(path.begin(), path.end());
+		}
 
-			if (mTarget < 0 || mTarget >= mGraph.numNodes() || mSearchFrontier[mTarget] == 0) return path;
+		// The nodes from the target back to the source, reusing outPath's storage
+		void getPathToTarget(std::vector<int>& outPath) const
+		{
+			outPath.clear();
+
+			if (mTarget < 0 || mTarget >= mGraph.numNodes() || mWorkspace.getFrontierParent(mTarget) == Workspace::NO_PARENT) return;
 
 			int nd = mTarget;
 
-			path.push_back(nd);
+			outPath.push_back(nd);
 
 			while (nd != mSource)
 			{
-				nd = mShortestPathTree[nd]->getFrom();
-				path.push_back(nd);
+				nd = mWorkspace.getTreeParent(nd);
+				outPath.push_back(nd);
 			}
-
-			return path;
 		}
 
 		double getCostToTarget() const
 		{
-			return (mTarget < 0 || mTarget >= mGraph.numNodes() || mSearchFrontier[mTarget] == 0) ?
-				-1.0 : mCostToThisNode[mTarget];
+			return (mTarget < 0 || mTarget >= mGraph.numNodes() || mWorkspace.getFrontierParent(mTarget) == Workspace::NO_PARENT) ?
+				-1.0 : mWorkspace.getGCost(mTarget);
 		}
 
 	private:
-		typedef typename Graph::Node Node;
-		typedef typename Graph::Edge Edge;
-
+		// The queue orders by f-cost, which is kept equal to the cost so far
 		void search()
 		{
-			IndexedPriorityQueue<double> pq(mCostToThisNode);
+			mWorkspace.begin(mGraph.numNodes());
+			mWorkspace.setCosts(mSource, 0, 0);
+			IndexedPriorityQueue<double>& pq = mWorkspace.getQueue();
 			pq.insert(mSource);
 
 			while (!pq.empty())
 			{
 				int nextClosestNode = pq.pop();
-				mShortestPathTree[nextClosestNode] = mSearchFrontier[nextClosestNode];
+				mWorkspace.setTreeParent(nextClosestNode, mWorkspace.getFrontierParent(nextClosestNode));
 
 				if (nextClosestNode == mTarget) return;
 
-				Graph::ConstEdgeIterator constEdgeIter(mGraph, nextClosestNode);
-				for (const Edge* pE = constEdgeIter.begin(); !constEdgeIter.end(); pE = constEdgeIter.next())
-				{
-					double newCost = mCostToThisNode[nextClosestNode] + pE->getCost();
+				const double nextCost = mWorkspace.getGCost(nextClosestNode);
+				mGraph.forEachEdge(nextClosestNode, [&](int to, double cost) {
+					double newCost = nextCost + cost;
 
 					// Edge not ever on frontier
-					if (mSearchFrontier[pE->getTo()] == 0)
+					if (mWorkspace.getFrontierParent(to) == Workspace::NO_PARENT)
 					{
-						mCostToThisNode[pE->getTo()] = newCost;
-						pq.insert(pE->getTo());
-						mSearchFrontier[pE->getTo()] = pE;
+						mWorkspace.setCosts(to, newCost, newCost);
+						pq.insert(to);
+						mWorkspace.setFrontierParent(to, nextClosestNode);
 					}
 
 					// If cost here is cheaper than on record
-					else if ((newCost < mCostToThisNode[pE->getTo()]) && (mShortestPathTree[pE->getTo()] == 0))
+					else if ((newCost < mWorkspace.getGCost(to)) && (mWorkspace.getTreeParent(to) == Workspace::NO_PARENT))
 					{
-						std::vector<size_t> elems = pq.popAll();
-						mCostToThisNode[pE->getTo()] = newCost;
-						pq.assignElements(std::move(elems));
-						mSearchFrontier[pE->getTo()] = pE;
+						mWorkspace.setCosts(to, newCost, newCost);
+						pq.changePriority(to);
+						mWorkspace.setFrontierParent(to, nextClosestNode);
 					}
-				}
+				});
 			}
 		}
 
 		const Graph& mGraph;
-		std::vector<const Edge*> mShortestPathTree;
-		std::vector<double> mCostToThisNode;
-		std::vector<const Edge*> mSearchFrontier;
+		std::unique_ptr<Workspace> mpOwnedWorkspace;
+		Workspace& mWorkspace;
 		int mSource;
 		int mTarget;
 	};
@@ -0,0 +1,108 @@
+#ifndef TE_GRAPH_SEARCH_TIME_SLICED_H
+#define TE_GRAPH_SEARCH_TIME_SLICED_H
+
+#include "graph_search_workspace.h"
+
+#include <vector>
+
+namespace te
+{
+	// A search advanced one node at a time by its owner, so that it can be
+	// spread over several updates. Nothing is searched on construction.
+	class GraphSearchTimeSliced
+	{
+	public:
+		enum Status { SEARCH_INCOMPLETE, TARGET_FOUND, TARGET_NOT_FOUND };
+
+		virtual ~GraphSearchTimeSliced() {}
+
+		// Expands the next node
+		virtual Status cycleOnce() = 0;
+		// The nodes from the target back to the source once it is found
+		virtual void getPathToTarget(std::vector<int>& outPath) const = 0;
+
+		// Cycles until the search ends
+		Status run()
+		{
+			Status status;
+			while ((status = cycleOnce()) == SEARCH_INCOMPLETE);
+			return status;
+		}
+	};
+
+	template <class Graph, class Heuristic>
+	class GraphSearchAStarTimeSliced : public GraphSearchTimeSliced
+	{
+	public:
+		typedef GraphSearchWorkspace Workspace;
+
+		// The workspace is the search's until it ends
+		GraphSearchAStarTimeSliced(const Graph& graph, int source, int target, Workspace& workspace)
+			: mGraph(graph)
+			, mWorkspace(workspace)
+			, mSource(source)
+			, mTarget(target)
+		{
+			mWorkspace.begin(mGraph.numNodes());
+			mWorkspace.setCosts(mSource, 0, 0);
+			mWorkspace.getQueue().insert(mSource);
+		}
+
+		Status cycleOnce()
+		{
+			IndexedPriorityQueue<double>& pq = mWorkspace.getQueue();
+			if (pq.empty()) return TARGET_NOT_FOUND;
+
+			int nextClosestNode = pq.pop();
+			mWorkspace.setTreeParent(nextClosestNode, mWorkspace.getFrontierParent(nextClosestNode));
+
+			if (nextClosestNode == mTarget) return TARGET_FOUND;
+
+			const double nextGCost = mWorkspace.getGCost(nextClosestNode);
+			mGraph.forEachEdge(nextClosestNode, [&](int to, double cost) {
+				double gCost = nextGCost + cost;
+
+				if (mWorkspace.getFrontierParent(to) == Workspace::NO_PARENT)
+				{
+					mWorkspace.setCosts(to, gCost, gCost + Heuristic::calculate(mGraph, mTarget, to));
+					pq.insert(to);
+					mWorkspace.setFrontierParent(to, nextClosestNode);
+				}
+
+				else if ((gCost < mWorkspace.getGCost(to)) && (mWorkspace.getTreeParent(to) == Workspace::NO_PARENT))
+				{
+					mWorkspace.setCosts(to, gCost, gCost + Heuristic::calculate(mGraph, mTarget, to));
+					pq.changePriority(to);
+					mWorkspace.setFrontierParent(to, nextClosestNode);
+				}
+			});
+
+			return SEARCH_INCOMPLETE;
+		}
+
+		void getPathToTarget(std::vector<int>& outPath) const
+		{
+			outPath.clear();
+
+			if (mTarget < 0 || mTarget >= mGraph.numNodes() || mWorkspace.getTreeParent(mTarget) == Workspace::NO_PARENT) return;
+
+			int nd = mTarget;
+
+			outPath.push_back(nd);
+
+			while (nd != mSource)
+			{
+				nd = mWorkspace.getTreeParent(nd);
+				outPath.push_back(nd);
+			}
+		}
+
+	private:
+		const Graph& mGraph;
+		Workspace& mWorkspace;
+		int mSource;
+		int mTarget;
+	};
+}
+
+#endif
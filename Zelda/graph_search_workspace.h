@@ -0,0 +1,116 @@
+#ifndef TE_GRAPH_SEARCH_WORKSPACE_H
+#define TE_GRAPH_SEARCH_WORKSPACE_H
+
+#include "indexed_priority_queue.h"
+
+#include <vector>
+
+namespace te
+{
+	// Per-node costs, parents and the open list of a graph search, kept between
+	// searches. Each search stamps the nodes it touches with a new generation,
+	// so nodes from earlier searches read as unreached without being cleared.
+	class GraphSearchWorkspace
+	{
+	public:
+		enum { NO_PARENT = -1 };
+
+		GraphSearchWorkspace()
+			: mGeneration(0)
+			, mNodes()
+			, mFCosts()
+			, mQueue(mFCosts)
+		{}
+
+		// Starts a search over a graph of numNodes nodes
+		void begin(int numNodes)
+		{
+			if ((int)mNodes.size() < numNodes)
+			{
+				mNodes.resize(numNodes);
+				mFCosts.resize(numNodes, 0);
+			}
+			if (++mGeneration == 0)
+			{
+				for (auto& node : mNodes) node.generation = 0;
+				mGeneration = 1;
+			}
+			mQueue.clear();
+		}
+
+		double getGCost(int node) const
+		{
+			return isTouched(node) ? mNodes[node].gCost : 0;
+		}
+
+		void setCosts(int node, double gCost, double fCost)
+		{
+			touch(node).gCost = gCost;
+			mFCosts[node] = fCost;
+		}
+
+		// The node this one was last reached from, or NO_PARENT
+		int getFrontierParent(int node) const
+		{
+			return isTouched(node) ? mNodes[node].frontierParent : NO_PARENT;
+		}
+
+		void setFrontierParent(int node, int parent)
+		{
+			touch(node).frontierParent = parent;
+		}
+
+		// The node this one was settled from, or NO_PARENT while it is unsettled
+		int getTreeParent(int node) const
+		{
+			return isTouched(node) ? mNodes[node].treeParent : NO_PARENT;
+		}
+
+		void setTreeParent(int node, int parent)
+		{
+			touch(node).treeParent = parent;
+		}
+
+		// Ordered by f-cost
+		IndexedPriorityQueue<double>& getQueue()
+		{
+			return mQueue;
+		}
+
+	private:
+		GraphSearchWorkspace(const GraphSearchWorkspace&) = delete;
+		GraphSearchWorkspace& operator=(const GraphSearchWorkspace&) = delete;
+
+		struct Node
+		{
+			double gCost = 0;
+			int frontierParent = NO_PARENT;
+			int treeParent = NO_PARENT;
+			unsigned int generation = 0;
+		};
+
+		bool isTouched(int node) const
+		{
+			return mNodes[node].generation == mGeneration;
+		}
+
+		Node& touch(int node)
+		{
+			Node& state = mNodes[node];
+			if (state.generation != mGeneration)
+			{
+				state = Node();
+				state.generation = mGeneration;
+				mFCosts[node] = 0;
+			}
+			return state;
+		}
+
+		unsigned int mGeneration;
+		std::vector<Node> mNodes;
+		std::vector<double> mFCosts;
+		IndexedPriorityQueue<double> mQueue;
+	};
+}
+
+#endif
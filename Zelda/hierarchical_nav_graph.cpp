@@ -0,0 +1,572 @@
+#include "hierarchical_nav_graph.h"
+#include "graph_search_a_star.h"
+#include "graph_search_dijkstra.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace te
+{
+	namespace
+	{
+		// Entrances at least this long are crossed at both ends as well as
+		// in the middle
+		const int LONG_ENTRANCE = 6;
+
+		struct PositionedNode
+		{
+			sf::Vector2f position;
+
+			sf::Vector2f getPosition() const
+			{
+				return position;
+			}
+		};
+
+		bool isReached(const GraphSearchWorkspace& workspace, int source, int node)
+		{
+			return node == source || workspace.getTreeParent(node) != GraphSearchWorkspace::NO_PARENT;
+		}
+
+		// A Dijkstra search can queue its source again from a neighbour, which
+		// overwrites the cost it was settled with
+		double getSettledCost(const GraphSearchWorkspace& workspace, int source, int node)
+		{
+			return node == source ? 0 : workspace.getGCost(node);
+		}
+	}
+
+	// The cells of one cluster, or any block of cells, and the steps between them
+	class HierarchicalNavGraph::ClusterGraph
+	{
+	public:
+		ClusterGraph(const HierarchicalNavGraph& graph, int cluster)
+			: mGraph(graph)
+			, mCells(graph.getClusterCells(cluster))
+		{}
+
+		ClusterGraph(const HierarchicalNavGraph& graph, const sf::IntRect& cells)
+			: mGraph(graph)
+			, mCells(cells)
+		{}
+
+		int numNodes() const
+		{
+			return mGraph.mWidth * mGraph.mHeight;
+		}
+
+		PositionedNode getNode(int cell) const
+		{
+			return { mGraph.getCellPosition(cell) };
+		}
+
+		template <class Fn>
+		void forEachEdge(int cell, Fn fn) const
+		{
+			const int x = cell % mGraph.mWidth, y = cell / mGraph.mWidth;
+			for (int dy = -1; dy <= 1; ++dy)
+			{
+				for (int dx = -1; dx <= 1; ++dx)
+				{
+					if ((dx != 0 || dy != 0) && mCells.contains(x + dx, y + dy) && mGraph.isOpen(x + dx, y + dy))
+					{
+						fn(cell + dy * mGraph.mWidth + dx, mGraph.getStepCost(dx, dy));
+					}
+				}
+			}
+		}
+
+	private:
+		const HierarchicalNavGraph& mGraph;
+		sf::IntRect mCells;
+	};
+
+	// The abstract nodes with the source and target of a query after them
+	class HierarchicalNavGraph::AbstractGraph
+	{
+	public:
+		AbstractGraph(const HierarchicalNavGraph& graph, int sourceCell, int targetCell)
+			: mGraph(graph)
+			, mSourceCell(sourceCell)
+			, mTargetCell(targetCell)
+			, mTargetCluster(graph.getCluster(targetCell))
+		{}
+
+		int numNodes() const
+		{
+			return getSource() + 2;
+		}
+
+		int getSource() const
+		{
+			return (int)mGraph.mNodes.size();
+		}
+
+		int getTarget() const
+		{
+			return getSource() + 1;
+		}
+
+		int getCell(int node) const
+		{
+			return node == getSource() ? mSourceCell : node == getTarget() ? mTargetCell : mGraph.mNodes[node].cell;
+		}
+
+		PositionedNode getNode(int node) const
+		{
+			return { mGraph.getCellPosition(getCell(node)) };
+		}
+
+		template <class Fn>
+		void forEachEdge(int node, Fn fn) const
+		{
+			if (node == getSource())
+			{
+				for (const Edge& edge : mGraph.mSourceEdges) fn(edge.to, edge.cost);
+				return;
+			}
+			if (node == getTarget()) return;
+
+			const Node& abstractNode = mGraph.mNodes[node];
+			for (const Edge& edge : abstractNode.edges) fn(edge.to, edge.cost);
+			for (const Edge& edge : abstractNode.crossings) fn(edge.to, edge.cost);
+			if (mGraph.getCluster(abstractNode.cell) == mTargetCluster)
+			{
+				for (const Edge& edge : mGraph.mTargetEdges)
+				{
+					if (edge.to == node) fn(getTarget(), edge.cost);
+				}
+			}
+		}
+
+	private:
+		const HierarchicalNavGraph& mGraph;
+		int mSourceCell;
+		int mTargetCell;
+		int mTargetCluster;
+	};
+
+	HierarchicalNavGraph::HierarchicalNavGraph(const JumpPointGrid& grid, int clusterSize)
+		: mWidth(grid.getWidth())
+		, mHeight(grid.getHeight())
+		, mClusterSize(clusterSize)
+		, mNumClustersX((mWidth + clusterSize - 1) / clusterSize)
+		, mNumClustersY((mHeight + clusterSize - 1) / clusterSize)
+		, mCellSize(grid.getCellSize())
+		, mDiagonalCost(std::sqrt((double)mCellSize.x * mCellSize.x + (double)mCellSize.y * mCellSize.y))
+		, mOpen((size_t)mWidth * mHeight, 0)
+		, mNodes()
+		, mFreeNodes()
+		, mCellNodes((size_t)mWidth * mHeight, -1)
+		, mBuildWorkspace()
+		, mSourceEdges()
+		, mTargetEdges()
+		, mClusterNodes()
+	{
+		if (clusterSize <= 0)
+			throw std::runtime_error("Cluster size must be positive.");
+
+		const int numClusters = mNumClustersX * mNumClustersY;
+		for (auto& borders : mBorders)
+		{
+			borders.resize(numClusters);
+		}
+		for (int y = 0; y < mHeight; ++y)
+		{
+			for (int x = 0; x < mWidth; ++x)
+			{
+				mOpen[y * mWidth + x] = grid.isOpen(x, y);
+			}
+		}
+
+		std::vector<int> clusters(numClusters);
+		for (int cluster = 0; cluster < numClusters; ++cluster)
+		{
+			clusters[cluster] = cluster;
+		}
+		rebuild(clusters);
+	}
+
+	void HierarchicalNavGraph::update(const JumpPointGrid& grid, const std::vector<int>& clusters)
+	{
+		if (grid.getWidth() != mWidth || grid.getHeight() != mHeight)
+			throw std::runtime_error("Grid size does not match the clusters.");
+
+		for (int cluster : clusters)
+		{
+			if (cluster < 0 || cluster >= mNumClustersX * mNumClustersY)
+				throw std::runtime_error("Cluster is outside the grid.");
+
+			const sf::IntRect cells = getClusterCells(cluster);
+			for (int y = cells.top; y < cells.top + cells.height; ++y)
+			{
+				for (int x = cells.left; x < cells.left + cells.width; ++x)
+				{
+					mOpen[y * mWidth + x] = grid.isOpen(x, y);
+				}
+			}
+		}
+
+		if (!clusters.empty())
+		{
+			rebuild(clusters);
+		}
+	}
+
+	int HierarchicalNavGraph::getClusterSize() const
+	{
+		return mClusterSize;
+	}
+
+	int HierarchicalNavGraph::getNumNodes() const
+	{
+		return (int)(mNodes.size() - mFreeNodes.size());
+	}
+
+	bool HierarchicalNavGraph::findPath(sf::Vector2i source, sf::Vector2i target, Workspace& workspace, std::vector<int>& outCells) const
+	{
+		outCells.clear();
+
+		if (!isOpen(source.x, source.y) || !isOpen(target.x, target.y)) return false;
+
+		const int sourceCell = source.y * mWidth + source.x;
+		const int targetCell = target.y * mWidth + target.x;
+		if (sourceCell == targetCell)
+		{
+			outCells.push_back(targetCell);
+			return true;
+		}
+
+		// A short path is searched cell by cell around its ends, as it could be
+		// led a long way round to the few cells its borders are crossed at
+		if (std::max(std::abs(target.x - source.x), std::abs(target.y - source.y)) <= mClusterSize)
+		{
+			const int left = std::max(0, std::min(source.x, target.x) - mClusterSize);
+			const int top = std::max(0, std::min(source.y, target.y) - mClusterSize);
+			const int right = std::min(mWidth, std::max(source.x, target.x) + mClusterSize + 1);
+			const int bottom = std::min(mHeight, std::max(source.y, target.y) + mClusterSize + 1);
+			const ClusterGraph localGraph(*this, sf::IntRect(left, top, right - left, bottom - top));
+			GraphSearchAStar<ClusterGraph, HeuristicEuclid> localSearch(localGraph, sourceCell, targetCell, workspace);
+			localSearch.getPathToTarget(outCells);
+			if (!outCells.empty()) return true;
+		}
+
+		// Join the source and target to the abstract nodes of their clusters
+		AbstractGraph graph(*this, sourceCell, targetCell);
+		const int sourceCluster = getCluster(sourceCell), targetCluster = getCluster(targetCell);
+		mSourceEdges.clear();
+		mTargetEdges.clear();
+
+		const ClusterGraph sourceGraph(*this, sourceCluster);
+		GraphSearchDijkstra<ClusterGraph> sourceSearch(sourceGraph, sourceCell, -1, workspace);
+		getClusterNodes(sourceCluster, mClusterNodes);
+		for (int node : mClusterNodes)
+		{
+			if (isReached(workspace, sourceCell, mNodes[node].cell)) mSourceEdges.push_back({ node, getSettledCost(workspace, sourceCell, mNodes[node].cell) });
+		}
+		if (sourceCluster == targetCluster && isReached(workspace, sourceCell, targetCell))
+		{
+			mSourceEdges.push_back({ graph.getTarget(), getSettledCost(workspace, sourceCell, targetCell) });
+		}
+
+		const ClusterGraph targetGraph(*this, targetCluster);
+		GraphSearchDijkstra<ClusterGraph> targetSearch(targetGraph, targetCell, -1, workspace);
+		getClusterNodes(targetCluster, mClusterNodes);
+		for (int node : mClusterNodes)
+		{
+			if (isReached(workspace, targetCell, mNodes[node].cell)) mTargetEdges.push_back({ node, getSettledCost(workspace, targetCell, mNodes[node].cell) });
+		}
+
+		GraphSearchAStar<AbstractGraph, HeuristicEuclid> search(graph, graph.getSource(), graph.getTarget(), workspace);
+		search.getPathToTarget(outCells);
+		for (int& node : outCells)
+		{
+			node = graph.getCell(node);
+		}
+		return !outCells.empty();
+	}
+
+	bool HierarchicalNavGraph::refinePath(int fromCell, int toCell, Workspace& workspace, std::vector<int>& outCells) const
+	{
+		outCells.clear();
+
+		const int dx = toCell % mWidth - fromCell % mWidth, dy = toCell / mWidth - fromCell / mWidth;
+		if (!isOpen(fromCell % mWidth, fromCell / mWidth) || !isOpen(toCell % mWidth, toCell / mWidth)) return false;
+
+		// Crossing a border, or a step inside a cluster
+		if (std::abs(dx) <= 1 && std::abs(dy) <= 1)
+		{
+			outCells.push_back(toCell);
+			if (toCell != fromCell) outCells.push_back(fromCell);
+			return true;
+		}
+
+		const int cluster = getCluster(fromCell);
+		if (getCluster(toCell) != cluster) return false;
+
+		const ClusterGraph graph(*this, cluster);
+		GraphSearchAStar<ClusterGraph, HeuristicEuclid> search(graph, fromCell, toCell, workspace);
+		search.getPathToTarget(outCells);
+		return !outCells.empty();
+	}
+
+	int HierarchicalNavGraph::getCluster(int cell) const
+	{
+		return (cell / mWidth / mClusterSize) * mNumClustersX + (cell % mWidth) / mClusterSize;
+	}
+
+	sf::IntRect HierarchicalNavGraph::getClusterCells(int cluster) const
+	{
+		const int left = (cluster % mNumClustersX) * mClusterSize;
+		const int top = (cluster / mNumClustersX) * mClusterSize;
+		return { left, top, std::min(mClusterSize, mWidth - left), std::min(mClusterSize, mHeight - top) };
+	}
+
+	void HierarchicalNavGraph::getClusterNodes(int cluster, std::vector<int>& outNodes) const
+	{
+		outNodes.clear();
+		const sf::IntRect cells = getClusterCells(cluster);
+		for (int y = cells.top; y < cells.top + cells.height; ++y)
+		{
+			for (int x = cells.left; x < cells.left + cells.width; ++x)
+			{
+				if (mCellNodes[y * mWidth + x] >= 0) outNodes.push_back(mCellNodes[y * mWidth + x]);
+			}
+		}
+	}
+
+	sf::Vector2f HierarchicalNavGraph::getCellPosition(int cell) const
+	{
+		return { (cell % mWidth + 0.5f) * mCellSize.x, (cell / mWidth + 0.5f) * mCellSize.y };
+	}
+
+	bool HierarchicalNavGraph::isOpen(int x, int y) const
+	{
+		return x >= 0 && x < mWidth && y >= 0 && y < mHeight && mOpen[y * mWidth + x] != 0;
+	}
+
+	double HierarchicalNavGraph::getStepCost(int dx, int dy) const
+	{
+		return dx != 0 && dy != 0 ? mDiagonalCost : dx != 0 ? mCellSize.x : mCellSize.y;
+	}
+
+	void HierarchicalNavGraph::rebuild(const std::vector<int>& clusters)
+	{
+		const int numClusters = mNumClustersX * mNumClustersY;
+
+		// A cluster's crossings depend on the cells on both sides of its
+		// borders, and its neighbours' nodes on the crossings
+		std::vector<char> rebuildBorders[NUM_BORDERS];
+		for (auto& borders : rebuildBorders)
+		{
+			borders.assign(numClusters, 0);
+		}
+		for (int cluster : clusters)
+		{
+			const int x = cluster % mNumClustersX, y = cluster / mNumClustersX;
+			for (int border = 0; border < NUM_BORDERS; ++border)
+			{
+				rebuildBorders[border][cluster] = 1;
+			}
+			if (x > 0) rebuildBorders[EAST][cluster - 1] = 1;
+			if (y > 0) rebuildBorders[SOUTH][cluster - mNumClustersX] = 1;
+			if (x > 0 && y > 0) rebuildBorders[SOUTH_EAST][cluster - mNumClustersX - 1] = 1;
+			if (x + 1 < mNumClustersX && y > 0) rebuildBorders[SOUTH_WEST][cluster - mNumClustersX + 1] = 1;
+		}
+
+		std::vector<char> reconnect(numClusters, 0);
+		for (int cluster : clusters)
+		{
+			reconnect[cluster] = 1;
+		}
+		for (int border = 0; border < NUM_BORDERS; ++border)
+		{
+			for (int cluster = 0; cluster < numClusters; ++cluster)
+			{
+				if (!rebuildBorders[border][cluster]) continue;
+
+				if (rebuildBorder(cluster, (Border)border))
+				{
+					reconnect[cluster] = 1;
+					const int neighbor = getNeighbor(cluster, (Border)border);
+					if (neighbor >= 0) reconnect[neighbor] = 1;
+				}
+			}
+		}
+
+		for (int cluster = 0; cluster < numClusters; ++cluster)
+		{
+			if (reconnect[cluster]) connectNodes(cluster);
+		}
+	}
+
+	bool HierarchicalNavGraph::rebuildBorder(int cluster, Border border)
+	{
+		std::vector<Crossing> crossings;
+		if (getNeighbor(cluster, border) >= 0)
+		{
+			findCrossings(cluster, border, crossings);
+		}
+
+		std::vector<Crossing>& oldCrossings = mBorders[border][cluster];
+		if (std::equal(crossings.begin(), crossings.end(), oldCrossings.begin(), oldCrossings.end(), [](const Crossing& a, const Crossing& b) {
+			return a.from == b.from && a.to == b.to;
+		})) return false;
+
+		auto removeCrossing = [this](int from, int to) {
+			std::vector<Edge>& nodeCrossings = mNodes[from].crossings;
+			nodeCrossings.erase(std::find_if(nodeCrossings.begin(), nodeCrossings.end(), [to](const Edge& edge) {
+				return edge.to == to;
+			}));
+		};
+		for (const Crossing& crossing : oldCrossings)
+		{
+			const int from = mCellNodes[crossing.from], to = mCellNodes[crossing.to];
+			removeCrossing(from, to);
+			removeCrossing(to, from);
+		}
+		for (const Crossing& crossing : crossings)
+		{
+			const int from = addNode(crossing.from), to = addNode(crossing.to);
+			mNodes[from].crossings.push_back({ to, crossing.cost });
+			mNodes[to].crossings.push_back({ from, crossing.cost });
+		}
+		oldCrossings.swap(crossings);
+		return true;
+	}
+
+	void HierarchicalNavGraph::findCrossings(int cluster, Border border, std::vector<Crossing>& crossings) const
+	{
+		const sf::IntRect cells = getClusterCells(cluster);
+		const int right = cells.left + cells.width - 1, bottom = cells.top + cells.height - 1;
+		auto addCrossing = [this, &crossings](int fromX, int fromY, int toX, int toY) {
+			crossings.push_back({ fromY * mWidth + fromX, toY * mWidth + toX, getStepCost(toX - fromX, toY - fromY) });
+		};
+
+		if (border == EAST || border == SOUTH)
+		{
+			// Cells along the border on this side, at i, and the other side
+			const bool isEast = border == EAST;
+			const int length = isEast ? cells.height : cells.width;
+			auto getSide = [&](int i, int side) -> sf::Vector2i {
+				return isEast ? sf::Vector2i(right + side, cells.top + i) : sf::Vector2i(cells.left + i, bottom + side);
+			};
+			auto isSideOpen = [&](int i, int side) {
+				const sf::Vector2i cell = getSide(i, side);
+				return isOpen(cell.x, cell.y);
+			};
+			auto addCrossingAt = [&](int from, int to) {
+				const sf::Vector2i a = getSide(from, 0), b = getSide(to, 1);
+				addCrossing(a.x, a.y, b.x, b.y);
+			};
+
+			// One crossing per run of cells open on both sides, which connects
+			// the cells of the run on each side, and one at either end of a long run
+			for (int i = 0; i < length;)
+			{
+				if (!isSideOpen(i, 0) || !isSideOpen(i, 1))
+				{
+					++i;
+					continue;
+				}
+				int end = i;
+				while (end + 1 < length && isSideOpen(end + 1, 0) && isSideOpen(end + 1, 1)) ++end;
+				addCrossingAt((i + end) / 2, (i + end) / 2);
+				if (end - i + 1 >= LONG_ENTRANCE)
+				{
+					addCrossingAt(i, i);
+					addCrossingAt(end, end);
+				}
+				i = end + 1;
+			}
+
+			// Diagonal steps across the border where no run passes either end
+			for (int i = 0; i + 1 < length; ++i)
+			{
+				if (isSideOpen(i, 0) && isSideOpen(i + 1, 1) && !isSideOpen(i, 1) && !isSideOpen(i + 1, 0)) addCrossingAt(i, i + 1);
+				if (isSideOpen(i + 1, 0) && isSideOpen(i, 1) && !isSideOpen(i + 1, 1) && !isSideOpen(i, 0)) addCrossingAt(i + 1, i);
+			}
+		}
+		else if (border == SOUTH_EAST)
+		{
+			if (isOpen(right, bottom) && isOpen(right + 1, bottom + 1)) addCrossing(right, bottom, right + 1, bottom + 1);
+		}
+		else
+		{
+			if (isOpen(cells.left, bottom) && isOpen(cells.left - 1, bottom + 1)) addCrossing(cells.left, bottom, cells.left - 1, bottom + 1);
+		}
+
+	}
+
+	int HierarchicalNavGraph::getNeighbor(int cluster, Border border) const
+	{
+		const int x = cluster % mNumClustersX, y = cluster / mNumClustersX;
+		const bool hasEast = x + 1 < mNumClustersX, hasWest = x > 0, hasSouth = y + 1 < mNumClustersY;
+		switch (border)
+		{
+		case EAST:
+			return hasEast ? cluster + 1 : -1;
+		case SOUTH:
+			return hasSouth ? cluster + mNumClustersX : -1;
+		case SOUTH_EAST:
+			return hasEast && hasSouth ? cluster + mNumClustersX + 1 : -1;
+		default:
+			return hasWest && hasSouth ? cluster + mNumClustersX - 1 : -1;
+		}
+	}
+
+	int HierarchicalNavGraph::addNode(int cell)
+	{
+		if (mCellNodes[cell] >= 0) return mCellNodes[cell];
+
+		int node;
+		if (!mFreeNodes.empty())
+		{
+			node = mFreeNodes.back();
+			mFreeNodes.pop_back();
+		}
+		else
+		{
+			node = (int)mNodes.size();
+			mNodes.push_back(Node());
+		}
+		mNodes[node].cell = cell;
+		mCellNodes[cell] = node;
+		return node;
+	}
+
+	void HierarchicalNavGraph::connectNodes(int cluster)
+	{
+		// Drop the nodes no crossing uses any more
+		getClusterNodes(cluster, mClusterNodes);
+		for (int node : mClusterNodes)
+		{
+			if (mNodes[node].crossings.empty())
+			{
+				mCellNodes[mNodes[node].cell] = -1;
+				mNodes[node].cell = -1;
+				mNodes[node].edges.clear();
+				mFreeNodes.push_back(node);
+			}
+		}
+		getClusterNodes(cluster, mClusterNodes);
+
+		const ClusterGraph graph(*this, cluster);
+		for (int node : mClusterNodes)
+		{
+			const int cell = mNodes[node].cell;
+			std::vector<Edge>& edges = mNodes[node].edges;
+			edges.clear();
+			GraphSearchDijkstra<ClusterGraph> search(graph, cell, -1, mBuildWorkspace);
+			for (int other : mClusterNodes)
+			{
+				if (other != node && isReached(mBuildWorkspace, cell, mNodes[other].cell))
+				{
+					edges.push_back({ other, getSettledCost(mBuildWorkspace, cell, mNodes[other].cell) });
+				}
+			}
+		}
+	}
+}
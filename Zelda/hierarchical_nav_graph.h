@@ -0,0 +1,117 @@
+#ifndef TE_HIERARCHICAL_NAV_GRAPH_H
+#define TE_HIERARCHICAL_NAV_GRAPH_H
+
+#include "graph_search_workspace.h"
+#include "jump_point_search.h"
+
+#include <SFML/Graphics.hpp>
+
+#include <vector>
+
+namespace te
+{
+	// The open cells of a grid split into square clusters. Wherever two
+	// clusters touch, the cells a path can cross between them on become
+	// abstract nodes, joined across the border and to the other abstract nodes
+	// of their cluster by the cost of the shortest path inside it. Long paths
+	// are found over this small graph and each stretch through a cluster is
+	// only searched cell by cell when it is needed.
+	class HierarchicalNavGraph
+	{
+	public:
+		typedef GraphSearchWorkspace Workspace;
+
+		HierarchicalNavGraph(const JumpPointGrid& grid, int clusterSize);
+
+		// Rereads the cells of the given clusters from the grid and rebuilds
+		// them, and their neighbours
+		void update(const JumpPointGrid& grid, const std::vector<int>& clusters);
+
+		int getClusterSize() const;
+		int getNumNodes() const;
+		// The cluster of the cell at y * width + x
+		int getCluster(int cell) const;
+
+		// The cells the path from source to target turns through, from the
+		// target back to the source. Consecutive cells are either neighbours
+		// or in the same cluster; see refinePath. Paths no longer than a
+		// cluster are searched cell by cell. False if there is no path.
+		bool findPath(sf::Vector2i source, sf::Vector2i target, Workspace& workspace, std::vector<int>& outCells) const;
+		// The cells from cell to cell of a path from findPath, from the target
+		// back to the source. False if they are no longer connected.
+		bool refinePath(int fromCell, int toCell, Workspace& workspace, std::vector<int>& outCells) const;
+
+	private:
+		HierarchicalNavGraph(const HierarchicalNavGraph&) = delete;
+		HierarchicalNavGraph& operator=(const HierarchicalNavGraph&) = delete;
+
+		class ClusterGraph;
+		class AbstractGraph;
+
+		// Which neighbour of a cluster a border is shared with; the other four
+		// borders of a cluster belong to the neighbours it is shared with
+		enum Border { EAST, SOUTH, SOUTH_EAST, SOUTH_WEST, NUM_BORDERS };
+
+		struct Edge
+		{
+			int to;
+			double cost;
+		};
+
+		struct Node
+		{
+			int cell;
+			// To the other nodes of the cluster, then to nodes across its borders
+			std::vector<Edge> edges;
+			std::vector<Edge> crossings;
+		};
+
+		struct Crossing
+		{
+			int from;
+			int to;
+			double cost;
+		};
+
+		sf::IntRect getClusterCells(int cluster) const;
+		void getClusterNodes(int cluster, std::vector<int>& outNodes) const;
+		sf::Vector2f getCellPosition(int cell) const;
+		bool isOpen(int x, int y) const;
+		double getStepCost(int dx, int dy) const;
+
+		void rebuild(const std::vector<int>& clusters);
+		// False if the border's crossings are unchanged
+		bool rebuildBorder(int cluster, Border border);
+		void findCrossings(int cluster, Border border, std::vector<Crossing>& crossings) const;
+		// Any neighbour of cluster across border, or -1
+		int getNeighbor(int cluster, Border border) const;
+		// The node at cell, added if there is none
+		int addNode(int cell);
+		// Drops the cluster's unused nodes and joins the rest by their paths
+		// inside the cluster
+		void connectNodes(int cluster);
+
+		int mWidth;
+		int mHeight;
+		int mClusterSize;
+		int mNumClustersX;
+		int mNumClustersY;
+		sf::Vector2f mCellSize;
+		double mDiagonalCost;
+		std::vector<char> mOpen;
+		std::vector<Node> mNodes;
+		std::vector<int> mFreeNodes;
+		// The node at each cell, or -1
+		std::vector<int> mCellNodes;
+		// Per border kind, the crossings from each cluster to its neighbour
+		std::vector<std::vector<Crossing>> mBorders[NUM_BORDERS];
+		Workspace mBuildWorkspace;
+
+		// Kept between queries so they reuse their storage
+		mutable std::vector<Edge> mSourceEdges;
+		mutable std::vector<Edge> mTargetEdges;
+		mutable std::vector<int> mClusterNodes;
+	};
+}
+
+#endif
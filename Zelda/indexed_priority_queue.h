@@ -1,57 +1,125 @@
 #ifndef TE_INDEXED_PRIORITY_QUEUE_H
 #define TE_INDEXED_PRIORITY_QUEUE_H
 
-#include <queue>
+#include <algorithm>
+#include <vector>
 
 namespace te
 {
-	template <class T>
+	// A d-ary min-heap of indices into keys. Each queued index's position in the
+	// heap is tracked, so lowering or raising its key only moves that index.
+	template <class Key, size_t Arity = 4>
 	class IndexedPriorityQueue
 	{
 	public:
-		IndexedPriorityQueue(const std::vector<T>& keys)
-			: mCompare([&keys](size_t lhs, size_t rhs) { return keys.at(lhs) > keys.at(rhs); })
-			, mPriorityQueue(mCompare)
+		IndexedPriorityQueue(const std::vector<Key>& keys)
+			: mKeys(keys)
+			, mHeap()
+			, mPositions(keys.size(), NOT_QUEUED)
 		{
+			static_assert(Arity >= 2, "A heap needs at least two children per node");
 		}
 
 		void insert(size_t index)
 		{
-			mPriorityQueue.push(index);
+			mPositions[index] = mHeap.size();
+			mHeap.push_back(index);
+			siftUp(mHeap.size() - 1);
 		}
 
 		bool empty() const
 		{
-			return mPriorityQueue.empty();
+			return mHeap.empty();
+		}
+
+		bool contains(size_t index) const
+		{
+			return mPositions[index] != NOT_QUEUED;
 		}
 
 		size_t pop()
 		{
-			size_t index = mPriorityQueue.top();
-			mPriorityQueue.pop();
+			const size_t index = mHeap.front();
+			mPositions[index] = NOT_QUEUED;
+			const size_t last = mHeap.back();
+			mHeap.pop_back();
+			if (!mHeap.empty())
+			{
+				place(0, last);
+				siftDown(0);
+			}
 			return index;
 		}
 
-		std::vector<size_t> popAll()
+		// Empties the queue and makes room for every index of the keys, which
+		// may have grown since the queue was made
+		void clear()
 		{
-			std::vector<size_t> elems;
-			elems.reserve(mPriorityQueue.size());
-			while (!mPriorityQueue.empty())
+			for (size_t index : mHeap)
 			{
-				elems.push_back(pop());
+				mPositions[index] = NOT_QUEUED;
 			}
-			return elems;
+			mHeap.clear();
+			mPositions.resize(mKeys.size(), NOT_QUEUED);
 		}
 
-		void assignElements(std::vector<size_t>&& elems)
+		// Restores the heap after the key of a queued index has changed
+		void changePriority(size_t index)
 		{
-			mPriorityQueue = std::priority_queue<size_t, std::vector<size_t>, std::function<bool(size_t, size_t)>>(mCompare, std::move(elems));
+			siftUp(mPositions[index]);
+			siftDown(mPositions[index]);
 		}
 
 	private:
-		std::function<bool(size_t, size_t)> mCompare;
-		std::priority_queue<size_t, std::vector<size_t>, std::function<bool(size_t, size_t)>> mPriorityQueue;
+		static const size_t NOT_QUEUED = (size_t)-1;
+
+		void place(size_t position, size_t index)
+		{
+			mHeap[position] = index;
+			mPositions[index] = position;
+		}
+
+		void siftUp(size_t position)
+		{
+			const size_t index = mHeap[position];
+			while (position > 0)
+			{
+				const size_t parent = (position - 1) / Arity;
+				if (!(mKeys[index] < mKeys[mHeap[parent]])) break;
+				place(position, mHeap[parent]);
+				position = parent;
+			}
+			place(position, index);
+		}
+
+		void siftDown(size_t position)
+		{
+			const size_t index = mHeap[position];
+			const size_t size = mHeap.size();
+			for (;;)
+			{
+				const size_t first = position * Arity + 1;
+				if (first >= size) break;
+				const size_t last = std::min(first + Arity, size);
+				size_t smallest = first;
+				for (size_t child = first + 1; child < last; ++child)
+				{
+					if (mKeys[mHeap[child]] < mKeys[mHeap[smallest]]) smallest = child;
+				}
+				if (!(mKeys[mHeap[smallest]] < mKeys[index])) break;
+				place(position, mHeap[smallest]);
+				position = smallest;
+			}
+			place(position, index);
+		}
+
+		const std::vector<Key>& mKeys;
+		std::vector<size_t> mHeap;
+		std::vector<size_t> mPositions;
 	};
+
+	template <class Key, size_t Arity>
+	const size_t IndexedPriorityQueue<Key, Arity>::NOT_QUEUED;
 }
 
 #endif
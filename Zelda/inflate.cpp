@@ -0,0 +1,428 @@
+#include "inflate.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace te
+{
+	namespace
+	{
+		const int MAX_BITS = 15;
+		const int MAX_LENGTH_CODES = 286;
+		const int MAX_DIST_CODES = 30;
+		const int FIXED_LENGTH_CODES = 288;
+		// Distances reach at most this far back into the output
+		const size_t WINDOW_SIZE = 32 * 1024;
+		// Output gathered between calls to the sink
+		const size_t CHUNK_SIZE = 32 * 1024;
+
+		const short LENGTH_BASE[29] = {
+			3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+			35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		const short LENGTH_EXTRA[29] = {
+			0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+			3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		const short DIST_BASE[30] = {
+			1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+			257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+			8193, 12289, 16385, 24577 };
+		const short DIST_EXTRA[30] = {
+			0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+			7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+		struct Huffman
+		{
+			short count[MAX_BITS + 1];
+			short symbol[FIXED_LENGTH_CODES];
+		};
+
+		struct FixedCodes
+		{
+			Huffman lencode;
+			Huffman distcode;
+		};
+
+		unsigned long crc32(unsigned long crc, const unsigned char* pData, size_t length)
+		{
+			static const std::array<unsigned long, 256> TABLE = [] {
+				std::array<unsigned long, 256> table;
+				for (unsigned long n = 0; n < 256; ++n)
+				{
+					unsigned long c = n;
+					for (int k = 0; k < 8; ++k)
+						c = (c & 1) ? 0xedb88320UL ^ (c >> 1) : c >> 1;
+					table[n] = c;
+				}
+				return table;
+			}();
+
+			crc ^= 0xffffffffUL;
+			for (size_t i = 0; i < length; ++i)
+				crc = TABLE[(crc ^ pData[i]) & 0xff] ^ (crc >> 8);
+			return crc ^ 0xffffffffUL;
+		}
+
+		void adler32(unsigned long& a, unsigned long& b, const unsigned char* pData, size_t length)
+		{
+			for (size_t i = 0; i < length; ++i)
+			{
+				a = (a + pData[i]) % 65521;
+				b = (b + a) % 65521;
+			}
+		}
+
+		// Canonical Huffman decoder for RFC 1951 streams.
+		class Inflater
+		{
+		public:
+			Inflater(const unsigned char* pSrc, size_t srcLength, size_t maxLength, const InflateSink& sink)
+				: mpIn(pSrc), mInLength(srcLength), mInPos(0)
+				, mBitBuf(0), mBitCount(0)
+				, mSink(sink), mMaxLength(maxLength), mLength(0)
+				, mWindow(WINDOW_SIZE + CHUNK_SIZE), mOutPos(0), mFlushedPos(0)
+			{}
+
+			size_t run()
+			{
+				int last;
+				do
+				{
+					last = bits(1);
+					int type = bits(2);
+					switch (type)
+					{
+					case 0: stored(); break;
+					case 1: fixed(); break;
+					case 2: dynamic(); break;
+					default: throw std::runtime_error("Invalid deflate block type.");
+					}
+				} while (!last);
+				flush();
+				return mLength;
+			}
+
+			size_t getInputPosition() const
+			{
+				return mInPos;
+			}
+
+		private:
+			int bits(int need)
+			{
+				long val = mBitBuf;
+				while (mBitCount < need)
+				{
+					if (mInPos == mInLength) throw std::runtime_error("Deflate stream is truncated.");
+					val |= (long)mpIn[mInPos++] << mBitCount;
+					mBitCount += 8;
+				}
+				mBitBuf = (int)(val >> need);
+				mBitCount -= need;
+				return (int)(val & ((1L << need) - 1));
+			}
+
+			void flush()
+			{
+				if (mOutPos > mFlushedPos) mSink(mWindow.data() + mFlushedPos, mOutPos - mFlushedPos);
+				mFlushedPos = mOutPos;
+			}
+
+			// Makes room for length more bytes, sliding the window along if needed
+			void reserve(size_t length)
+			{
+				if (mLength + length > mMaxLength) throw std::runtime_error("Inflated data exceeds the expected size.");
+				if (mOutPos + length <= mWindow.size()) return;
+
+				flush();
+				const size_t keep = std::min(mOutPos, WINDOW_SIZE);
+				std::memmove(mWindow.data(), mWindow.data() + mOutPos - keep, keep);
+				mOutPos = keep;
+				mFlushedPos = keep;
+			}
+
+			void put(unsigned char byte)
+			{
+				reserve(1);
+				mWindow[mOutPos++] = byte;
+				++mLength;
+			}
+
+			void stored()
+			{
+				mBitBuf = 0;
+				mBitCount = 0;
+
+				if (mInPos + 4 > mInLength) throw std::runtime_error("Deflate stream is truncated.");
+				unsigned len = mpIn[mInPos] | (mpIn[mInPos + 1] << 8);
+				unsigned nlen = mpIn[mInPos + 2] | (mpIn[mInPos + 3] << 8);
+				mInPos += 4;
+				if (len != (~nlen & 0xffff)) throw std::runtime_error("Stored deflate block length is corrupt.");
+				if (mInPos + len > mInLength) throw std::runtime_error("Deflate stream is truncated.");
+
+				while (len > 0)
+				{
+					const unsigned part = (unsigned)std::min<size_t>(len, CHUNK_SIZE);
+					reserve(part);
+					std::memcpy(mWindow.data() + mOutPos, mpIn + mInPos, part);
+					mInPos += part;
+					mOutPos += part;
+					mLength += part;
+					len -= part;
+				}
+			}
+
+			int decode(const Huffman& h)
+			{
+				int code = 0, first = 0, index = 0;
+				for (int len = 1; len <= MAX_BITS; ++len)
+				{
+					code |= bits(1);
+					int count = h.count[len];
+					if (code - count < first)
+						return h.symbol[index + (code - first)];
+					index += count;
+					first += count;
+					first <<= 1;
+					code <<= 1;
+				}
+				throw std::runtime_error("Invalid Huffman code in deflate stream.");
+			}
+
+			static int construct(Huffman& h, const short* lengths, int n)
+			{
+				std::memset(h.count, 0, sizeof(h.count));
+				for (int symbol = 0; symbol < n; ++symbol)
+					++h.count[lengths[symbol]];
+				if (h.count[0] == n) return 0;
+
+				int left = 1;
+				for (int len = 1; len <= MAX_BITS; ++len)
+				{
+					left <<= 1;
+					left -= h.count[len];
+					if (left < 0) return left;
+				}
+
+				short offs[MAX_BITS + 1];
+				offs[1] = 0;
+				for (int len = 1; len < MAX_BITS; ++len)
+					offs[len + 1] = offs[len] + h.count[len];
+
+				for (int symbol = 0; symbol < n; ++symbol)
+					if (lengths[symbol] != 0)
+						h.symbol[offs[lengths[symbol]]++] = (short)symbol;
+
+				return left;
+			}
+
+			void codes(const Huffman& lencode, const Huffman& distcode)
+			{
+				int symbol;
+				do
+				{
+					symbol = decode(lencode);
+					if (symbol < 256)
+					{
+						put((unsigned char)symbol);
+					}
+					else if (symbol > 256)
+					{
+						symbol -= 257;
+						if (symbol >= 29) throw std::runtime_error("Invalid length symbol in deflate stream.");
+						size_t len = LENGTH_BASE[symbol] + bits(LENGTH_EXTRA[symbol]);
+
+						symbol = decode(distcode);
+						if (symbol >= 30) throw std::runtime_error("Invalid distance symbol in deflate stream.");
+						size_t dist = DIST_BASE[symbol] + bits(DIST_EXTRA[symbol]);
+						if (dist > mLength) throw std::runtime_error("Deflate distance is too far back.");
+						reserve(len);
+						mLength += len;
+
+						// Copies may overlap their own output, so go byte by byte
+						for (; len > 0; --len, ++mOutPos)
+							mWindow[mOutPos] = mWindow[mOutPos - dist];
+					}
+				} while (symbol != 256);
+			}
+
+			void fixed()
+			{
+				// Built once, on first use from whichever thread gets there
+				static const FixedCodes FIXED = [] {
+					FixedCodes codes;
+					short lengths[FIXED_LENGTH_CODES];
+					int symbol = 0;
+					for (; symbol < 144; ++symbol) lengths[symbol] = 8;
+					for (; symbol < 256; ++symbol) lengths[symbol] = 9;
+					for (; symbol < 280; ++symbol) lengths[symbol] = 7;
+					for (; symbol < FIXED_LENGTH_CODES; ++symbol) lengths[symbol] = 8;
+					construct(codes.lencode, lengths, FIXED_LENGTH_CODES);
+
+					for (symbol = 0; symbol < MAX_DIST_CODES; ++symbol) lengths[symbol] = 5;
+					construct(codes.distcode, lengths, MAX_DIST_CODES);
+					return codes;
+				}();
+				codes(FIXED.lencode, FIXED.distcode);
+			}
+
+			void dynamic()
+			{
+				static const short ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+				int nlen = bits(5) + 257;
+				int ndist = bits(5) + 1;
+				int ncode = bits(4) + 4;
+				if (nlen > MAX_LENGTH_CODES || ndist > MAX_DIST_CODES)
+					throw std::runtime_error("Invalid code counts in deflate stream.");
+
+				short lengths[MAX_LENGTH_CODES + MAX_DIST_CODES];
+				int index = 0;
+				for (; index < ncode; ++index) lengths[ORDER[index]] = (short)bits(3);
+				for (; index < 19; ++index) lengths[ORDER[index]] = 0;
+
+				Huffman lencode, distcode;
+				if (construct(lencode, lengths, 19) != 0)
+					throw std::runtime_error("Incomplete code length code in deflate stream.");
+
+				index = 0;
+				while (index < nlen + ndist)
+				{
+					int symbol = decode(lencode);
+					if (symbol < 16)
+					{
+						lengths[index++] = (short)symbol;
+						continue;
+					}
+
+					short len = 0;
+					if (symbol == 16)
+					{
+						if (index == 0) throw std::runtime_error("Repeat with no previous length in deflate stream.");
+						len = lengths[index - 1];
+						symbol = 3 + bits(2);
+					}
+					else if (symbol == 17)
+					{
+						symbol = 3 + bits(3);
+					}
+					else
+					{
+						symbol = 11 + bits(7);
+					}
+					if (index + symbol > nlen + ndist)
+						throw std::runtime_error("Too many code lengths in deflate stream.");
+					while (symbol--) lengths[index++] = len;
+				}
+
+				if (lengths[256] == 0)
+					throw std::runtime_error("Deflate block has no end-of-block code.");
+
+				int err = construct(lencode, lengths, nlen);
+				if (err < 0 || (err > 0 && nlen - lencode.count[0] != 1))
+					throw std::runtime_error("Invalid literal/length code in deflate stream.");
+
+				err = construct(distcode, lengths + nlen, ndist);
+				if (err < 0 || (err > 0 && ndist - distcode.count[0] != 1))
+					throw std::runtime_error("Invalid distance code in deflate stream.");
+
+				codes(lencode, distcode);
+			}
+
+			const unsigned char* mpIn;
+			size_t mInLength;
+			size_t mInPos;
+			int mBitBuf;
+			int mBitCount;
+			InflateSink mSink;
+			size_t mMaxLength;
+			size_t mLength;
+			// The output not yet handed to the sink, after as much of the output
+			// before it as distances can reach
+			std::vector<unsigned char> mWindow;
+			size_t mOutPos;
+			size_t mFlushedPos;
+		};
+	}
+
+	size_t inflate(const unsigned char* pSrc, size_t srcLength, size_t maxLength, const InflateSink& sink)
+	{
+		return Inflater(pSrc, srcLength, maxLength, sink).run();
+	}
+
+	size_t inflateZlib(const unsigned char* pSrc, size_t srcLength, size_t maxLength, const InflateSink& sink)
+	{
+		if (srcLength < 6)
+			throw std::runtime_error("Zlib stream is truncated.");
+		const unsigned cmf = pSrc[0], flg = pSrc[1];
+		if ((cmf & 0x0f) != 8 || ((cmf << 8) | flg) % 31 != 0 || (flg & 0x20) != 0)
+			throw std::runtime_error("Unsupported zlib stream header.");
+
+		unsigned long a = 1, b = 0;
+		Inflater inflater(pSrc + 2, srcLength - 6, maxLength, [&a, &b, &sink](const unsigned char* pData, size_t length) {
+			adler32(a, b, pData, length);
+			sink(pData, length);
+		});
+		size_t length = inflater.run();
+
+		const unsigned char* pAdler = pSrc + 2 + inflater.getInputPosition();
+		if (pAdler + 4 > pSrc + srcLength)
+			throw std::runtime_error("Zlib stream is truncated.");
+		unsigned long expected = ((unsigned long)pAdler[0] << 24) | ((unsigned long)pAdler[1] << 16) | ((unsigned long)pAdler[2] << 8) | pAdler[3];
+		if (((b << 16) | a) != expected)
+			throw std::runtime_error("Zlib checksum mismatch.");
+
+		return length;
+	}
+
+	size_t inflateGzip(const unsigned char* pSrc, size_t srcLength, size_t maxLength, const InflateSink& sink)
+	{
+		enum { FHCRC = 0x02, FEXTRA = 0x04, FNAME = 0x08, FCOMMENT = 0x10 };
+
+		if (srcLength < 18 || pSrc[0] != 0x1f || pSrc[1] != 0x8b || pSrc[2] != 8)
+			throw std::runtime_error("Unsupported gzip stream header.");
+
+		const unsigned flags = pSrc[3];
+		size_t pos = 10;
+		if (flags & FEXTRA)
+		{
+			if (pos + 2 > srcLength) throw std::runtime_error("Gzip stream is truncated.");
+			pos += 2 + (pSrc[pos] | (pSrc[pos + 1] << 8));
+		}
+		if (flags & FNAME)
+		{
+			while (pos < srcLength && pSrc[pos] != 0) ++pos;
+			++pos;
+		}
+		if (flags & FCOMMENT)
+		{
+			while (pos < srcLength && pSrc[pos] != 0) ++pos;
+			++pos;
+		}
+		if (flags & FHCRC)
+		{
+			pos += 2;
+		}
+		if (pos + 8 > srcLength)
+			throw std::runtime_error("Gzip stream is truncated.");
+
+		unsigned long crc = 0;
+		Inflater inflater(pSrc + pos, srcLength - pos - 8, maxLength, [&crc, &sink](const unsigned char* pData, size_t length) {
+			crc = crc32(crc, pData, length);
+			sink(pData, length);
+		});
+		size_t length = inflater.run();
+
+		const unsigned char* pTrailer = pSrc + pos + inflater.getInputPosition();
+		unsigned long expected = pTrailer[0] | ((unsigned long)pTrailer[1] << 8) | ((unsigned long)pTrailer[2] << 16) | ((unsigned long)pTrailer[3] << 24);
+		if (crc != expected)
+			throw std::runtime_error("Gzip checksum mismatch.");
+		unsigned long size = pTrailer[4] | ((unsigned long)pTrailer[5] << 8) | ((unsigned long)pTrailer[6] << 16) | ((unsigned long)pTrailer[7] << 24);
+		if (size != (length & 0xffffffffUL))
+			throw std::runtime_error("Gzip size mismatch.");
+
+		return length;
+	}
+}
@@ -0,0 +1,22 @@
+#ifndef TE_INFLATE_H
+#define TE_INFLATE_H
+
+#include <cstddef>
+#include <functional>
+
+namespace te
+{
+	// Receives inflated bytes a chunk at a time, in order
+	typedef std::function<void(const unsigned char* pData, size_t length)> InflateSink;
+
+	// Decompressors for the layer data formats Tiled writes. Only a window of
+	// the most recent output is kept; the rest is handed to sink as it is
+	// produced. Each returns the number of bytes produced and throws
+	// std::runtime_error on malformed input or if the output would be longer
+	// than maxLength.
+	size_t inflate(const unsigned char* pSrc, size_t srcLength, size_t maxLength, const InflateSink& sink);
+	size_t inflateZlib(const unsigned char* pSrc, size_t srcLength, size_t maxLength, const InflateSink& sink);
+	size_t inflateGzip(const unsigned char* pSrc, size_t srcLength, size_t maxLength, const InflateSink& sink);
+}
+
+#endif
@@ -0,0 +1,310 @@
+#include "jump_point_search.h"
+
+#include <cmath>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace te
+{
+	namespace
+	{
+		const int BITS_PER_WORD = 64;
+
+		int sign(int value)
+		{
+			return (value > 0) - (value < 0);
+		}
+
+		// Index of the lowest and highest set bit of a non-zero word
+		int lowestBit(std::uint64_t word)
+		{
+#if defined(_MSC_VER)
+			unsigned long index;
+			if (_BitScanForward(&index, (unsigned long)word)) return (int)index;
+			_BitScanForward(&index, (unsigned long)(word >> 32));
+			return (int)index + 32;
+#else
+			return __builtin_ctzll(word);
+#endif
+		}
+
+		int highestBit(std::uint64_t word)
+		{
+#if defined(_MSC_VER)
+			unsigned long index;
+			if (_BitScanReverse(&index, (unsigned long)(word >> 32))) return (int)index + 32;
+			_BitScanReverse(&index, (unsigned long)word);
+			return (int)index;
+#else
+			return 63 - __builtin_clzll(word);
+#endif
+		}
+	}
+
+	JumpPointGrid::JumpPointGrid(const OccupancyGrid& grid)
+		: mWidth(grid.getNumCellsX())
+		, mHeight(grid.getNumCellsY())
+		, mCellSize(grid.getCellSize())
+		, mWordsPerRow((mWidth + BITS_PER_WORD - 1) / BITS_PER_WORD)
+		, mWordsPerColumn((mHeight + BITS_PER_WORD - 1) / BITS_PER_WORD)
+		, mRows((size_t)mWordsPerRow * mHeight, 0)
+		, mColumns((size_t)mWordsPerColumn * mWidth, 0)
+	{
+		for (int y = 0; y < mHeight; ++y)
+		{
+			for (int x = 0; x < mWidth; ++x)
+			{
+				if (grid.isSolid(x, y)) continue;
+				mRows[y * mWordsPerRow + x / BITS_PER_WORD] |= std::uint64_t(1) << (x % BITS_PER_WORD);
+				mColumns[x * mWordsPerColumn + y / BITS_PER_WORD] |= std::uint64_t(1) << (y % BITS_PER_WORD);
+			}
+		}
+	}
+
+	int JumpPointGrid::getWidth() const
+	{
+		return mWidth;
+	}
+
+	int JumpPointGrid::getHeight() const
+	{
+		return mHeight;
+	}
+
+	sf::Vector2f JumpPointGrid::getCellSize() const
+	{
+		return mCellSize;
+	}
+
+	bool JumpPointGrid::isOpen(int x, int y) const
+	{
+		if (x < 0 || x >= mWidth || y < 0 || y >= mHeight) return false;
+		return ((mRows[y * mWordsPerRow + x / BITS_PER_WORD] >> (x % BITS_PER_WORD)) & 1) != 0;
+	}
+
+	void JumpPointGrid::setOpen(int x, int y, bool open)
+	{
+		if (x < 0 || x >= mWidth || y < 0 || y >= mHeight) return;
+		std::uint64_t& row = mRows[y * mWordsPerRow + x / BITS_PER_WORD];
+		std::uint64_t& column = mColumns[x * mWordsPerColumn + y / BITS_PER_WORD];
+		const std::uint64_t rowBit = std::uint64_t(1) << (x % BITS_PER_WORD);
+		const std::uint64_t columnBit = std::uint64_t(1) << (y % BITS_PER_WORD);
+		if (open)
+		{
+			row |= rowBit;
+			column |= columnBit;
+		}
+		else
+		{
+			row &= ~rowBit;
+			column &= ~columnBit;
+		}
+	}
+
+	int JumpPointGrid::jumpStraight(int x, int y, int dx, int dy, sf::Vector2i target) const
+	{
+		if (dx != 0)
+		{
+			const int stop = scan(mRows, mWordsPerRow, mHeight, y, x, dx, target.y == y ? target.x : -1);
+			return stop < 0 ? -1 : y * mWidth + stop;
+		}
+		const int stop = scan(mColumns, mWordsPerColumn, mWidth, x, y, dy, target.x == x ? target.y : -1);
+		return stop < 0 ? -1 : stop * mWidth + x;
+	}
+
+	int JumpPointGrid::scan(const std::vector<std::uint64_t>& bits, int wordsPerLine, int numLines, int line, int pos, int step, int targetPos)
+	{
+		auto getWord = [&](int l, int w) -> std::uint64_t {
+			return l < 0 || l >= numLines || w < 0 || w >= wordsPerLine ? 0 : bits[l * wordsPerLine + w];
+		};
+
+		const int start = pos + step;
+		if (start < 0) return -1;
+		int w = start / BITS_PER_WORD;
+		// Only the first word holds cells behind the start
+		std::uint64_t mask = step > 0 ? ~std::uint64_t(0) << (start % BITS_PER_WORD) : ~std::uint64_t(0) >> (BITS_PER_WORD - 1 - start % BITS_PER_WORD);
+		while (w >= 0 && w < wordsPerLine)
+		{
+			const std::uint64_t here = getWord(line, w);
+			const std::uint64_t before = getWord(line - 1, w);
+			const std::uint64_t after = getWord(line + 1, w);
+			// Each bit moved onto the cell behind it in the direction of the scan
+			std::uint64_t beforeAhead, afterAhead;
+			if (step > 0)
+			{
+				beforeAhead = (before >> 1) | (getWord(line - 1, w + 1) << (BITS_PER_WORD - 1));
+				afterAhead = (after >> 1) | (getWord(line + 1, w + 1) << (BITS_PER_WORD - 1));
+			}
+			else
+			{
+				beforeAhead = (before << 1) | (getWord(line - 1, w - 1) >> (BITS_PER_WORD - 1));
+				afterAhead = (after << 1) | (getWord(line + 1, w - 1) >> (BITS_PER_WORD - 1));
+			}
+
+			// Closed cells end the jump, as do open cells with a closed cell to
+			// the side and an open one beyond it
+			std::uint64_t stops = ~here | (beforeAhead & ~before) | (afterAhead & ~after);
+			if (targetPos >= 0 && targetPos / BITS_PER_WORD == w) stops |= std::uint64_t(1) << (targetPos % BITS_PER_WORD);
+			stops &= mask;
+			if (stops != 0)
+			{
+				const int bit = step > 0 ? lowestBit(stops) : highestBit(stops);
+				return ((here >> bit) & 1) != 0 ? w * BITS_PER_WORD + bit : -1;
+			}
+
+			mask = ~std::uint64_t(0);
+			w += step;
+		}
+		return -1;
+	}
+
+	JumpPointSearch::JumpPointSearch(const JumpPointGrid& grid, sf::Vector2i source, sf::Vector2i target, Workspace& workspace)
+		: mGrid(grid)
+		, mWorkspace(workspace)
+		, mWidth(grid.getWidth())
+		, mTargetCell(target)
+		, mSource(-1)
+		, mTarget(-1)
+		, mNumExpanded(0)
+	{
+		if (grid.isOpen(source.x, source.y) && grid.isOpen(target.x, target.y))
+		{
+			mSource = source.y * mWidth + source.x;
+			mTarget = target.y * mWidth + target.x;
+			mWorkspace.begin(mWidth * mGrid.getHeight());
+			mWorkspace.setCosts(mSource, 0, getDistance(mSource, mTarget));
+			mWorkspace.setFrontierParent(mSource, mSource);
+			mWorkspace.getQueue().insert(mSource);
+		}
+	}
+
+	void JumpPointSearch::getPathToTarget(std::vector<int>& outPath) const
+	{
+		outPath.clear();
+
+		if (mTarget < 0 || mWorkspace.getTreeParent(mTarget) == Workspace::NO_PARENT) return;
+
+		// Jump points are joined by straight or diagonal runs of cells
+		int cell = mTarget;
+		outPath.push_back(cell);
+		while (cell != mSource)
+		{
+			const int parent = mWorkspace.getTreeParent(cell);
+			const int dx = sign(parent % mWidth - cell % mWidth);
+			const int dy = sign(parent / mWidth - cell / mWidth);
+			while (cell != parent)
+			{
+				cell += dy * mWidth + dx;
+				outPath.push_back(cell);
+			}
+		}
+	}
+
+	int JumpPointSearch::getNumExpanded() const
+	{
+		return mNumExpanded;
+	}
+
+	JumpPointSearch::Status JumpPointSearch::cycleOnce()
+	{
+		IndexedPriorityQueue<double>& pq = mWorkspace.getQueue();
+		if (mSource < 0 || pq.empty()) return TARGET_NOT_FOUND;
+
+		const int cell = pq.pop();
+		mWorkspace.setTreeParent(cell, mWorkspace.getFrontierParent(cell));
+		++mNumExpanded;
+
+		if (cell == mTarget) return TARGET_FOUND;
+
+		// Directions worth jumping in: all of them from the source, else
+		// onwards from the parent and around any closed cell just passed
+		const int x = cell % mWidth, y = cell / mWidth;
+		sf::Vector2i directions[8];
+		int numDirections = 0;
+		const int parent = mWorkspace.getTreeParent(cell);
+		if (cell == mSource)
+		{
+			for (int dy = -1; dy <= 1; ++dy)
+			{
+				for (int dx = -1; dx <= 1; ++dx)
+				{
+					if (dx != 0 || dy != 0) directions[numDirections++] = { dx, dy };
+				}
+			}
+		}
+		else
+		{
+			const int dx = sign(x - parent % mWidth), dy = sign(y - parent / mWidth);
+			if (dx != 0 && dy != 0)
+			{
+				directions[numDirections++] = { dx, dy };
+				directions[numDirections++] = { dx, 0 };
+				directions[numDirections++] = { 0, dy };
+				if (!mGrid.isOpen(x - dx, y)) directions[numDirections++] = { -dx, dy };
+				if (!mGrid.isOpen(x, y - dy)) directions[numDirections++] = { dx, -dy };
+			}
+			else if (dx != 0)
+			{
+				directions[numDirections++] = { dx, 0 };
+				if (!mGrid.isOpen(x, y + 1)) directions[numDirections++] = { dx, 1 };
+				if (!mGrid.isOpen(x, y - 1)) directions[numDirections++] = { dx, -1 };
+			}
+			else
+			{
+				directions[numDirections++] = { 0, dy };
+				if (!mGrid.isOpen(x + 1, y)) directions[numDirections++] = { 1, dy };
+				if (!mGrid.isOpen(x - 1, y)) directions[numDirections++] = { -1, dy };
+			}
+		}
+
+		const double gCost = mWorkspace.getGCost(cell);
+		for (int i = 0; i < numDirections; ++i)
+		{
+			const sf::Vector2i d = directions[i];
+			const int jumpPoint = d.x != 0 && d.y != 0 ? jumpDiagonal(x, y, d.x, d.y) : mGrid.jumpStraight(x, y, d.x, d.y, mTargetCell);
+			if (jumpPoint < 0 || mWorkspace.getTreeParent(jumpPoint) != Workspace::NO_PARENT) continue;
+
+			const double newCost = gCost + getDistance(cell, jumpPoint);
+			if (mWorkspace.getFrontierParent(jumpPoint) == Workspace::NO_PARENT)
+			{
+				mWorkspace.setCosts(jumpPoint, newCost, newCost + getDistance(jumpPoint, mTarget));
+				pq.insert(jumpPoint);
+				mWorkspace.setFrontierParent(jumpPoint, cell);
+			}
+			else if (newCost < mWorkspace.getGCost(jumpPoint))
+			{
+				mWorkspace.setCosts(jumpPoint, newCost, newCost + getDistance(jumpPoint, mTarget));
+				pq.changePriority(jumpPoint);
+				mWorkspace.setFrontierParent(jumpPoint, cell);
+			}
+		}
+
+		return SEARCH_INCOMPLETE;
+	}
+
+	int JumpPointSearch::jumpDiagonal(int x, int y, int dx, int dy) const
+	{
+		for (;;)
+		{
+			x += dx;
+			y += dy;
+			if (!mGrid.isOpen(x, y)) return -1;
+
+			const int cell = y * mWidth + x;
+			if (cell == mTarget) return cell;
+			// A cell behind a closed one is only reached best by turning here
+			if ((mGrid.isOpen(x - dx, y + dy) && !mGrid.isOpen(x - dx, y)) || (mGrid.isOpen(x + dx, y - dy) && !mGrid.isOpen(x, y - dy))) return cell;
+			if (mGrid.jumpStraight(x, y, dx, 0, mTargetCell) >= 0 || mGrid.jumpStraight(x, y, 0, dy, mTargetCell) >= 0) return cell;
+		}
+	}
+
+	double JumpPointSearch::getDistance(int from, int to) const
+	{
+		const sf::Vector2f cellSize = mGrid.getCellSize();
+		const double dx = (to % mWidth - from % mWidth) * (double)cellSize.x;
+		const double dy = (to / mWidth - from / mWidth) * (double)cellSize.y;
+		return std::sqrt(dx * dx + dy * dy);
+	}
+}
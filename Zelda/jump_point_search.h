@@ -0,0 +1,82 @@
+#ifndef TE_JUMP_POINT_SEARCH_H
+#define TE_JUMP_POINT_SEARCH_H
+
+#include "graph_search_time_sliced.h"
+#include "occupancy_grid.h"
+
+#include <SFML/System/Vector2.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace te
+{
+	// The open cells of an occupancy grid packed one bit per cell both by row
+	// and by column, so that straight jumps scan whole words at a time.
+	class JumpPointGrid
+	{
+	public:
+		explicit JumpPointGrid(const OccupancyGrid& grid);
+
+		int getWidth() const;
+		int getHeight() const;
+		sf::Vector2f getCellSize() const;
+		// False outside the grid
+		bool isOpen(int x, int y) const;
+		// Updates the cell's bit in both the row and the column bitsets
+		void setOpen(int x, int y, bool open);
+
+		// The first cell stepping from (x, y) by (dx, dy), one of which is zero,
+		// that is the target or beside a closed cell a path may turn around.
+		// -1 if a closed cell comes first.
+		int jumpStraight(int x, int y, int dx, int dy, sf::Vector2i target) const;
+
+	private:
+		// Scans lines of a bitset along line from pos by step, returning the
+		// position the jump stops at or -1
+		static int scan(const std::vector<std::uint64_t>& bits, int wordsPerLine, int numLines, int line, int pos, int step, int targetPos);
+
+		int mWidth;
+		int mHeight;
+		sf::Vector2f mCellSize;
+		int mWordsPerRow;
+		int mWordsPerColumn;
+		std::vector<std::uint64_t> mRows;
+		std::vector<std::uint64_t> mColumns;
+	};
+
+	// Jump point search between the open cells of a grid, moving to any of the
+	// eight neighbouring cells that is open, diagonally past closed cells too,
+	// as the nav graph does. Only the cells where an optimal path may turn are
+	// queued, so straight runs across open areas are skipped over.
+	class JumpPointSearch : public GraphSearchTimeSliced
+	{
+	public:
+		typedef GraphSearchWorkspace Workspace;
+
+		JumpPointSearch(const JumpPointGrid& grid, sf::Vector2i source, sf::Vector2i target, Workspace& workspace);
+
+		// Expands the next jump point
+		Status cycleOnce();
+		// The cells from the target back to the source, every one of them,
+		// as y * width + x. Empty until the target is found.
+		void getPathToTarget(std::vector<int>& outPath) const;
+		int getNumExpanded() const;
+
+	private:
+		// The first jump point stepping diagonally from (x, y) by (dx, dy), or -1
+		int jumpDiagonal(int x, int y, int dx, int dy) const;
+		// Length of the straight line between the centres of two cells
+		double getDistance(int from, int to) const;
+
+		const JumpPointGrid& mGrid;
+		Workspace& mWorkspace;
+		int mWidth;
+		sf::Vector2i mTargetCell;
+		int mSource;
+		int mTarget;
+		int mNumExpanded;
+	};
+}
+
+#endif
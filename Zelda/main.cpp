@@ -1,4 +1,5 @@
 #include "zelda_application.h"
+#include "map_cache.h"
 
 #include <iostream>
 
@@ -10,6 +11,14 @@ int main(int argc, char* argv[])
 		{
 			throw std::runtime_error("Initial map file must be supplied.");
 		}
+		if (std::string(argv[1]) == "--compile")
+		{
+			for (int i = 2; i < argc; ++i)
+			{
+				te::MapCache::compile(argv[i]);
+			}
+			return 0;
+		}
 		te::ZeldaApplication app(argv[1]);
 		app.run();
 	}
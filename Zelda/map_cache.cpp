@@ -0,0 +1,420 @@
+#include "map_cache.h"
+#include "tmx.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace te
+{
+	const std::uint32_t MapCache::VERSION = 7;
+
+	static const char MAGIC[4] = { 'T', 'M', 'X', 'C' };
+
+	struct Header
+	{
+		char magic[4];
+		std::uint32_t version;
+		std::int64_t sourceSize;
+		std::int64_t sourceTime;
+	};
+
+	static bool getSourceStamp(const std::string& filename, std::int64_t& size, std::int64_t& time)
+	{
+		struct stat st;
+		if (stat(filename.c_str(), &st) != 0)
+		{
+			return false;
+		}
+		size = (std::int64_t)st.st_size;
+		time = (std::int64_t)st.st_mtime;
+		return true;
+	}
+
+	class MappedFile
+	{
+	public:
+		MappedFile(const std::string& filename)
+			: mpData(nullptr)
+			, mSize(0)
+#ifdef _WIN32
+			, mFile(INVALID_HANDLE_VALUE)
+			, mMapping(NULL)
+#endif
+		{
+#ifdef _WIN32
+			mFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (mFile == INVALID_HANDLE_VALUE) return;
+			LARGE_INTEGER size;
+			if (!GetFileSizeEx(mFile, &size) || size.QuadPart == 0) return;
+			mMapping = CreateFileMappingA(mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (mMapping == NULL) return;
+			mpData = static_cast<const char*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+			if (mpData) mSize = (size_t)size.QuadPart;
+#else
+			int fd = open(filename.c_str(), O_RDONLY);
+			if (fd < 0) return;
+			struct stat st;
+			if (fstat(fd, &st) == 0 && st.st_size > 0)
+			{
+				void* pData = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (pData != MAP_FAILED)
+				{
+					mpData = static_cast<const char*>(pData);
+					mSize = (size_t)st.st_size;
+				}
+			}
+			close(fd);
+#endif
+		}
+
+		~MappedFile()
+		{
+#ifdef _WIN32
+			if (mpData) UnmapViewOfFile(mpData);
+			if (mMapping != NULL) CloseHandle(mMapping);
+			if (mFile != INVALID_HANDLE_VALUE) CloseHandle(mFile);
+#else
+			if (mpData) munmap(const_cast<char*>(mpData), mSize);
+#endif
+		}
+
+		const char* data() const { return mpData; }
+		size_t size() const { return mSize; }
+
+	private:
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const char* mpData;
+		size_t mSize;
+#ifdef _WIN32
+		HANDLE mFile;
+		HANDLE mMapping;
+#endif
+	};
+
+	class CacheReader
+	{
+	public:
+		CacheReader(const char* pData, size_t size)
+			: mpCurr(pData), mpEnd(pData + size)
+		{}
+
+		template <class T>
+		T read()
+		{
+			T value;
+			readBytes(&value, sizeof(T));
+			return value;
+		}
+
+		std::string readString()
+		{
+			std::uint32_t length = read<std::uint32_t>();
+			require(length);
+			std::string str(mpCurr, length);
+			mpCurr += length;
+			return str;
+		}
+
+		template <class T>
+		void readArray(std::vector<T>& out)
+		{
+			std::uint32_t count = read<std::uint32_t>();
+			require((size_t)count * sizeof(T));
+			out.resize(count);
+			if (count > 0) std::memcpy(out.data(), mpCurr, count * sizeof(T));
+			mpCurr += count * sizeof(T);
+		}
+
+		bool atEnd() const { return mpCurr == mpEnd; }
+
+	private:
+		void require(size_t bytes) const
+		{
+			if ((size_t)(mpEnd - mpCurr) < bytes)
+				throw std::runtime_error("Map cache is truncated.");
+		}
+
+		void readBytes(void* pOut, size_t bytes)
+		{
+			require(bytes);
+			std::memcpy(pOut, mpCurr, bytes);
+			mpCurr += bytes;
+		}
+
+		const char* mpCurr;
+		const char* mpEnd;
+	};
+
+	class CacheWriter
+	{
+	public:
+		CacheWriter(std::ofstream& out)
+			: mOut(out)
+		{}
+
+		template <class T>
+		void write(const T& value)
+		{
+			mOut.write(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		void writeString(const std::string& str)
+		{
+			write((std::uint32_t)str.size());
+			mOut.write(str.data(), str.size());
+		}
+
+		template <class T>
+		void writeArray(const std::vector<T>& values)
+		{
+			write((std::uint32_t)values.size());
+			if (!values.empty()) mOut.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+		}
+
+	private:
+		std::ofstream& mOut;
+	};
+
+	std::string MapCache::getCacheFilename(const std::string& tmxFilename)
+	{
+		return tmxFilename + "c";
+	}
+
+	static void readObjectGroup(CacheReader& in, TMX::ObjectGroup& group)
+	{
+		group.name = in.readString();
+		group.draworder = in.readString();
+		group.objects.resize(in.read<std::uint32_t>());
+		for (auto& object : group.objects)
+		{
+			object.id = in.read<std::int32_t>();
+			object.name = in.readString();
+			object.x = in.read<std::int32_t>();
+			object.y = in.read<std::int32_t>();
+			object.width = in.read<std::int32_t>();
+			object.height = in.read<std::int32_t>();
+			object.polygons.resize(in.read<std::uint32_t>());
+			for (auto& polygon : object.polygons)
+			{
+				in.readArray(polygon.points);
+				polygon.closed = in.read<std::uint8_t>() != 0;
+			}
+		}
+	}
+
+	static void writeObjectGroup(CacheWriter& out, const TMX::ObjectGroup& group)
+	{
+		out.writeString(group.name);
+		out.writeString(group.draworder);
+		out.write((std::uint32_t)group.objects.size());
+		for (auto& object : group.objects)
+		{
+			out.write((std::int32_t)object.id);
+			out.writeString(object.name);
+			out.write((std::int32_t)object.x);
+			out.write((std::int32_t)object.y);
+			out.write((std::int32_t)object.width);
+			out.write((std::int32_t)object.height);
+			out.write((std::uint32_t)object.polygons.size());
+			for (auto& polygon : object.polygons)
+			{
+				out.writeArray(polygon.points);
+				out.write((std::uint8_t)(polygon.closed ? 1 : 0));
+			}
+		}
+	}
+
+	bool MapCache::read(const std::string& tmxFilename, const std::string& cacheFilename, TMX& tmx)
+	{
+		std::int64_t sourceSize, sourceTime;
+		if (!getSourceStamp(tmxFilename, sourceSize, sourceTime))
+		{
+			return false;
+		}
+
+		MappedFile file(cacheFilename);
+		if (!file.data() || file.size() < sizeof(Header))
+		{
+			return false;
+		}
+
+		try
+		{
+			CacheReader in(file.data(), file.size());
+			Header header = in.read<Header>();
+			if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+				header.sourceSize != sourceSize || header.sourceTime != sourceTime)
+			{
+				return false;
+			}
+
+			TMX result(tmx);
+			result.mWidth = in.read<std::int32_t>();
+			result.mHeight = in.read<std::int32_t>();
+			result.mTilewidth = in.read<std::int32_t>();
+			result.mTileheight = in.read<std::int32_t>();
+
+			result.mTilesets.resize(in.read<std::uint32_t>());
+			for (auto& tileset : result.mTilesets)
+			{
+				tileset.firstgid = in.read<std::int32_t>();
+				tileset.name = in.readString();
+				tileset.tilewidth = in.read<std::int32_t>();
+				tileset.tileheight = in.read<std::int32_t>();
+				tileset.tilecount = in.read<std::int32_t>();
+				tileset.image.source = in.readString();
+				tileset.image.width = in.read<std::int32_t>();
+				tileset.image.height = in.read<std::int32_t>();
+				tileset.tiles.resize(in.read<std::uint32_t>());
+				for (auto& tile : tileset.tiles)
+				{
+					tile.id = in.read<std::int32_t>();
+					readObjectGroup(in, tile.objectgroup);
+				}
+			}
+
+			result.mLayers.resize(in.read<std::uint32_t>());
+			for (auto& layer : result.mLayers)
+			{
+				layer.name = in.readString();
+				layer.width = in.read<std::int32_t>();
+				layer.height = in.read<std::int32_t>();
+				in.readArray(layer.data.tiles);
+			}
+
+			result.mObjectGroups.resize(in.read<std::uint32_t>());
+			for (auto& group : result.mObjectGroups)
+			{
+				readObjectGroup(in, group);
+			}
+
+			result.mbCompiled = in.read<std::uint8_t>() != 0;
+			in.readArray(result.mColliderRects);
+			result.mColliderOutlines.resize(in.read<std::uint32_t>());
+			for (auto& outline : result.mColliderOutlines)
+			{
+				in.readArray(outline.points);
+				outline.loop = in.read<std::uint8_t>() != 0;
+			}
+			in.readArray(result.mNavGraphData.positions);
+			in.readArray(result.mNavGraphData.edgeOffsets);
+			in.readArray(result.mNavGraphData.edgeTargets);
+
+			if (!in.atEnd())
+			{
+				return false;
+			}
+
+			tmx = std::move(result);
+			return true;
+		}
+		catch (std::runtime_error&)
+		{
+			return false;
+		}
+	}
+
+	bool MapCache::write(const std::string& tmxFilename, const std::string& cacheFilename, const TMX& tmx)
+	{
+		Header header;
+		std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = VERSION;
+		if (!getSourceStamp(tmxFilename, header.sourceSize, header.sourceTime))
+		{
+			return false;
+		}
+
+		std::ofstream file(cacheFilename, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			return false;
+		}
+
+		CacheWriter out(file);
+		out.write(header);
+		out.write((std::int32_t)tmx.mWidth);
+		out.write((std::int32_t)tmx.mHeight);
+		out.write((std::int32_t)tmx.mTilewidth);
+		out.write((std::int32_t)tmx.mTileheight);
+
+		out.write((std::uint32_t)tmx.mTilesets.size());
+		for (auto& tileset : tmx.mTilesets)
+		{
+			out.write((std::int32_t)tileset.firstgid);
+			out.writeString(tileset.name);
+			out.write((std::int32_t)tileset.tilewidth);
+			out.write((std::int32_t)tileset.tileheight);
+			out.write((std::int32_t)tileset.tilecount);
+			out.writeString(tileset.image.source);
+			out.write((std::int32_t)tileset.image.width);
+			out.write((std::int32_t)tileset.image.height);
+			out.write((std::uint32_t)tileset.tiles.size());
+			for (auto& tile : tileset.tiles)
+			{
+				out.write((std::int32_t)tile.id);
+				writeObjectGroup(out, tile.objectgroup);
+			}
+		}
+
+		out.write((std::uint32_t)tmx.mLayers.size());
+		for (auto& layer : tmx.mLayers)
+		{
+			out.writeString(layer.name);
+			out.write((std::int32_t)layer.width);
+			out.write((std::int32_t)layer.height);
+			out.writeArray(layer.data.tiles);
+		}
+
+		out.write((std::uint32_t)tmx.mObjectGroups.size());
+		for (auto& group : tmx.mObjectGroups)
+		{
+			writeObjectGroup(out, group);
+		}
+
+		out.write((std::uint8_t)(tmx.mbCompiled ? 1 : 0));
+		out.writeArray(tmx.mColliderRects);
+		out.write((std::uint32_t)tmx.mColliderOutlines.size());
+		for (auto& outline : tmx.mColliderOutlines)
+		{
+			out.writeArray(outline.points);
+			out.write((std::uint8_t)(outline.loop ? 1 : 0));
+		}
+		out.writeArray(tmx.mNavGraphData.positions);
+		out.writeArray(tmx.mNavGraphData.edgeOffsets);
+		out.writeArray(tmx.mNavGraphData.edgeTargets);
+
+		file.close();
+		if (!file)
+		{
+			std::remove(cacheFilename.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	void MapCache::compile(const std::string& tmxFilename)
+	{
+		TMX tmx(tmxFilename, TMX::COMPILE);
+		if (!write(tmxFilename, getCacheFilename(tmxFilename), tmx))
+		{
+			throw std::runtime_error("Unable to write map cache for " + tmxFilename + ".");
+		}
+	}
+}
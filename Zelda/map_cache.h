@@ -0,0 +1,33 @@
+#ifndef TE_MAP_CACHE_H
+#define TE_MAP_CACHE_H
+
+#include <cstdint>
+#include <string>
+
+namespace te
+{
+	class TMX;
+
+	// Compiled binary form of a TMX file. Holds everything TMX parses plus,
+	// once the map has been compiled, the derived collider rectangles and
+	// outlines and the nav graph so a map can be loaded without touching the
+	// XML. The cache is rejected when its version or the recorded
+	// size/modification time of the source TMX file differ.
+	class MapCache
+	{
+	public:
+		static const std::uint32_t VERSION;
+
+		static std::string getCacheFilename(const std::string& tmxFilename);
+
+		static bool read(const std::string& tmxFilename, const std::string& cacheFilename, TMX& tmx);
+		static bool write(const std::string& tmxFilename, const std::string& cacheFilename, const TMX& tmx);
+
+		static void compile(const std::string& tmxFilename);
+
+	private:
+		MapCache() = delete;
+	};
+}
+
+#endif
@@ -0,0 +1,77 @@
+#include "map_loader.h"
+#include "tmx.h"
+#include "texture_manager.h"
+
+#include <stdexcept>
+
+namespace te
+{
+	std::unique_ptr<MapLoader> MapLoader::make(const std::string& filename, int compileTileLimit, const sf::Transform& pixelToWorldTransform)
+	{
+		return std::unique_ptr<MapLoader>(new MapLoader(filename, compileTileLimit, pixelToWorldTransform));
+	}
+
+	MapLoader::MapLoader(const std::string& filename, int compileTileLimit, const sf::Transform& pixelToWorldTransform)
+		: mFilename(filename)
+		, mPixelToWorld(pixelToWorldTransform)
+		, mProgress(0)
+		, mResult()
+	{
+		mResult = std::async(std::launch::async, [this, compileTileLimit]() {
+			return load(compileTileLimit);
+		});
+	}
+
+	MapLoader::Result MapLoader::load(int compileTileLimit)
+	{
+		Result result;
+		TMX& tmx = *(result.map.pTMX = std::make_shared<TMX>(mFilename, TMX::CACHE));
+		mProgress = 0.4f;
+
+		if (tmx.getWidth() * tmx.getHeight() <= compileTileLimit)
+		{
+			result.map.pBuild = TileMap::build(tmx, mPixelToWorld);
+		}
+		mProgress = 0.8f;
+
+		std::vector<std::string> sources = tmx.getTilesetImages();
+		for (auto& source : sources)
+		{
+			sf::Image image;
+			if (!image.loadFromFile(source))
+			{
+				throw std::runtime_error("Texture file not found.");
+			}
+			result.images.emplace_back(source, std::move(image));
+			mProgress = 0.8f + 0.2f * result.images.size() / sources.size();
+		}
+
+		mProgress = 1;
+		return result;
+	}
+
+	const std::string& MapLoader::getFilename() const
+	{
+		return mFilename;
+	}
+
+	float MapLoader::getProgress() const
+	{
+		return mProgress;
+	}
+
+	bool MapLoader::isReady() const
+	{
+		return mResult.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}
+
+	MapLoader::Map MapLoader::finish(TextureManager& textureManager)
+	{
+		Result result = mResult.get();
+		for (auto& image : result.images)
+		{
+			textureManager.load(image.first, image.second);
+		}
+		return std::move(result.map);
+	}
+}
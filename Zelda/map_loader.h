@@ -0,0 +1,65 @@
+#ifndef TE_MAP_LOADER_H
+#define TE_MAP_LOADER_H
+
+#include "tile_map.h"
+
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/Transform.hpp>
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace te
+{
+	class TMX;
+	class TextureManager;
+
+	// Loads a map on a worker thread: parse (or cache read), compile, the
+	// TileMap build and tileset image decode. Only the texture upload in
+	// finish() and attaching the TileMap to the game are left for the main
+	// thread.
+	class MapLoader
+	{
+	public:
+		struct Map
+		{
+			std::shared_ptr<TMX> pTMX;
+			// Null for maps left to be streamed
+			std::unique_ptr<TileMap::Build> pBuild;
+		};
+
+		// Maps with more than compileTileLimit tiles are left uncompiled so they can be streamed
+		static std::unique_ptr<MapLoader> make(const std::string& filename, int compileTileLimit, const sf::Transform& pixelToWorldTransform);
+
+		const std::string& getFilename() const;
+		float getProgress() const;
+		bool isReady() const;
+
+		// Waits for the worker if needed and rethrows anything it threw
+		Map finish(TextureManager& textureManager);
+
+	private:
+		struct Result
+		{
+			Map map;
+			std::vector<std::pair<std::string, sf::Image>> images;
+		};
+
+		MapLoader(const std::string& filename, int compileTileLimit, const sf::Transform& pixelToWorldTransform);
+		MapLoader(const MapLoader&) = delete;
+		MapLoader& operator=(const MapLoader&) = delete;
+
+		Result load(int compileTileLimit);
+
+		std::string mFilename;
+		sf::Transform mPixelToWorld;
+		std::atomic<float> mProgress;
+		std::future<Result> mResult;
+	};
+}
+
+#endif
@@ -0,0 +1,293 @@
+#include "occupancy_grid.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace te
+{
+	namespace
+	{
+		const int BITS_PER_WORD = 64;
+
+		// Entry time of the ray into the rectangle, false when it misses it
+		bool enterRect(sf::Vector2f a, sf::Vector2f d, float left, float top, float right, float bottom, float& outTime)
+		{
+			float t0 = -INFINITY, t1 = INFINITY;
+			const float origin[2] = { a.x, a.y };
+			const float dir[2] = { d.x, d.y };
+			const float lo[2] = { left, top };
+			const float hi[2] = { right, bottom };
+			for (int i = 0; i < 2; ++i)
+			{
+				if (dir[i] == 0)
+				{
+					if (origin[i] < lo[i] || origin[i] > hi[i]) return false;
+					continue;
+				}
+				float near = (lo[i] - origin[i]) / dir[i], far = (hi[i] - origin[i]) / dir[i];
+				if (near > far) std::swap(near, far);
+				t0 = std::max(t0, near);
+				t1 = std::min(t1, far);
+			}
+			if (t0 > t1 || t1 < 0) return false;
+			outTime = t0;
+			return true;
+		}
+
+		// Entry time of the ray into the circle, false when it misses it
+		bool enterCircle(sf::Vector2f a, sf::Vector2f d, sf::Vector2f centre, float radius, float& outTime)
+		{
+			const sf::Vector2f f = a - centre;
+			const float qa = d.x * d.x + d.y * d.y;
+			if (qa == 0) return false;
+			const float qb = f.x * d.x + f.y * d.y;
+			const float qc = f.x * f.x + f.y * f.y - radius * radius;
+			const float discriminant = qb * qb - qa * qc;
+			if (discriminant <= 0) return false;
+			const float root = std::sqrt(discriminant);
+			if ((-qb + root) / qa < 0) return false;
+			outTime = (-qb - root) / qa;
+			return true;
+		}
+
+		// Time in [0, 1] at which a circle swept from a along d first comes
+		// closer than radius to the box, or a value past 1 when it never does
+		float sweepBox(sf::Vector2f a, sf::Vector2f d, float radius, float left, float top, float right, float bottom)
+		{
+			const float dx = std::max({ left - a.x, 0.f, a.x - right });
+			const float dy = std::max({ top - a.y, 0.f, a.y - bottom });
+			if (dx * dx + dy * dy < radius * radius) return 0;
+
+			// The box grown by radius is two rectangles and four corner circles
+			float first = 2, time;
+			if (enterRect(a, d, left - radius, top, right + radius, bottom, time)) first = std::min(first, time);
+			if (enterRect(a, d, left, top - radius, right, bottom + radius, time)) first = std::min(first, time);
+			const sf::Vector2f corners[4] = { { left, top }, { right, top }, { left, bottom }, { right, bottom } };
+			for (auto& corner : corners)
+			{
+				if (enterCircle(a, d, corner, radius, time)) first = std::min(first, time);
+			}
+			return first < 0 ? 0 : first;
+		}
+	}
+
+	OccupancyGrid::OccupancyGrid(const sf::FloatRect& bounds, int cellsX, int cellsY)
+		: mBounds(bounds)
+		, mNumCellsX(std::max(cellsX, 1))
+		, mNumCellsY(std::max(cellsY, 1))
+		, mCellSizeX(bounds.width / std::max(cellsX, 1))
+		, mCellSizeY(bounds.height / std::max(cellsY, 1))
+		, mWordsPerRow((std::max(cellsX, 1) + BITS_PER_WORD - 1) / BITS_PER_WORD)
+		, mBits((size_t)mWordsPerRow * mNumCellsY, 0)
+	{}
+
+	int OccupancyGrid::getNumCellsX() const
+	{
+		return mNumCellsX;
+	}
+
+	int OccupancyGrid::getNumCellsY() const
+	{
+		return mNumCellsY;
+	}
+
+	sf::Vector2f OccupancyGrid::getCellSize() const
+	{
+		return { mCellSizeX, mCellSizeY };
+	}
+
+	sf::Vector2i OccupancyGrid::getCell(sf::Vector2f position) const
+	{
+		return { (int)std::floor((position.x - mBounds.left) / mCellSizeX), (int)std::floor((position.y - mBounds.top) / mCellSizeY) };
+	}
+
+	sf::Vector2f OccupancyGrid::getCellCentre(int x, int y) const
+	{
+		return { mBounds.left + (x + 0.5f) * mCellSizeX, mBounds.top + (y + 0.5f) * mCellSizeY };
+	}
+
+	bool OccupancyGrid::isSolid(int x, int y) const
+	{
+		if (x < 0 || x >= mNumCellsX || y < 0 || y >= mNumCellsY) return false;
+		return ((mBits[y * mWordsPerRow + x / BITS_PER_WORD] >> (x % BITS_PER_WORD)) & 1) != 0;
+	}
+
+	void OccupancyGrid::setSolid(int x, int y, bool solid)
+	{
+		if (x < 0 || x >= mNumCellsX || y < 0 || y >= mNumCellsY) return;
+		const std::uint64_t bit = std::uint64_t(1) << (x % BITS_PER_WORD);
+		std::uint64_t& word = mBits[y * mWordsPerRow + x / BITS_PER_WORD];
+		word = solid ? word | bit : word & ~bit;
+	}
+
+	void OccupancyGrid::clear(const sf::IntRect& cells)
+	{
+		for (int y = cells.top; y < cells.top + cells.height; ++y)
+		{
+			for (int x = cells.left; x < cells.left + cells.width; ++x)
+			{
+				setSolid(x, y, false);
+			}
+		}
+	}
+
+	bool OccupancyGrid::raycast(sf::Vector2f from, sf::Vector2f to, float radius, float& outFraction) const
+	{
+		if (radius > 0)
+		{
+			return traceSweep(from, to, radius, true, outFraction);
+		}
+		return traceLine(from, to, outFraction);
+	}
+
+	bool OccupancyGrid::isObstructed(const WallGrid::Sweep& sweep) const
+	{
+		float fraction;
+		if (sweep.radius > 0)
+		{
+			return traceSweep(sweep.from, sweep.to, sweep.radius, false, fraction);
+		}
+		return traceLine(sweep.from, sweep.to, fraction);
+	}
+
+	void OccupancyGrid::isObstructed(const std::vector<WallGrid::Sweep>& sweeps, std::vector<char>& outObstructed) const
+	{
+		outObstructed.resize(sweeps.size());
+		parallelFor(0, (int)sweeps.size(), 256, [this, &sweeps, &outObstructed](int begin, int end) {
+			for (int i = begin; i < end; ++i)
+			{
+				outObstructed[i] = isObstructed(sweeps[i]);
+			}
+		});
+	}
+
+	bool OccupancyGrid::traceLine(sf::Vector2f from, sf::Vector2f to, float& outFraction) const
+	{
+		// In cell units, clipped to the grid
+		const sf::Vector2f p((from.x - mBounds.left) / mCellSizeX, (from.y - mBounds.top) / mCellSizeY);
+		const sf::Vector2f d((to.x - from.x) / mCellSizeX, (to.y - from.y) / mCellSizeY);
+		float t0, t1 = 1;
+		if (!enterRect(p, d, 0, 0, (float)mNumCellsX, (float)mNumCellsY, t0)) return false;
+		t0 = std::max(t0, 0.f);
+		for (int i = 0; i < 2; ++i)
+		{
+			const float dir = i == 0 ? d.x : d.y;
+			const float origin = i == 0 ? p.x : p.y;
+			const float size = (float)(i == 0 ? mNumCellsX : mNumCellsY);
+			if (dir > 0) t1 = std::min(t1, (size - origin) / dir);
+			else if (dir < 0) t1 = std::min(t1, -origin / dir);
+		}
+		if (t0 > t1) return false;
+
+		int x = std::max(0, std::min((int)std::floor(p.x + d.x * t0), mNumCellsX - 1));
+		int y = std::max(0, std::min((int)std::floor(p.y + d.y * t0), mNumCellsY - 1));
+		if (isSolid(x, y))
+		{
+			outFraction = t0;
+			return true;
+		}
+
+		// Amanatides and Woo: step into whichever neighbouring cell the line reaches first
+		const int stepX = d.x > 0 ? 1 : (d.x < 0 ? -1 : 0);
+		const int stepY = d.y > 0 ? 1 : (d.y < 0 ? -1 : 0);
+		const float deltaX = stepX != 0 ? 1 / std::abs(d.x) : INFINITY;
+		const float deltaY = stepY != 0 ? 1 / std::abs(d.y) : INFINITY;
+		float nextX = stepX > 0 ? (x + 1 - p.x) / d.x : (stepX < 0 ? (x - p.x) / d.x : INFINITY);
+		float nextY = stepY > 0 ? (y + 1 - p.y) / d.y : (stepY < 0 ? (y - p.y) / d.y : INFINITY);
+		for (;;)
+		{
+			float t;
+			if (nextX < nextY)
+			{
+				t = nextX;
+				x += stepX;
+				nextX += deltaX;
+			}
+			else
+			{
+				t = nextY;
+				y += stepY;
+				nextY += deltaY;
+			}
+			if (t >= t1 || x < 0 || x >= mNumCellsX || y < 0 || y >= mNumCellsY) return false;
+			if (isSolid(x, y))
+			{
+				outFraction = t;
+				return true;
+			}
+		}
+	}
+
+	bool OccupancyGrid::traceSweep(sf::Vector2f from, sf::Vector2f to, float radius, bool first, float& outFraction) const
+	{
+		auto cellY = [this](float y) {
+			const float cell = std::floor((y - mBounds.top) / mCellSizeY);
+			return cell < 0 ? 0 : (cell >= mNumCellsY ? mNumCellsY - 1 : (int)cell);
+		};
+		auto cellX = [this](float x) {
+			const float cell = std::floor((x - mBounds.left) / mCellSizeX);
+			return cell < 0 ? 0 : (cell >= mNumCellsX ? mNumCellsX - 1 : (int)cell);
+		};
+
+		const sf::Vector2f d = to - from;
+		float earliest = 2;
+
+		// Each row of cells is searched over the span of the segment, widened by
+		// the radius, that passes through the row
+		const int top = cellY(std::min(from.y, to.y) - radius);
+		const int bottom = cellY(std::max(from.y, to.y) + radius);
+		for (int y = top; y <= bottom; ++y)
+		{
+			const float rowTop = mBounds.top + y * mCellSizeY;
+			const float rowBottom = rowTop + mCellSizeY;
+
+			float t0 = 0, t1 = 1;
+			if (d.y != 0)
+			{
+				t0 = (rowTop - radius - from.y) / d.y;
+				t1 = (rowBottom + radius - from.y) / d.y;
+				if (t0 > t1) std::swap(t0, t1);
+				t0 = std::max(t0, 0.f);
+				t1 = std::min(t1, 1.f);
+			}
+			else if (from.y < rowTop - radius || from.y > rowBottom + radius)
+			{
+				continue;
+			}
+			if (t0 > t1) continue;
+
+			const float x0 = from.x + d.x * t0, x1 = from.x + d.x * t1;
+			const int left = cellX(std::min(x0, x1) - radius);
+			const int right = cellX(std::max(x0, x1) + radius);
+			const std::uint64_t* pRow = &mBits[y * mWordsPerRow];
+			for (int x = left; x <= right; ++x)
+			{
+				const std::uint64_t word = pRow[x / BITS_PER_WORD] >> (x % BITS_PER_WORD);
+				if (word == 0)
+				{
+					// Skip the rest of an empty word
+					x = (x / BITS_PER_WORD + 1) * BITS_PER_WORD - 1;
+					continue;
+				}
+				if ((word & 1) == 0) continue;
+
+				const float cellLeft = mBounds.left + x * mCellSizeX;
+				const float t = sweepBox(from, d, radius, cellLeft, rowTop, cellLeft + mCellSizeX, rowBottom);
+				if (t <= 1)
+				{
+					if (!first)
+					{
+						outFraction = t;
+						return true;
+					}
+					earliest = std::min(earliest, t);
+				}
+			}
+		}
+
+		if (earliest > 1) return false;
+		outFraction = earliest;
+		return true;
+	}
+}
@@ -0,0 +1,56 @@
+#ifndef TE_OCCUPANCY_GRID_H
+#define TE_OCCUPANCY_GRID_H
+
+#include "wall_grid.h"
+
+#include <SFML/Graphics.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace te
+{
+	// One bit per cell of a uniform grid telling whether the cell is solid.
+	// Everything outside the grid is open.
+	class OccupancyGrid
+	{
+	public:
+		OccupancyGrid(const sf::FloatRect& bounds, int cellsX, int cellsY);
+
+		int getNumCellsX() const;
+		int getNumCellsY() const;
+		sf::Vector2f getCellSize() const;
+		// The cell containing position, which may lie outside the grid
+		sf::Vector2i getCell(sf::Vector2f position) const;
+		sf::Vector2f getCellCentre(int x, int y) const;
+
+		bool isSolid(int x, int y) const;
+		void setSolid(int x, int y, bool solid);
+		void clear(const sf::IntRect& cells);
+
+		// Fraction of the way from one point to the other at which a circle of
+		// radius swept between them first comes closer than radius to a solid
+		// cell, or enters one for a zero radius. False when it never does.
+		bool raycast(sf::Vector2f from, sf::Vector2f to, float radius, float& outFraction) const;
+		bool isObstructed(const WallGrid::Sweep& sweep) const;
+		// Resizes outObstructed to one flag per sweep. Large batches are split
+		// across workers.
+		void isObstructed(const std::vector<WallGrid::Sweep>& sweeps, std::vector<char>& outObstructed) const;
+
+	private:
+		// Walks the cells the segment passes through in order
+		bool traceLine(sf::Vector2f from, sf::Vector2f to, float& outFraction) const;
+		// Tests every cell within radius of the segment
+		bool traceSweep(sf::Vector2f from, sf::Vector2f to, float radius, bool first, float& outFraction) const;
+
+		sf::FloatRect mBounds;
+		int mNumCellsX;
+		int mNumCellsY;
+		float mCellSizeX;
+		float mCellSizeY;
+		int mWordsPerRow;
+		std::vector<std::uint64_t> mBits;
+	};
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef TE_PARALLEL_H
+#define TE_PARALLEL_H
+
+#include <algorithm>
+#include <future>
+#include <thread>
+#include <vector>
+
+namespace te
+{
+	inline int getNumWorkers()
+	{
+		return std::max((int)std::thread::hardware_concurrency(), 1);
+	}
+
+	// Splits [begin, end) into up to getNumWorkers() contiguous ranges of at
+	// least minSize elements and calls fn(rangeBegin, rangeEnd) for each. The
+	// first range runs on the calling thread. Rethrows the first exception.
+	template <class Fn>
+	void parallelFor(int begin, int end, int minSize, Fn fn)
+	{
+		const int count = end - begin;
+		if (count <= 0)
+		{
+			return;
+		}
+		const int numRanges = std::max(std::min(getNumWorkers(), count / std::max(minSize, 1)), 1);
+
+		std::vector<std::future<void>> ranges;
+		for (int i = 1; i < numRanges; ++i)
+		{
+			ranges.push_back(std::async(std::launch::async, fn, begin + count * i / numRanges, begin + count * (i + 1) / numRanges));
+		}
+		fn(begin, begin + count / numRanges);
+		for (auto& range : ranges)
+		{
+			range.get();
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,106 @@
+#include "path_manager.h"
+#include "path_planner.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace te
+{
+	std::unique_ptr<PathManager> PathManager::make(int numSearchCyclesPerUpdate, int maxActiveSearches)
+	{
+		return std::unique_ptr<PathManager>(new PathManager(numSearchCyclesPerUpdate, maxActiveSearches));
+	}
+
+	PathManager::PathManager(int numSearchCyclesPerUpdate, int maxActiveSearches)
+		: mNumSearchCyclesPerUpdate(numSearchCyclesPerUpdate)
+		, mWorkspaces()
+		, mFreeWorkspaces()
+		, mWaitingPlanners()
+		, mActiveSearches()
+		, mNextSearch(0)
+	{
+		if (maxActiveSearches < 1) throw std::runtime_error("PathManager needs at least one active search.");
+
+		for (int i = 0; i < maxActiveSearches; ++i)
+		{
+			mWorkspaces.push_back(std::make_unique<Workspace>());
+			mFreeWorkspaces.push_back(mWorkspaces.back().get());
+		}
+	}
+
+	void PathManager::registerPlanner(PathPlanner& planner)
+	{
+		mWaitingPlanners.push_back(&planner);
+	}
+
+	void PathManager::unregisterPlanner(PathPlanner& planner)
+	{
+		mWaitingPlanners.erase(std::remove(mWaitingPlanners.begin(), mWaitingPlanners.end(), &planner), mWaitingPlanners.end());
+
+		for (size_t i = 0; i < mActiveSearches.size(); ++i)
+		{
+			if (mActiveSearches[i].pPlanner == &planner)
+			{
+				mFreeWorkspaces.push_back(mActiveSearches[i].pWorkspace);
+				mActiveSearches.erase(mActiveSearches.begin() + i);
+				if (i < mNextSearch) --mNextSearch;
+				return;
+			}
+		}
+	}
+
+	void PathManager::updateSearches()
+	{
+		activateWaitingSearches();
+
+		// One cycle of each search in turn until the budget is spent
+		int numCyclesRemaining = mNumSearchCyclesPerUpdate;
+		while (numCyclesRemaining-- > 0 && !mActiveSearches.empty())
+		{
+			if (mNextSearch >= mActiveSearches.size()) mNextSearch = 0;
+
+			const Search search = mActiveSearches[mNextSearch];
+			const GraphSearchTimeSliced::Status status = search.pPlanner->cycleOnce();
+			if (status == GraphSearchTimeSliced::SEARCH_INCOMPLETE)
+			{
+				++mNextSearch;
+				continue;
+			}
+
+			// Off the list before the planner hears of it, as it may ask again
+			mActiveSearches.erase(mActiveSearches.begin() + mNextSearch);
+			search.pPlanner->endSearch(status);
+			mFreeWorkspaces.push_back(search.pWorkspace);
+
+			activateWaitingSearches();
+		}
+	}
+
+	int PathManager::getNumActiveSearches() const
+	{
+		return (int)mActiveSearches.size();
+	}
+
+	int PathManager::getNumSearchCyclesPerUpdate() const
+	{
+		return mNumSearchCyclesPerUpdate;
+	}
+
+	void PathManager::setNumSearchCyclesPerUpdate(int numCycles)
+	{
+		mNumSearchCyclesPerUpdate = numCycles;
+	}
+
+	void PathManager::activateWaitingSearches()
+	{
+		while (!mWaitingPlanners.empty() && !mFreeWorkspaces.empty())
+		{
+			Search search{ mWaitingPlanners.front(), mFreeWorkspaces.back() };
+			mWaitingPlanners.pop_front();
+			mFreeWorkspaces.pop_back();
+
+			mActiveSearches.push_back(search);
+			search.pPlanner->beginSearch(*search.pWorkspace);
+		}
+	}
+}
@@ -0,0 +1,57 @@
+#ifndef TE_PATH_MANAGER_H
+#define TE_PATH_MANAGER_H
+
+#include "graph_search_workspace.h"
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace te
+{
+	class PathPlanner;
+
+	// Advances the searches of the planners waiting on a path by a fixed
+	// number of search cycles each update, however many there are. A planner
+	// hears of its path through the message dispatcher once its search ends.
+	class PathManager
+	{
+	public:
+		static std::unique_ptr<PathManager> make(int numSearchCyclesPerUpdate, int maxActiveSearches);
+
+		// Queues the planner's request until one of the workspaces is free
+		void registerPlanner(PathPlanner& planner);
+		void unregisterPlanner(PathPlanner& planner);
+		void updateSearches();
+
+		int getNumActiveSearches() const;
+		int getNumSearchCyclesPerUpdate() const;
+		void setNumSearchCyclesPerUpdate(int numCycles);
+
+	private:
+		typedef GraphSearchWorkspace Workspace;
+
+		struct Search
+		{
+			PathPlanner* pPlanner;
+			Workspace* pWorkspace;
+		};
+
+		PathManager(int numSearchCyclesPerUpdate, int maxActiveSearches);
+
+		PathManager(const PathManager&) = delete;
+		PathManager& operator=(const PathManager&) = delete;
+
+		void activateWaitingSearches();
+
+		int mNumSearchCyclesPerUpdate;
+		std::vector<std::unique_ptr<Workspace>> mWorkspaces;
+		std::vector<Workspace*> mFreeWorkspaces;
+		std::deque<PathPlanner*> mWaitingPlanners;
+		std::vector<Search> mActiveSearches;
+		// Where the next update carries on cycling the active searches
+		size_t mNextSearch;
+	};
+}
+
+#endif
@@ -2,54 +2,322 @@
 #include "moving_entity.h"
 #include "game.h"
 #include "graph_search_a_star.h"
+#include "graph_search_time_sliced.h"
+#include "jump_point_search.h"
+#include "message_dispatcher.h"
+#include "path_manager.h"
 #include "vector_ops.h"
 
+#include <algorithm>
+#include <cstdlib>
 #include <limits>
+#include <vector>
 
 namespace te
 {
+	namespace
+	{
+		// Four clusters of the map's nav hierarchy
+		const int HIERARCHICAL_DISTANCE = 64;
+	}
+
 	PathPlanner::PathPlanner(MovingEntity& owner)
 		: mOwner(owner)
-		, mNavGraph(mOwner.getWorld().getMap().getNavGraph())
 		, mDestinationPosition(0.f, 0.f)
+		, mSearchMethod(SearchJumpPoint)
+		, mHierarchicalDistance(HIERARCHICAL_DISTANCE)
+		, mbPathPending(false)
+		, mbDestinationInSight(false)
+		, mSourceNode(NoClosestNodeFound)
+		, mTargetNode(NoClosestNodeFound)
+		, mSourceCell()
+		, mTargetCell()
+		, mNavRevision(0)
+		, mpWorkspace(nullptr)
+		, mpSearch()
+		, mPath()
+		, mPathIndices()
+		, mAbstractPath()
+		, mNeighbors()
+		, mNeighborPaths()
+		, mNeighborObstructed()
 	{}
 
-	bool PathPlanner::createPathToPosition(sf::Vector2f targetPos, std::list<sf::Vector2f>& path)
+	PathPlanner::~PathPlanner()
+	{
+		cancelRequest();
+	}
+
+	bool PathPlanner::createPathToPosition(sf::Vector2f targetPos, std::vector<sf::Vector2f>& path)
+	{
+		cancelRequest();
+
+		if (!prepareSearch(targetPos))
+		{
+			return false;
+		}
+
+		beginSearch(mOwner.getWorld().getMap().getSearchWorkspace());
+
+		GraphSearchTimeSliced::Status status;
+		while ((status = cycleOnce()) == GraphSearchTimeSliced::SEARCH_INCOMPLETE);
+
+		const bool isPathFound = status == GraphSearchTimeSliced::TARGET_FOUND && buildPath(path);
+		mpSearch.reset();
+		mpWorkspace = nullptr;
+		return isPathFound;
+	}
+
+	bool PathPlanner::requestPathToPosition(sf::Vector2f targetPos)
+	{
+		if (mbPathPending && targetPos == mDestinationPosition)
+		{
+			return true;
+		}
+
+		mPath.clear();
+		if (!prepareSearch(targetPos))
+		{
+			cancelRequest();
+			return false;
+		}
+
+		// A search already under way starts over in its workspace
+		if (mpWorkspace)
+		{
+			beginSearch(*mpWorkspace);
+		}
+		else if (!mbPathPending)
+		{
+			mOwner.getWorld().getPathManager().registerPlanner(*this);
+		}
+		mbPathPending = true;
+		return true;
+	}
+
+	bool PathPlanner::hasPendingRequest() const
+	{
+		return mbPathPending;
+	}
+
+	void PathPlanner::getPath(std::vector<sf::Vector2f>& path)
+	{
+		path.insert(path.end(), mPath.begin(), mPath.end());
+		mPath.clear();
+	}
+
+	bool PathPlanner::hasUnrefinedPath() const
+	{
+		return !mAbstractPath.empty();
+	}
+
+	bool PathPlanner::refinePath(std::vector<sf::Vector2f>& path)
+	{
+		if (mAbstractPath.empty())
+		{
+			return false;
+		}
+
+		TileMap& map = mOwner.getWorld().getMap();
+		const HierarchicalNavGraph& hierarchy = map.getNavHierarchy();
+		const OccupancyGrid& grid = map.getNavGrid();
+
+		// Steps across cluster borders are taken as they are, up to the next
+		// stretch through a cluster
+		bool isStretchRefined = false;
+		while (mAbstractPath.size() > 1 && !isStretchRefined)
+		{
+			const int from = mAbstractPath.back();
+			mAbstractPath.pop_back();
+			if (!hierarchy.refinePath(from, mAbstractPath.back(), map.getSearchWorkspace(), mPathIndices))
+			{
+				mAbstractPath.clear();
+				return false;
+			}
+
+			// The path already ends at from
+			mPathIndices.pop_back();
+			isStretchRefined = mPathIndices.size() > 1;
+			convertCellsToVectors(grid, mPathIndices, path);
+		}
+
+		if (mAbstractPath.size() == 1)
+		{
+			mAbstractPath.clear();
+			path.push_back(mDestinationPosition);
+		}
+		return true;
+	}
+
+	PathPlanner::SearchMethod PathPlanner::getSearchMethod() const
+	{
+		return mSearchMethod;
+	}
+
+	void PathPlanner::setSearchMethod(SearchMethod method)
+	{
+		mSearchMethod = method;
+	}
+
+	int PathPlanner::getHierarchicalDistance() const
+	{
+		return mHierarchicalDistance;
+	}
+
+	void PathPlanner::setHierarchicalDistance(int tiles)
+	{
+		mHierarchicalDistance = tiles;
+	}
+
+	bool PathPlanner::prepareSearch(sf::Vector2f targetPos)
 	{
 		mDestinationPosition = targetPos;
+		mAbstractPath.clear();
 
-		if (!mOwner.getWorld().isPathObstructed(mOwner.getPosition(), targetPos, mOwner.getBoundingRadius()))
+		TileMap& map = mOwner.getWorld().getMap();
+		mNavRevision = map.getNavRevision();
+
+		mbDestinationInSight = !mOwner.getWorld().isPathObstructed(mOwner.getPosition(), targetPos, mOwner.getBoundingRadius());
+		if (mbDestinationInSight)
 		{
-			path.push_back(targetPos);
 			return true;
 		}
 
-		int closestNode = getClosestNodeToPosition(mOwner.getPosition());
+		mSourceNode = getClosestNodeToPosition(mOwner.getPosition());
 
-		if (closestNode == NoClosestNodeFound)
+		if (mSourceNode == NoClosestNodeFound)
 		{
 			return false;
 		}
 
-		int closestNodeToTarget = getClosestNodeToPosition(targetPos);
+		mTargetNode = getClosestNodeToPosition(targetPos);
 
-		if (closestNodeToTarget == NoClosestNodeFound)
+		if (mTargetNode == NoClosestNodeFound)
 		{
 			return false;
 		}
 
-		typedef GraphSearchAStar<TileMap::NavGraph, HeuristicEuclid> AStar;
-		AStar search(mNavGraph, closestNode, closestNodeToTarget);
+		// Each node sits at the centre of its tile's cell
+		const OccupancyGrid& grid = map.getNavGrid();
+		mSourceCell = grid.getCell(map.getNavGraph().getNode(mSourceNode).getPosition());
+		mTargetCell = grid.getCell(map.getNavGraph().getNode(mTargetNode).getPosition());
+		return true;
+	}
 
-		std::list<int> pathOfNodeIndices = search.getPathToTarget();
-		if (!pathOfNodeIndices.empty())
+	void PathPlanner::beginSearch(Workspace& workspace)
+	{
+		mpWorkspace = &workspace;
+		mpSearch.reset();
+
+		// A request prepared before the nav graph or the map last changed is
+		// prepared again by cycleOnce
+		TileMap& map = mOwner.getWorld().getMap();
+		if (mbDestinationInSight || isHierarchicalSearch() || mNavRevision != map.getNavRevision())
 		{
-			convertIndicesToVectors(pathOfNodeIndices, path);
-			path.push_back(targetPos);
+			return;
+		}
+
+		if (mSearchMethod == SearchJumpPoint)
+		{
+			mpSearch = std::make_unique<JumpPointSearch>(map.getJumpPointGrid(), mSourceCell, mTargetCell, workspace);
+		}
+		else
+		{
+			typedef GraphSearchAStarTimeSliced<CsrGraph, HeuristicEuclid> AStar;
+			mpSearch = std::make_unique<AStar>(map.getSearchGraph(), mSourceNode, mTargetNode, workspace);
+		}
+	}
+
+	GraphSearchTimeSliced::Status PathPlanner::cycleOnce()
+	{
+		TileMap& map = mOwner.getWorld().getMap();
+
+		// The grids and graphs searched are rebuilt when the nav graph changes
+		if (mNavRevision != map.getNavRevision())
+		{
+			if (!prepareSearch(mDestinationPosition))
+			{
+				return GraphSearchTimeSliced::TARGET_NOT_FOUND;
+			}
+			beginSearch(*mpWorkspace);
+		}
+
+		if (mpSearch)
+		{
+			return mpSearch->cycleOnce();
+		}
+
+		if (mbDestinationInSight || map.getNavHierarchy().findPath(mSourceCell, mTargetCell, *mpWorkspace, mAbstractPath))
+		{
+			return GraphSearchTimeSliced::TARGET_FOUND;
+		}
+		return GraphSearchTimeSliced::TARGET_NOT_FOUND;
+	}
+
+	void PathPlanner::endSearch(GraphSearchTimeSliced::Status status)
+	{
+		if (status != GraphSearchTimeSliced::TARGET_FOUND || !buildPath(mPath))
+		{
+			mPath.clear();
+			status = GraphSearchTimeSliced::TARGET_NOT_FOUND;
+		}
+
+		mpSearch.reset();
+		mpWorkspace = nullptr;
+		mbPathPending = false;
+
+		const int msg = status == GraphSearchTimeSliced::TARGET_FOUND ? PathReady : NoPathAvailable;
+		mOwner.getWorld().getMessageDispatcher().dispatchMessage(0.0, -1, mOwner.getID(), msg, nullptr);
+	}
+
+	bool PathPlanner::buildPath(std::vector<sf::Vector2f>& path)
+	{
+		if (mbDestinationInSight)
+		{
+			path.push_back(mDestinationPosition);
 			return true;
 		}
 
-		return false;
+		const OccupancyGrid& grid = mOwner.getWorld().getMap().getNavGrid();
+		if (!mpSearch)
+		{
+			path.push_back(grid.getCellCentre(mSourceCell.x, mSourceCell.y));
+			return refinePath(path);
+		}
+
+		mpSearch->getPathToTarget(mPathIndices);
+		if (mPathIndices.empty())
+		{
+			return false;
+		}
+
+		if (mSearchMethod == SearchJumpPoint)
+		{
+			convertCellsToVectors(grid, mPathIndices, path);
+		}
+		else
+		{
+			convertIndicesToVectors(mPathIndices, path);
+		}
+		path.push_back(mDestinationPosition);
+		return true;
+	}
+
+	void PathPlanner::cancelRequest()
+	{
+		if (mbPathPending)
+		{
+			mOwner.getWorld().getPathManager().unregisterPlanner(*this);
+		}
+
+		mpSearch.reset();
+		mpWorkspace = nullptr;
+		mbPathPending = false;
+	}
+
+	bool PathPlanner::isHierarchicalSearch() const
+	{
+		return std::max(std::abs(mTargetCell.x - mSourceCell.x), std::abs(mTargetCell.y - mSourceCell.y)) > mHierarchicalDistance;
 	}
 
 	int PathPlanner::getClosestNodeToPosition(sf::Vector2f pos) const
@@ -62,15 +330,26 @@ namespace te
 		TileMap::NavCellSpace& cellSpace = mOwner.getWorld().getMap().getCellSpace();
 		cellSpace.calculateNeighbors(pos, range);
 
+		// Test the line to every neighbor in one batch
+		mNeighbors.clear();
+		mNeighborPaths.clear();
 		for (const TileMap::NavGraph::Node* pNode = cellSpace.begin(); !cellSpace.end(); pNode = cellSpace.next())
 		{
-			if (!mOwner.getWorld().isPathObstructed(pNode->getPosition(), pos, mOwner.getBoundingRadius()))
+			mNeighbors.push_back(pNode);
+			mNeighborPaths.push_back({ pNode->getPosition(), pos, mOwner.getBoundingRadius() });
+		}
+
+		mOwner.getWorld().isPathObstructed(mNeighborPaths, mNeighborObstructed);
+
+		for (size_t i = 0; i < mNeighbors.size(); ++i)
+		{
+			if (!mNeighborObstructed[i])
 			{
-				float dist = distanceSq(pos, pNode->getPosition());
+				float dist = distanceSq(pos, mNeighbors[i]->getPosition());
 				if (dist < closestSoFar)
 				{
 					closestSoFar = dist;
-					closestNode = pNode->getIndex();
+					closestNode = mNeighbors[i]->getIndex();
 				}
 			}
 		}
@@ -78,9 +357,17 @@ namespace te
 		return closestNode;
 	}
 
-	void PathPlanner::convertIndicesToVectors(const std::list<int> pathOfNodeIndices, std::list<sf::Vector2f>& path)
+	void PathPlanner::convertIndicesToVectors(const std::vector<int>& pathOfNodeIndices, std::vector<sf::Vector2f>& path)
+	{
+		const TileMap::NavGraph& navGraph = mOwner.getWorld().getMap().getNavGraph();
+		for (auto it = pathOfNodeIndices.rbegin(); it != pathOfNodeIndices.rend(); ++it)
+			path.push_back(navGraph.getNode(*it).getPosition());
+	}
+
+	void PathPlanner::convertCellsToVectors(const OccupancyGrid& grid, const std::vector<int>& pathOfCells, std::vector<sf::Vector2f>& path)
 	{
-		for (int index : pathOfNodeIndices)
-			path.push_front(mNavGraph.getNode(index).getPosition());
+		const int width = grid.getNumCellsX();
+		for (auto it = pathOfCells.rbegin(); it != pathOfCells.rend(); ++it)
+			path.push_back(grid.getCellCentre(*it % width, *it / width));
 	}
 }
@@ -1,11 +1,13 @@
 #ifndef TE_PATH_PLANNER_H
 #define TE_PATH_PLANNER_H
 
+#include "graph_search_time_sliced.h"
 #include "tile_map.h"
 
 #include <SFML/Graphics.hpp>
 
-#include <list>
+#include <memory>
+#include <vector>
 
 namespace te
 {
@@ -14,21 +16,88 @@ namespace te
 	class PathPlanner
 	{
 	public:
+		// Both find a shortest path through the nav graph. Jump point search
+		// searches the tile grid under it and expands far fewer nodes.
+		enum SearchMethod { SearchAStar, SearchJumpPoint };
+		// Sent to the owner when a requested path is found or not
+		enum Message { PathReady, NoPathAvailable };
+
 		PathPlanner(MovingEntity& owner);
-		bool createPathToPosition(sf::Vector2f targetPosition, std::list<sf::Vector2f>& path);
+		~PathPlanner();
+
+		// Searches for the whole path at once, cancelling any request
+		bool createPathToPosition(sf::Vector2f targetPosition, std::vector<sf::Vector2f>& path);
+		// Hands the search to the world's path manager, which sends the owner
+		// a Message when it ends. False if either end is off the nav graph.
+		// A request to the destination already pending is left to carry on.
+		bool requestPathToPosition(sf::Vector2f targetPosition);
+		bool hasPendingRequest() const;
+		// Drops the pending request without its message being sent
+		void cancelRequest();
+		// Appends the path found for the last request
+		void getPath(std::vector<sf::Vector2f>& path);
+		// Paths to targets more tiles away than the hierarchical distance are
+		// found over the map's clusters and handed out a stretch at a time
+		bool hasUnrefinedPath() const;
+		// Appends the next stretch of the last path; false if there is none or
+		// the map has changed so that it is blocked
+		bool refinePath(std::vector<sf::Vector2f>& path);
+		SearchMethod getSearchMethod() const;
+		void setSearchMethod(SearchMethod method);
+		int getHierarchicalDistance() const;
+		void setHierarchicalDistance(int tiles);
 
 	private:
+		friend class PathManager;
+
+		typedef GraphSearchWorkspace Workspace;
+
 		PathPlanner(const PathPlanner&) = delete;
 		PathPlanner& operator=(const PathPlanner&) = delete;
 
 		enum { NoClosestNodeFound = -1 };
 
+		// Finds the ends of a search to targetPos; false if there is none
+		bool prepareSearch(sf::Vector2f targetPos);
+		// Called by the path manager, one cycle of the search at a time
+		void beginSearch(Workspace& workspace);
+		GraphSearchTimeSliced::Status cycleOnce();
+		void endSearch(GraphSearchTimeSliced::Status status);
+		// Appends the path the search found; false if it is blocked
+		bool buildPath(std::vector<sf::Vector2f>& path);
+		// Whether the ends are far enough apart to search the nav hierarchy
+		bool isHierarchicalSearch() const;
+
 		int getClosestNodeToPosition(sf::Vector2f pos) const;
-		void convertIndicesToVectors(const std::list<int> pathOfNodeIndices, std::list<sf::Vector2f>& path);
+		void convertIndicesToVectors(const std::vector<int>& pathOfNodeIndices, std::vector<sf::Vector2f>& path);
+		void convertCellsToVectors(const OccupancyGrid& grid, const std::vector<int>& pathOfCells, std::vector<sf::Vector2f>& path);
 
 		MovingEntity& mOwner;
-		const TileMap::NavGraph& mNavGraph;
 		sf::Vector2f mDestinationPosition;
+		SearchMethod mSearchMethod;
+		int mHierarchicalDistance;
+		// The search in hand, with its nodes and cells. Without a search the
+		// path is either straight to the destination in sight, or one found
+		// over the nav hierarchy in a single cycle.
+		bool mbPathPending;
+		bool mbDestinationInSight;
+		int mSourceNode;
+		int mTargetNode;
+		sf::Vector2i mSourceCell;
+		sf::Vector2i mTargetCell;
+		int mNavRevision;
+		Workspace* mpWorkspace;
+		std::unique_ptr<GraphSearchTimeSliced> mpSearch;
+		// Kept between requests so they reuse their storage. Node indices for
+		// A*, cell indices otherwise.
+		std::vector<sf::Vector2f> mPath;
+		std::vector<int> mPathIndices;
+		// The cells of the last hierarchical path still to be refined, from
+		// the target back to where the path handed out so far ends
+		std::vector<int> mAbstractPath;
+		mutable std::vector<const TileMap::NavGraph::Node*> mNeighbors;
+		mutable std::vector<WallGrid::Sweep> mNeighborPaths;
+		mutable std::vector<char> mNeighborObstructed;
 	};
 }
 
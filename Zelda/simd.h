@@ -0,0 +1,11 @@
+#ifndef TE_SIMD_H
+#define TE_SIMD_H
+
+// TE_SSE is defined when SSE intrinsics can be used; code using them keeps a
+// scalar path for when it is not
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1) || defined(__SSE__)
+#define TE_SSE
+#include <xmmintrin.h>
+#endif
+
+#endif
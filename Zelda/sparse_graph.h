@@ -87,6 +87,34 @@ namespace te
 			mNodes.at(node).setIndex(Node::INVALID_INDEX);
 		}
 
+		// Reuses the index of a removed node. Any edges it had must have been
+		// removed with removeNodeEdges first.
+		void restoreNode(int index, Node node)
+		{
+			if (index < 0 || (unsigned)index >= mNodes.size() || isValid(index))
+				throw std::runtime_error("Given node index is not a removed node.");
+			node.setIndex(index);
+			mNodes.at(index) = node;
+		}
+
+		void removeNodeEdges(int node)
+		{
+			throwIfInvalid(node);
+
+			EdgeList& edgeList = mEdges.at(node);
+			if (!mbDigraph)
+			{
+				for (auto& edge : edgeList)
+				{
+					EdgeList& reverseList = mEdges.at(edge.getTo());
+					reverseList.remove_if([node](const Edge& reverseEdge) {
+						return reverseEdge.getTo() == node;
+					});
+				}
+			}
+			edgeList.clear();
+		}
+
 		void addEdge(const Edge& edge)
 		{
 			throwIfInvalid(edge.getFrom());
@@ -176,6 +204,17 @@ namespace te
 			});
 		}
 
+		// Calls fn(to, cost) for each edge from node to a present node
+		template <class Fn>
+		void forEachEdge(int node, Fn fn) const
+		{
+			throwIfInvalid(node);
+			for (const Edge& edge : mEdges[node])
+			{
+				if (isValid(edge.getTo())) fn(edge.getTo(), edge.getCost());
+			}
+		}
+
 		void prepareVerticesForDrawing() {}
 
 		class ConstEdgeIterator
@@ -230,6 +269,7 @@ namespace te
 			const Node* begin()
 			{
 				mIter = mGraph.mNodes.begin();
+				if (!end() && mIter->getIndex() == Node::INVALID_INDEX) next();
 				return !end() ? &(*mIter) : nullptr;
 			}
 
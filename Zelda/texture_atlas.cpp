@@ -1,5 +1,6 @@
 #include "texture_atlas.h"
 #include "texture_manager.h"
+#include "xml_parse.h"
 
 #include <rapidxml.hpp>
 #include <rapidxml_utils.hpp>
@@ -24,29 +25,29 @@ namespace te
 		rapidxml::xml_document<> atlasXML;
 		atlasXML.parse<0>(atlasFile.data());
 
-		rapidxml::xml_node<char>* pAtlasNode = atlasXML.first_node("TextureAtlas");
+		const XmlNode& atlasNode = getXmlChild(atlasXML, "TextureAtlas");
 
 		std::string dir = "";
 		std::string delim = "/";
 		auto result = std::find_end(filename.begin(), filename.end(), delim.begin(), delim.end());
 		if (result != filename.end()) dir = std::string(filename.begin(), result + 1);
 
-		mWidth = std::stoi(pAtlasNode->first_attribute("width")->value());
-		mHeight = std::stoi(pAtlasNode->first_attribute("height")->value());
-		std::string imagePath = dir + pAtlasNode->first_attribute("imagePath")->value();
+		mWidth = getXmlInt(atlasNode, "width");
+		mHeight = getXmlInt(atlasNode, "height");
+		std::string imagePath = dir + getXmlString(atlasNode, "imagePath");
 		if (pTM) pTM->load(imagePath);
 		mImagePathID = TextureManager::getID(imagePath);
 
-		for (auto* pSprite = pAtlasNode->first_node("sprite"); pSprite != 0; pSprite = pSprite->next_sibling("sprite"))
+		for (const XmlNode* pSprite = atlasNode.first_node("sprite"); pSprite != 0; pSprite = pSprite->next_sibling("sprite"))
 		{
-			size_t filenameHash = TextureManager::getID(pSprite->first_attribute("n")->value());
+			size_t filenameHash = TextureManager::getID(getXmlString(*pSprite, "n"));
 			mSprites.insert(std::make_pair(filenameHash, Sprite{
-				std::stof(pSprite->first_attribute("pX")->value()),
-				std::stof(pSprite->first_attribute("pY")->value()),
-				std::stoi(pSprite->first_attribute("w")->value()),
-				std::stoi(pSprite->first_attribute("h")->value()),
-				std::stoi(pSprite->first_attribute("x")->value()),
-				std::stoi(pSprite->first_attribute("y")->value()),
+				getXmlFloat(*pSprite, "pX"),
+				getXmlFloat(*pSprite, "pY"),
+				getXmlInt(*pSprite, "w"),
+				getXmlInt(*pSprite, "h"),
+				getXmlInt(*pSprite, "x"),
+				getXmlInt(*pSprite, "y"),
 				filenameHash
 			}));
 		}
@@ -37,6 +37,21 @@ namespace te
 		}
 	}
 
+	TextureID TextureManager::load(const std::string& filename, const sf::Image& image)
+	{
+		TextureID id = getID(filename);
+		if (mTextures.find(id) == mTextures.end())
+		{
+			auto texture = std::make_unique<sf::Texture>();
+			if (!texture->loadFromImage(image))
+			{
+				throw std::runtime_error("Texture could not be created from image.");
+			}
+			mTextures.insert({ id, std::move(texture) });
+		}
+		return id;
+	}
+
 	TextureID TextureManager::loadSpritesheet(const std::string& filename)
 	{
 		auto atlas = TextureAtlas::make(filename, this);
@@ -12,6 +12,7 @@ namespace sf
 {
 	class Texture;
 	class Sprite;
+	class Image;
 }
 
 namespace te
@@ -24,6 +25,8 @@ namespace te
 		static TextureID getID(const std::string& filename);
 
 		TextureID load(const std::string& filename);
+		// Uploads an image that was already decoded, e.g. on a loader thread
+		TextureID load(const std::string& filename, const sf::Image& image);
 		TextureID loadSpritesheet(const std::string& xmlFile);
 		void loadAnimations(const std::string& filename);
 
@@ -1,87 +1,1142 @@
 #include "tile_map.h"
 #include "texture_manager.h"
 #include "vector_ops.h"
+#include "graph_functions.h"
 #include "game.h"
 
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
 #include <limits>
+#include <unordered_map>
 
 namespace te
 {
-	static float calculateAverageGraphEdgeLength(const TileMap::NavGraph& navGraph)
+	namespace
 	{
-		float totalLength = 0;
-		int numEdgesCounted = 0;
+		// Nav nodes are only kept for the tiles a 4-way flood reaches
+		const std::array<sf::Vector2i, 4> NAV_FLOOD_OFFSETS = {
+			sf::Vector2i(1, 0), sf::Vector2i(-1, 0), sf::Vector2i(0, 1), sf::Vector2i(0, -1)
+		};
 
-		TileMap::NavGraph::ConstNodeIterator nodeIter(navGraph);
+		// Counted across every map, so that a planner notices a map swap too
+		int getNextNavRevision()
+		{
+			static int revision = 0;
+			return ++revision;
+		}
+	}
+
+	const int TileMap::MAX_PENDING_CHUNKS = 4;
+	const int TileMap::NAV_CLUSTER_SIZE = 16;
+
+	std::unique_ptr<TileMap::Build> TileMap::build(TMX& tmx, const sf::Transform& transform)
+	{
+		tmx.compile();
+
+		auto pBuild = std::make_unique<Build>();
+		Build& build = *pBuild;
+		build.colliderRects = tmx.getColliderRects();
+		build.colliderOutlines = tmx.getColliderOutlines();
+		const sf::IntRect region(0, 0, tmx.getWidth(), tmx.getHeight());
+
+		// Once compiled the stages only read the TMX, so they run side by side with the nav graph build
+		auto vertices = std::async(std::launch::async, [&tmx, &build, region]() {
+			tmx.makeVertices(region, build.layers);
+		});
+		auto collider = std::async(std::launch::async, [&tmx, &transform]() {
+			return std::unique_ptr<CompositeCollider>(tmx.makeCollider(transform));
+		});
+		auto walkable = std::async(std::launch::async, [&tmx, &build, region]() {
+			tmx.makeWalkable(build.colliderRects, build.colliderOutlines, region, build.walkable);
+		});
+
+		build.pNavGraph = std::unique_ptr<NavGraph>(tmx.makeNavGraph(transform));
+
+		build.cellSpaceNeighborhoodRange = calculateAverageGraphEdgeLength(*build.pNavGraph) + 1;
+
+		sf::FloatRect bounds = transform.transformRect({ 0, 0, (float)tmx.getTileWidth() * tmx.getWidth(), (float)tmx.getTileHeight() * tmx.getHeight() });
+		build.pCellSpacePartition = std::make_unique<NavCellSpace>(bounds.left + bounds.width, bounds.top + bounds.height, std::max(tmx.getWidth() / 4, 1), std::max(tmx.getHeight() / 4, 1), build.pNavGraph->numNodes());
+		build.pWallGrid = std::make_unique<WallGrid>(bounds, tmx.getWidth(), tmx.getHeight());
+		build.pOccupancy = std::make_unique<OccupancyGrid>(bounds, tmx.getWidth(), tmx.getHeight());
+
+		TileMap::NavGraph::ConstNodeIterator nodeIter(*build.pNavGraph);
 		for (const TileMap::NavGraph::Node* pNode = nodeIter.begin(); !nodeIter.end(); pNode = nodeIter.next())
 		{
-			TileMap::NavGraph::ConstEdgeIterator edgeIter(navGraph, pNode->getIndex());
-			for (const TileMap::NavGraph::Edge* pEdge = edgeIter.begin(); !edgeIter.end(); pEdge = edgeIter.next())
+			build.pCellSpacePartition->addEntity(pNode);
+		}
+
+		vertices.get();
+
+		build.pCollider = collider.get();
+		build.pWallGrid->build(build.pCollider->getWalls());
+
+		walkable.get();
+		for (int y = 0; y < tmx.getHeight(); ++y)
+		{
+			for (int x = 0; x < tmx.getWidth(); ++x)
 			{
-				++numEdgesCounted;
-				totalLength += distance(navGraph.getNode(pEdge->getFrom()).getPosition(), navGraph.getNode(pEdge->getTo()).getPosition());
+				build.pOccupancy->setSolid(x, y, !build.walkable[y * tmx.getWidth() + x]);
 			}
 		}
 
-		return totalLength / numEdgesCounted;
+		return pBuild;
 	}
 
-	TileMap::TileMap(Game& world, TextureManager& textureManager, const TMX& tmx)
+	TileMap::TileMap(Game& world, TextureManager& textureManager, std::shared_ptr<TMX> pTMX)
+		: TileMap(world, textureManager, pTMX, pTMX ? build(*pTMX, world.getPixelToWorldTransform()) : nullptr)
+	{}
+
+	TileMap::TileMap(Game& world, TextureManager& textureManager, std::shared_ptr<TMX> pTMX, std::unique_ptr<Build> pBuild)
 		: BaseGameEntity(world, b2BodyDef())
 		, mWorld(world)
 		, mTextures()
+		, mChunks()
 		, mpCollider(nullptr)
+		, mpWorldCollider(nullptr)
+		, mWorldColliderTransform()
+		, mpWallGrid(nullptr)
+		, mRemovedWalls()
+		, mAddedWalls()
+		, mpOccupancy(nullptr)
+		, mbTileAligned(false)
 		, mpNavGraph(nullptr)
+		, mpSearchGraph(nullptr)
+		, mDirtyNavNodes()
+		, mDirtyNavTiles()
+		, mpNavGrid(nullptr)
+		, mpJumpPointGrid(nullptr)
+		, mpNavHierarchy(nullptr)
+		, mDirtyNavClusters()
+		, mNavRevision(getNextNavRevision())
+		, mSearchWorkspace()
 		, mDrawFlags(0)
 		, mCellSpaceNeighborhoodRange(1)
 		, mpCellSpacePartition(nullptr)
+		, mpTMX(std::move(pTMX))
+		, mChunkSize(0)
+		, mLoadRadius(0)
+		, mNumChunksX(1)
+		, mNumChunksY(1)
+		, mFocusChunk()
+		, mPendingChunks()
+		, mFreeSlots()
+		, mWalkable()
 	{
+		if (!mpTMX) throw std::runtime_error("Must supply TMX to TileMap.");
+		if (!pBuild) throw std::runtime_error("Must supply the TMX's build to TileMap.");
+
 		setDrawOrder(std::numeric_limits<int>::max());
 
-		std::vector<std::vector<sf::VertexArray>> layers;
-		tmx.makeVertices(textureManager, mTextures, layers);
-		for (auto it = layers.begin(); it != layers.end(); ++it)
+		const TMX& tmx = *mpTMX;
+		Build& build = *pBuild;
+
+		Chunk& chunk = mChunks[0];
+		chunk.slot = 0;
+		chunk.layers = std::move(build.layers);
+		chunk.colliderRects = std::move(build.colliderRects);
+		chunk.colliderOutlines = std::move(build.colliderOutlines);
+		tmx.loadTextures(textureManager, mTextures);
+
+		for (auto& layer : chunk.layers)
 		{
-			int index = it - layers.begin();
-			if (it->size() != mTextures.size()) {
+			if (layer.size() != mTextures.size()) {
 				throw std::runtime_error("Texture and layer component counts are inconsistent.");
 			}
-			auto pLayer = std::make_unique<Layer>(mWorld, std::move(*it), mTextures);
+		}
+		attachLayers(chunk.layers.size());
+
+		mpCollider = std::move(build.pCollider);
+		mpWallGrid = std::move(build.pWallGrid);
+		mpOccupancy = std::move(build.pOccupancy);
+		mbTileAligned = tmx.isTileAligned();
+		mpNavGraph = std::move(build.pNavGraph);
+		mCellSpaceNeighborhoodRange = build.cellSpaceNeighborhoodRange;
+		mpCellSpacePartition = std::move(build.pCellSpacePartition);
+		mWalkable = std::move(build.walkable);
+
+		mpCollider->createFixtures(getBody(), chunk.fixtures, chunk.chainFixtures);
+	}
+
+	TileMap::TileMap(Game& world, TextureManager& textureManager, std::shared_ptr<TMX> pTMX, int chunkSize, int loadRadius)
+		: BaseGameEntity(world, b2BodyDef())
+		, mWorld(world)
+		, mTextures()
+		, mChunks()
+		, mpCollider(std::make_unique<CompositeCollider>())
+		, mpWorldCollider(nullptr)
+		, mWorldColliderTransform()
+		, mpWallGrid(nullptr)
+		, mRemovedWalls()
+		, mAddedWalls()
+		, mpOccupancy(nullptr)
+		, mbTileAligned(false)
+		, mpNavGraph(std::make_unique<NavGraph>())
+		, mpSearchGraph(nullptr)
+		, mDirtyNavNodes()
+		, mDirtyNavTiles()
+		, mpNavGrid(nullptr)
+		, mpJumpPointGrid(nullptr)
+		, mpNavHierarchy(nullptr)
+		, mDirtyNavClusters()
+		, mNavRevision(getNextNavRevision())
+		, mSearchWorkspace()
+		, mDrawFlags(0)
+		, mCellSpaceNeighborhoodRange(1)
+		, mpCellSpacePartition(nullptr)
+		, mpTMX(std::move(pTMX))
+		, mChunkSize(chunkSize)
+		, mLoadRadius(loadRadius)
+		, mNumChunksX(0)
+		, mNumChunksY(0)
+		, mFocusChunk()
+		, mPendingChunks()
+		, mFreeSlots()
+		, mWalkable()
+	{
+		if (!mpTMX) throw std::runtime_error("Must supply TMX to TileMap.");
+		if (mChunkSize <= 0 || mLoadRadius < 0) throw std::runtime_error("Invalid TileMap streaming parameters.");
+
+		setDrawOrder(std::numeric_limits<int>::max());
+
+		const TMX& tmx = *mpTMX;
+		mNumChunksX = (tmx.getWidth() + mChunkSize - 1) / mChunkSize;
+		mNumChunksY = (tmx.getHeight() + mChunkSize - 1) / mChunkSize;
+
+		tmx.loadTextures(textureManager, mTextures);
+		attachLayers(tmx.getNumLayers());
+
+		// Evicting everything beyond loadRadius + 1 bounds how many chunks can
+		// be resident, so every node the graph will ever need is created up
+		// front and node pointers held by the cell space stay valid.
+		const int span = 2 * mLoadRadius + 3;
+		const int numSlots = std::min(span * span, mNumChunksX * mNumChunksY);
+		const int nodesPerSlot = mChunkSize * mChunkSize;
+		for (int i = 0; i < numSlots * nodesPerSlot; ++i)
+		{
+			int index = mpNavGraph->addNode(NavGraphNode());
+			mpNavGraph->removeNode(index);
+		}
+		for (int slot = numSlots - 1; slot >= 0; --slot)
+		{
+			mFreeSlots.push_back(slot);
+		}
+
+		const sf::Transform& transform = getWorld().getPixelToWorldTransform();
+		mCellSpaceNeighborhoodRange = length(transform.transformPoint((float)tmx.getTileWidth(), (float)tmx.getTileHeight()) - transform.transformPoint(0, 0)) + 1;
+
+		sf::FloatRect bounds = transform.transformRect({ 0, 0, (float)tmx.getTileWidth() * tmx.getWidth(), (float)tmx.getTileHeight() * tmx.getHeight() });
+		mpCellSpacePartition = std::make_unique<NavCellSpace>(bounds.left + bounds.width, bounds.top + bounds.height, std::max(tmx.getWidth() / 4, 1), std::max(tmx.getHeight() / 4, 1), mpNavGraph->numNodes());
+		mpWallGrid = std::make_unique<WallGrid>(bounds, tmx.getWidth(), tmx.getHeight());
+		mpOccupancy = std::make_unique<OccupancyGrid>(bounds, tmx.getWidth(), tmx.getHeight());
+		mbTileAligned = tmx.isTileAligned();
+	}
+
+	bool TileMap::isStreaming() const
+	{
+		return mChunkSize > 0;
+	}
+
+	void TileMap::setStreamingFocus(sf::Vector2f position, bool wait)
+	{
+		if (!isStreaming()) return;
+
+		sf::Vector2f pixel = getWorld().getWorldToPixelTransform().transformPoint(position);
+		int x = (int)std::floor(pixel.x / mpTMX->getTileWidth()) / mChunkSize;
+		int y = (int)std::floor(pixel.y / mpTMX->getTileHeight()) / mChunkSize;
+		mFocusChunk.x = std::max(0, std::min(x, mNumChunksX - 1));
+		mFocusChunk.y = std::max(0, std::min(y, mNumChunksY - 1));
+
+		if (wait)
+		{
+			updateChunks(true);
+		}
+	}
+
+	int TileMap::getTile(int layer, int x, int y) const
+	{
+		return mpTMX->getTile(layer, x, y);
+	}
+
+	void TileMap::setTile(int layer, int x, int y, int gid)
+	{
+		// Workers read the tile grid, so let them finish before it changes
+		bool changed = harvestChunks(true);
+
+		TMX& tmx = *mpTMX;
+		const int oldGid = tmx.getTile(layer, x, y);
+		auto chunkIter = mChunks.find(getChunkKey(x, y));
+		if (chunkIter != mChunks.end() && chunkIter->second.tileQuads.empty())
+		{
+			indexQuads(chunkIter->second);
+		}
+		tmx.setTile(layer, x, y, gid);
+
+		if (chunkIter != mChunks.end() && oldGid != gid)
+		{
+			Chunk& chunk = chunkIter->second;
+			patchQuad(chunk, layer, x, y, oldGid, gid);
+			sf::IntRect area = patchCollider(chunk, x, y);
+			const sf::IntRect outlineArea = tmx.hasColliderOutlines(oldGid) || tmx.hasColliderOutlines(gid) ? patchOutlines(chunk) : sf::IntRect();
+			if (outlineArea.width > 0 && outlineArea.height > 0)
+			{
+				const int right = std::max(area.left + area.width, outlineArea.left + outlineArea.width);
+				const int bottom = std::max(area.top + area.height, outlineArea.top + outlineArea.height);
+				area.left = std::min(area.left, outlineArea.left);
+				area.top = std::min(area.top, outlineArea.top);
+				area.width = right - area.left;
+				area.height = bottom - area.top;
+			}
+			patchNavGraph(chunk, area);
+			changed = true;
+		}
+
+		if (changed)
+		{
+			if (isStreaming())
+				rebuildCollider();
+			rebuildColliderQueries();
+			updateNavSnapshots();
+			if ((mDrawFlags & NAV_GRAPH) > 0)
+				mpNavGraph->prepareVerticesForDrawing();
+		}
+	}
+
+	void TileMap::attachLayers(int numLayers)
+	{
+		for (int index = 0; index < numLayers; ++index)
+		{
+			auto pLayer = std::make_unique<Layer>(mWorld, *this, index);
 			pLayer->setDrawOrder(index);
 			attachNode(std::move(pLayer));
 		}
+	}
+
+	TileMap::ChunkBuild TileMap::buildChunk(const TMX& tmx, sf::IntRect region, sf::Transform transform)
+	{
+		ChunkBuild build;
+		tmx.makeVertices(region, build.layers);
+
+		tmx.makeColliderRects(region, build.colliderRects);
+		tmx.makeColliderOutlines(region, build.colliderOutlines);
+		build.pCollider = std::make_unique<CompositeCollider>();
+		for (auto& rect : build.colliderRects)
+		{
+			build.pCollider->addBox(transform.transformRect(rect));
+		}
+		for (auto& outline : build.colliderOutlines)
+		{
+			build.pCollider->addCollider(ChainCollider(outline.points, outline.loop).transform(transform));
+		}
+
+		tmx.makeWalkable(region, build.walkable);
+		return build;
+	}
+
+	sf::IntRect TileMap::getChunkRegion(sf::Vector2i coords) const
+	{
+		if (!isStreaming())
+		{
+			return { 0, 0, mpTMX->getWidth(), mpTMX->getHeight() };
+		}
+		int left = coords.x * mChunkSize;
+		int top = coords.y * mChunkSize;
+		return { left, top, std::min(mChunkSize, mpTMX->getWidth() - left), std::min(mChunkSize, mpTMX->getHeight() - top) };
+	}
+
+	int TileMap::getChunkKey(int x, int y) const
+	{
+		return isStreaming() ? (y / mChunkSize) * mNumChunksX + (x / mChunkSize) : 0;
+	}
+
+	int TileMap::getChunkDistance(sf::Vector2i coords) const
+	{
+		return std::max(std::abs(coords.x - mFocusChunk.x), std::abs(coords.y - mFocusChunk.y));
+	}
+
+	int TileMap::getTileNode(int x, int y) const
+	{
+		if (x < 0 || y < 0 || x >= mpTMX->getWidth() || y >= mpTMX->getHeight())
+		{
+			return NavGraph::Node::INVALID_INDEX;
+		}
+		if (!isStreaming())
+		{
+			return y * mpTMX->getWidth() + x;
+		}
+
+		auto chunkIter = mChunks.find(getChunkKey(x, y));
+		if (chunkIter == mChunks.end())
+		{
+			return NavGraph::Node::INVALID_INDEX;
+		}
+		return (chunkIter->second.slot * mChunkSize + (y % mChunkSize)) * mChunkSize + (x % mChunkSize);
+	}
+
+	bool TileMap::hasNavNode(int x, int y) const
+	{
+		int index = getTileNode(x, y);
+		return index != NavGraph::Node::INVALID_INDEX && mpNavGraph->isPresent(index);
+	}
+
+	void TileMap::addNavNode(int x, int y)
+	{
+		const TMX& tmx = *mpTMX;
+		const int index = getTileNode(x, y);
+
+		NavGraphNode node;
+		node.setPosition(getWorld().getPixelToWorldTransform().transformPoint((x + 0.5f) * tmx.getTileWidth(), (y + 0.5f) * tmx.getTileHeight()));
+		mpNavGraph->restoreNode(index, node);
+		const NavGraphNode& newNode = mpNavGraph->getNode(index);
+		mDirtyNavNodes.push_back(index);
+		mDirtyNavTiles.push_back({ x, y });
+
+		// Nodes are connected to whichever of their neighbours already exist,
+		// so every edge is added once, by the later of its two nodes
+		const std::array<sf::Vector2i, 8> offsets = {
+			sf::Vector2i(1, 0), sf::Vector2i(-1, 0), sf::Vector2i(0, 1), sf::Vector2i(0, -1),
+			sf::Vector2i(1, 1), sf::Vector2i(-1, 1), sf::Vector2i(-1, -1), sf::Vector2i(1, -1)
+		};
+		for (auto& offset : offsets)
+		{
+			if (hasNavNode(x + offset.x, y + offset.y))
+			{
+				int neighbor = getTileNode(x + offset.x, y + offset.y);
+				mpNavGraph->addEdge(NavGraphEdge(index, neighbor, distance(newNode.getPosition(), mpNavGraph->getNode(neighbor).getPosition())));
+				mDirtyNavNodes.push_back(neighbor);
+			}
+		}
+
+		mpCellSpacePartition->addEntity(&newNode);
+	}
+
+	void TileMap::removeNavNode(int x, int y)
+	{
+		const int index = getTileNode(x, y);
+		mpCellSpacePartition->removeEntity(&mpNavGraph->getNode(index));
+		mDirtyNavNodes.push_back(index);
+		mDirtyNavTiles.push_back({ x, y });
+		mpNavGraph->forEachEdge(index, [this](int to, double) { mDirtyNavNodes.push_back(to); });
+		mpNavGraph->removeNodeEdges(index);
+		mpNavGraph->removeNode(index);
+	}
+
+	void TileMap::indexQuads(Chunk& chunk) const
+	{
+		const TMX& tmx = *mpTMX;
+		const sf::IntRect region = getChunkRegion(chunk.coords);
+
+		chunk.tileQuads.assign(chunk.layers.size(), std::vector<int>(region.width * region.height, -1));
+		chunk.quadTiles.assign(chunk.layers.size(), std::vector<std::vector<int>>(mTextures.size()));
+		for (int layer = 0; layer < (int)chunk.layers.size(); ++layer)
+		{
+			// Same order TMX::makeVertices appends quads in
+			for (int y = region.top; y < region.top + region.height; ++y)
+			{
+				for (int x = region.left; x < region.left + region.width; ++x)
+				{
+					int gid = tmx.getTile(layer, x, y);
+					if (gid != 0)
+					{
+						int local = (y - region.top) * region.width + (x - region.left);
+						std::vector<int>& quadTiles = chunk.quadTiles[layer][tmx.getTilesetIndex(gid)];
+						chunk.tileQuads[layer][local] = quadTiles.size();
+						quadTiles.push_back(local);
+					}
+				}
+			}
+		}
+	}
+
+	void TileMap::patchQuad(Chunk& chunk, int layer, int x, int y, int oldGid, int gid)
+	{
+		const sf::IntRect region = getChunkRegion(chunk.coords);
+		const int local = (y - region.top) * region.width + (x - region.left);
+		int& quad = chunk.tileQuads[layer][local];
+
+		if (oldGid != 0)
+		{
+			// Move the last quad of the tileset into the freed slot
+			const int tileset = mpTMX->getTilesetIndex(oldGid);
+			sf::VertexArray& vertices = chunk.layers[layer][tileset];
+			std::vector<int>& quadTiles = chunk.quadTiles[layer][tileset];
+			const int last = quadTiles.size() - 1;
+			for (int i = 0; i < 4; ++i)
+			{
+				vertices[quad * 4 + i] = vertices[last * 4 + i];
+			}
+			vertices.resize(last * 4);
+			quadTiles[quad] = quadTiles[last];
+			chunk.tileQuads[layer][quadTiles[quad]] = quad;
+			quadTiles.pop_back();
+			quad = -1;
+		}
+
+		if (gid != 0)
+		{
+			const int tileset = mpTMX->getTilesetIndex(gid);
+			std::vector<int>& quadTiles = chunk.quadTiles[layer][tileset];
+			std::array<sf::Vertex, 4> vertices;
+			mpTMX->makeQuad(x, y, gid, vertices.data());
+			for (auto& vertex : vertices)
+			{
+				chunk.layers[layer][tileset].append(vertex);
+			}
+			quad = quadTiles.size();
+			quadTiles.push_back(local);
+		}
+	}
+
+	sf::IntRect TileMap::patchCollider(Chunk& chunk, int x, int y)
+	{
+		const TMX& tmx = *mpTMX;
+		const float tileWidth = (float)tmx.getTileWidth();
+		const float tileHeight = (float)tmx.getTileHeight();
+		const sf::IntRect region = getChunkRegion(chunk.coords);
+		CompositeCollider& collider = chunk.pCollider ? *chunk.pCollider : *mpCollider;
+
+		auto toTiles = [=](const sf::FloatRect& rect) {
+			int left = std::max((int)std::floor(rect.left / tileWidth), region.left);
+			int top = std::max((int)std::floor(rect.top / tileHeight), region.top);
+			int right = std::min((int)std::ceil((rect.left + rect.width) / tileWidth), region.left + region.width);
+			int bottom = std::min((int)std::ceil((rect.top + rect.height) / tileHeight), region.top + region.height);
+			return sf::IntRect(left, top, right - left, bottom - top);
+		};
+		auto unite = [](sf::IntRect& a, const sf::IntRect& b) {
+			int right = std::max(a.left + a.width, b.left + b.width);
+			int bottom = std::max(a.top + a.height, b.top + b.height);
+			a.left = std::min(a.left, b.left);
+			a.top = std::min(a.top, b.top);
+			a.width = right - a.left;
+			a.height = bottom - a.top;
+		};
+
+		// Merged rectangles overlapping the tile are taken out and regenerated
+		// from the tiles they covered
+		const sf::FloatRect tileRect(x * tileWidth, y * tileHeight, tileWidth, tileHeight);
+		sf::IntRect changed(x, y, 1, 1);
+		std::vector<sf::IntRect> dirtyTiles = { changed };
+		for (int i = (int)chunk.colliderRects.size() - 1; i >= 0; --i)
+		{
+			if (!chunk.colliderRects[i].intersects(tileRect))
+			{
+				continue;
+			}
+
+			dirtyTiles.push_back(toTiles(chunk.colliderRects[i]));
+			unite(changed, dirtyTiles.back());
+
+			getBody().DestroyFixture(chunk.fixtures[i]);
+			chunk.fixtures[i] = chunk.fixtures.back();
+			chunk.fixtures.pop_back();
+			chunk.colliderRects[i] = chunk.colliderRects.back();
+			chunk.colliderRects.pop_back();
+			const std::array<Wall2f, 4> walls = collider.getBoxWalls(i);
+			mRemovedWalls.insert(mRemovedWalls.end(), walls.begin(), walls.end());
+			collider.removeCollider(i);
+		}
+
+		std::vector<sf::FloatRect> rects;
+		for (auto& tiles : dirtyTiles)
+		{
+			tmx.makeColliderRects(tiles, rects, false);
+		}
+		// Parts still covered by rectangles that were left alone are dropped
+		rects.erase(std::remove_if(rects.begin(), rects.end(), [&chunk](const sf::FloatRect& rect) {
+			return std::any_of(chunk.colliderRects.begin(), chunk.colliderRects.end(), [&rect](const sf::FloatRect& other) {
+				return other.left <= rect.left && other.top <= rect.top &&
+					other.left + other.width >= rect.left + rect.width && other.top + other.height >= rect.top + rect.height;
+			});
+		}), rects.end());
+		TMX::mergeColliderRects(rects);
 
 		const sf::Transform& transform = getWorld().getPixelToWorldTransform();
+		for (auto& rect : rects)
+		{
+			BoxCollider box(transform.transformRect(rect));
+			collider.addCollider(box);
+			const std::array<Wall2f, 4> walls = collider.getBoxWalls(collider.getNumColliders() - 1);
+			mAddedWalls.insert(mAddedWalls.end(), walls.begin(), walls.end());
+			chunk.fixtures.push_back(box.createFixture(getBody()));
+			chunk.colliderRects.push_back(rect);
+			unite(changed, toTiles(rect));
+		}
 
-		mpCollider = std::unique_ptr<CompositeCollider>(tmx.makeCollider(transform));
+		return changed;
+	}
 
-		mpNavGraph = std::unique_ptr<NavGraph>(tmx.makeNavGraph(transform));
+	sf::IntRect TileMap::patchOutlines(Chunk& chunk)
+	{
+		// Outlines are merged across tiles, so the chunk's outlines are rebuilt
+		// as a whole; the change covers the tiles under the old and new ones
+		const TMX& tmx = *mpTMX;
+		const sf::IntRect region = getChunkRegion(chunk.coords);
+		CompositeCollider& collider = chunk.pCollider ? *chunk.pCollider : *mpCollider;
 
-		mCellSpaceNeighborhoodRange = calculateAverageGraphEdgeLength(*mpNavGraph) + 1;
+		sf::Vector2f min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+		sf::Vector2f max(std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest());
+		auto addBounds = [&min, &max](const TMX::Outline& outline) {
+			for (auto& point : outline.points)
+			{
+				min = { std::min(min.x, point.x), std::min(min.y, point.y) };
+				max = { std::max(max.x, point.x), std::max(max.y, point.y) };
+			}
+		};
 
-		mpCellSpacePartition = std::make_unique<NavCellSpace>((float)tmx.getTileWidth() / tmx.getWidth(), (float)tmx.getTileHeight() * tmx.getHeight(), tmx.getWidth() / 4, tmx.getHeight() / 4, mpNavGraph->numNodes());
+		for (b2Fixture* pFixture : chunk.chainFixtures)
+		{
+			getBody().DestroyFixture(pFixture);
+		}
+		chunk.chainFixtures.clear();
+		for (int i = 0; i < collider.getNumChainColliders(); ++i)
+		{
+			const std::vector<Wall2f>& walls = collider.getChainCollider(i).getWalls();
+			mRemovedWalls.insert(mRemovedWalls.end(), walls.begin(), walls.end());
+		}
+		collider.removeChainColliders();
+		for (auto& outline : chunk.colliderOutlines)
+		{
+			addBounds(outline);
+		}
 
-		TileMap::NavGraph::ConstNodeIterator nodeIter(*mpNavGraph);
-		for (const TileMap::NavGraph::Node* pNode = nodeIter.begin(); !nodeIter.end(); pNode = nodeIter.next())
+		tmx.makeColliderOutlines(region, chunk.colliderOutlines);
+		const sf::Transform& transform = getWorld().getPixelToWorldTransform();
+		for (auto& outline : chunk.colliderOutlines)
 		{
-			mpCellSpacePartition->addEntity(pNode);
+			ChainCollider chain = ChainCollider(outline.points, outline.loop).transform(transform);
+			collider.addCollider(chain);
+			mAddedWalls.insert(mAddedWalls.end(), chain.getWalls().begin(), chain.getWalls().end());
+			chunk.chainFixtures.push_back(chain.createFixture(getBody()));
+			addBounds(outline);
 		}
 
-		std::vector<b2Fixture*> fixtures;
-		mpCollider->createFixtures(getBody(), fixtures);
+		if (min.x > max.x)
+		{
+			return { 0, 0, 0, 0 };
+		}
+		const int left = std::max((int)std::floor(min.x / tmx.getTileWidth()), region.left);
+		const int top = std::max((int)std::floor(min.y / tmx.getTileHeight()), region.top);
+		const int right = std::min((int)std::ceil(max.x / tmx.getTileWidth()), region.left + region.width);
+		const int bottom = std::min((int)std::ceil(max.y / tmx.getTileHeight()), region.top + region.height);
+		return { left, top, std::max(right - left, 0), std::max(bottom - top, 0) };
 	}
 
-	const std::vector<Wall2f>& TileMap::getWalls() const
+	void TileMap::patchNavGraph(const Chunk& chunk, const sf::IntRect& area)
+	{
+		const TMX& tmx = *mpTMX;
+		const sf::FloatRect bounds((float)area.left * tmx.getTileWidth(), (float)area.top * tmx.getTileHeight(), (float)area.width * tmx.getTileWidth(), (float)area.height * tmx.getTileHeight());
+
+		std::vector<sf::FloatRect> rects;
+		std::copy_if(chunk.colliderRects.begin(), chunk.colliderRects.end(), std::back_inserter(rects), [&bounds](const sf::FloatRect& rect) {
+			return rect.intersects(bounds);
+		});
+		std::vector<char> walkable;
+		tmx.makeWalkable(rects, chunk.colliderOutlines, area, walkable);
+
+		std::vector<sf::Vector2i> added;
+		std::vector<sf::Vector2i> removed;
+		for (int y = area.top; y < area.top + area.height; ++y)
+		{
+			for (int x = area.left; x < area.left + area.width; ++x)
+			{
+				const bool isWalkable = walkable[(y - area.top) * area.width + (x - area.left)] != 0;
+				if (!isStreaming())
+				{
+					mWalkable[y * tmx.getWidth() + x] = isWalkable;
+				}
+				mpOccupancy->setSolid(x, y, !isWalkable);
+
+				if (!isWalkable && hasNavNode(x, y))
+				{
+					removeNavNode(x, y);
+					removed.push_back({ x, y });
+				}
+				else if (isWalkable && !hasNavNode(x, y))
+				{
+					added.push_back({ x, y });
+				}
+			}
+		}
+
+		if (isStreaming())
+		{
+			for (auto& tile : added)
+			{
+				addNavNode(tile.x, tile.y);
+			}
+			return;
+		}
+
+		// A new node may open up a region that has to be flooded
+		std::vector<sf::Vector2i> open;
+		for (auto& tile : added)
+		{
+			if (!hasNavNode(tile.x, tile.y) && std::any_of(NAV_FLOOD_OFFSETS.begin(), NAV_FLOOD_OFFSETS.end(), [&tile, this](sf::Vector2i offset) {
+				return hasNavNode(tile.x + offset.x, tile.y + offset.y);
+			}))
+			{
+				addNavNode(tile.x, tile.y);
+				open.push_back(tile);
+			}
+		}
+		floodNavGraph(std::move(open));
+		pruneNavGraph(removed);
+	}
+
+	void TileMap::floodNavGraph(std::vector<sf::Vector2i> open)
+	{
+		const TMX& tmx = *mpTMX;
+		while (!open.empty())
+		{
+			sf::Vector2i tile = open.back();
+			open.pop_back();
+			for (auto& offset : NAV_FLOOD_OFFSETS)
+			{
+				sf::Vector2i neighbor = tile + offset;
+				if (neighbor.x >= 0 && neighbor.y >= 0 && neighbor.x < tmx.getWidth() && neighbor.y < tmx.getHeight() &&
+					mWalkable[neighbor.y * tmx.getWidth() + neighbor.x] && !hasNavNode(neighbor.x, neighbor.y))
+				{
+					addNavNode(neighbor.x, neighbor.y);
+					open.push_back(neighbor);
+				}
+			}
+		}
+	}
+
+	void TileMap::pruneNavGraph(const std::vector<sf::Vector2i>& removed)
+	{
+		const int width = mpTMX->getWidth(), height = mpTMX->getHeight();
+		const int seed = (int)(std::find(mWalkable.begin(), mWalkable.end(), 1) - mWalkable.begin());
+		if (seed == width * height || !hasNavNode(seed % width, seed / width))
+		{
+			for (int y = 0; y < height; ++y)
+			{
+				for (int x = 0; x < width; ++x)
+				{
+					if (hasNavNode(x, y)) removeNavNode(x, y);
+				}
+			}
+			if (seed < width * height)
+			{
+				addNavNode(seed % width, seed / width);
+				floodNavGraph({ sf::Vector2i(seed % width, seed / width) });
+			}
+			return;
+		}
+
+		// Every region cut off holds a neighbour of a removed tile. The
+		// neighbours are flooded in step, merging as they meet, until they are
+		// all one region or every region but the seed's has been dropped, so
+		// the work is bounded by the smaller side of the cut.
+		struct Flood
+		{
+			std::vector<int> tiles;
+			size_t next;
+			int parent;
+			bool hasSeed;
+			bool isDone;
+		};
+		std::vector<Flood> floods;
+		std::unordered_map<int, int> tileFloods;
+		for (auto& tile : removed)
+		{
+			for (auto& offset : NAV_FLOOD_OFFSETS)
+			{
+				const int index = (tile.y + offset.y) * width + tile.x + offset.x;
+				if (hasNavNode(tile.x + offset.x, tile.y + offset.y) && tileFloods.emplace(index, (int)floods.size()).second)
+				{
+					floods.push_back({ { index }, 0, (int)floods.size(), index == seed, false });
+				}
+			}
+		}
+
+		auto findRoot = [&floods](int flood) {
+			while (floods[flood].parent != flood) flood = floods[flood].parent = floods[floods[flood].parent].parent;
+			return flood;
+		};
+
+		int numRegions = (int)floods.size();
+		bool isSeedFound = false;
+		std::vector<char> isGrowing(floods.size());
+		while (numRegions > 1 || (numRegions == 1 && isSeedFound))
+		{
+			for (size_t i = 0; i < floods.size(); ++i)
+			{
+				if (floods[i].isDone || floods[i].next == floods[i].tiles.size()) continue;
+
+				const int tile = floods[i].tiles[floods[i].next++];
+				for (auto& offset : NAV_FLOOD_OFFSETS)
+				{
+					const int x = tile % width + offset.x, y = tile / width + offset.y;
+					if (!hasNavNode(x, y)) continue;
+
+					auto inserted = tileFloods.emplace(y * width + x, (int)i);
+					const int root = findRoot((int)i);
+					if (inserted.second)
+					{
+						floods[i].tiles.push_back(y * width + x);
+						floods[root].hasSeed = floods[root].hasSeed || y * width + x == seed;
+						continue;
+					}
+
+					const int otherRoot = findRoot(inserted.first->second);
+					if (otherRoot != root)
+					{
+						floods[otherRoot].parent = root;
+						floods[root].hasSeed = floods[root].hasSeed || floods[otherRoot].hasSeed;
+						--numRegions;
+					}
+				}
+			}
+
+			// A region none of whose floods can grow is complete
+			std::fill(isGrowing.begin(), isGrowing.end(), 0);
+			for (size_t i = 0; i < floods.size(); ++i)
+			{
+				if (!floods[i].isDone && floods[i].next < floods[i].tiles.size()) isGrowing[findRoot((int)i)] = 1;
+			}
+			for (size_t i = 0; i < floods.size(); ++i)
+			{
+				const int root = findRoot((int)i);
+				if (floods[i].isDone || isGrowing[root]) continue;
+
+				if (!floods[root].hasSeed)
+				{
+					for (int index : floods[i].tiles) removeNavNode(index % width, index / width);
+				}
+				if (root == (int)i)
+				{
+					isSeedFound = isSeedFound || floods[root].hasSeed;
+					--numRegions;
+				}
+				floods[i].isDone = true;
+			}
+		}
+	}
+
+	void TileMap::updateChunks(bool wait)
+	{
+		bool changed = false;
+
+		for (auto it = mChunks.begin(); it != mChunks.end();)
+		{
+			if (getChunkDistance(it->second.coords) > mLoadRadius + 1)
+			{
+				evictChunk(it++);
+				changed = true;
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		bool requested;
+		do
+		{
+			requested = requestChunks();
+			changed = harvestChunks(wait) || changed;
+		} while (wait && (requested || !mPendingChunks.empty()));
+
+		if (changed)
+		{
+			rebuildCollider();
+			rebuildColliderQueries();
+			updateNavSnapshots();
+			if ((mDrawFlags & NAV_GRAPH) > 0)
+				mpNavGraph->prepareVerticesForDrawing();
+		}
+	}
+
+	bool TileMap::harvestChunks(bool wait)
+	{
+		bool attached = false;
+		for (auto it = mPendingChunks.begin(); it != mPendingChunks.end();)
+		{
+			if (!wait && it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				++it;
+				continue;
+			}
+
+			ChunkBuild build = it->second.get();
+			sf::Vector2i coords(it->first % mNumChunksX, it->first / mNumChunksX);
+			// The focus may have moved away while the chunk was being built
+			if (getChunkDistance(coords) <= mLoadRadius + 1)
+			{
+				attachChunk(coords, std::move(build));
+				attached = true;
+			}
+			it = mPendingChunks.erase(it);
+		}
+		return attached;
+	}
+
+	bool TileMap::requestChunks()
+	{
+		std::vector<sf::Vector2i> missing;
+		for (int y = std::max(mFocusChunk.y - mLoadRadius, 0); y <= std::min(mFocusChunk.y + mLoadRadius, mNumChunksY - 1); ++y)
+		{
+			for (int x = std::max(mFocusChunk.x - mLoadRadius, 0); x <= std::min(mFocusChunk.x + mLoadRadius, mNumChunksX - 1); ++x)
+			{
+				int key = y * mNumChunksX + x;
+				if (mChunks.find(key) == mChunks.end() && mPendingChunks.find(key) == mPendingChunks.end())
+				{
+					missing.push_back({ x, y });
+				}
+			}
+		}
+
+		std::sort(missing.begin(), missing.end(), [this](sf::Vector2i a, sf::Vector2i b) {
+			return getChunkDistance(a) < getChunkDistance(b);
+		});
+
+		std::shared_ptr<const TMX> pTMX = mpTMX;
+		sf::Transform transform = getWorld().getPixelToWorldTransform();
+		bool requested = false;
+		for (auto& coords : missing)
+		{
+			if ((int)mPendingChunks.size() >= MAX_PENDING_CHUNKS)
+			{
+				break;
+			}
+			sf::IntRect region = getChunkRegion(coords);
+			mPendingChunks.emplace(coords.y * mNumChunksX + coords.x, std::async(std::launch::async, [pTMX, region, transform]() {
+				return buildChunk(*pTMX, region, transform);
+			}));
+			requested = true;
+		}
+		return requested;
+	}
+
+	void TileMap::attachChunk(sf::Vector2i coords, ChunkBuild&& build)
+	{
+		if (mFreeSlots.empty())
+		{
+			throw std::runtime_error("No free TileMap chunk slots.");
+		}
+
+		Chunk& chunk = mChunks[coords.y * mNumChunksX + coords.x];
+		chunk.coords = coords;
+		chunk.slot = mFreeSlots.back();
+		mFreeSlots.pop_back();
+		chunk.layers = std::move(build.layers);
+		chunk.colliderRects = std::move(build.colliderRects);
+		chunk.colliderOutlines = std::move(build.colliderOutlines);
+		chunk.pCollider = std::move(build.pCollider);
+		chunk.pCollider->createFixtures(getBody(), chunk.fixtures, chunk.chainFixtures);
+		const std::vector<Wall2f> walls = chunk.pCollider->getWalls();
+		mAddedWalls.insert(mAddedWalls.end(), walls.begin(), walls.end());
+
+		const sf::IntRect region = getChunkRegion(coords);
+		for (int y = region.top; y < region.top + region.height; ++y)
+		{
+			for (int x = region.left; x < region.left + region.width; ++x)
+			{
+				const bool isWalkable = build.walkable[(y - region.top) * region.width + (x - region.left)] != 0;
+				mpOccupancy->setSolid(x, y, !isWalkable);
+				if (isWalkable)
+				{
+					addNavNode(x, y);
+				}
+			}
+		}
+	}
+
+	void TileMap::evictChunk(std::map<int, Chunk>::iterator chunkIter)
+	{
+		Chunk& chunk = chunkIter->second;
+
+		const sf::IntRect region = getChunkRegion(chunk.coords);
+		for (int y = region.top; y < region.top + region.height; ++y)
+		{
+			for (int x = region.left; x < region.left + region.width; ++x)
+			{
+				if (hasNavNode(x, y))
+				{
+					removeNavNode(x, y);
+				}
+			}
+		}
+
+		for (b2Fixture* pFixture : chunk.fixtures)
+		{
+			getBody().DestroyFixture(pFixture);
+		}
+		for (b2Fixture* pFixture : chunk.chainFixtures)
+		{
+			getBody().DestroyFixture(pFixture);
+		}
+		const std::vector<Wall2f> walls = chunk.pCollider->getWalls();
+		mRemovedWalls.insert(mRemovedWalls.end(), walls.begin(), walls.end());
+
+		mpOccupancy->clear(region);
+
+		mFreeSlots.push_back(chunk.slot);
+		mChunks.erase(chunkIter);
+	}
+
+	void TileMap::rebuildCollider()
+	{
+		mpCollider->clear();
+		for (auto& chunk : mChunks)
+		{
+			mpCollider->addColliders(*chunk.second.pCollider);
+		}
+	}
+
+	void TileMap::rebuildColliderQueries()
+	{
+		mpWallGrid->update(mRemovedWalls, mAddedWalls);
+		mRemovedWalls.clear();
+		mAddedWalls.clear();
+		mpWorldCollider.reset();
+	}
+
+	const CompositeCollider& TileMap::getWorldCollider() const
+	{
+		const sf::Transform transform = getWorldTransform();
+		if (!mpWorldCollider || !std::equal(transform.getMatrix(), transform.getMatrix() + 16, mWorldColliderTransform.getMatrix()))
+		{
+			mpWorldCollider = std::make_unique<CompositeCollider>(mpCollider->transform(transform));
+			mpWorldCollider->buildTree();
+			mWorldColliderTransform = transform;
+		}
+		return *mpWorldCollider;
+	}
+
+	void TileMap::onUpdate(const sf::Time&)
+	{
+		if (isStreaming())
+		{
+			updateChunks(false);
+		}
+	}
+
+	std::vector<Wall2f> TileMap::getWalls() const
 	{
 		return mpCollider->getWalls();
 	}
 
+	const WallGrid& TileMap::getWallGrid() const
+	{
+		return *mpWallGrid;
+	}
+
+	const OccupancyGrid& TileMap::getOccupancy() const
+	{
+		return *mpOccupancy;
+	}
+
+	bool TileMap::isTileAligned() const
+	{
+		return mbTileAligned;
+	}
+
+	bool TileMap::isLineOfSight(sf::Vector2f from, sf::Vector2f to, float radius) const
+	{
+		return !mpOccupancy->isObstructed({ from, to, radius });
+	}
+
+	bool TileMap::raycast(sf::Vector2f from, sf::Vector2f to, float radius, float& outFraction) const
+	{
+		return mpOccupancy->raycast(from, to, radius, outFraction);
+	}
+
 	const TileMap::NavGraph& TileMap::getNavGraph() const
 	{
 		return *mpNavGraph;
 	}
 
+	void TileMap::updateNavSnapshots()
+	{
+		std::sort(mDirtyNavNodes.begin(), mDirtyNavNodes.end());
+		mDirtyNavNodes.erase(std::unique(mDirtyNavNodes.begin(), mDirtyNavNodes.end()), mDirtyNavNodes.end());
+		if (mpSearchGraph)
+		{
+			mpSearchGraph->update(*mpNavGraph, mDirtyNavNodes);
+		}
+		mDirtyNavNodes.clear();
+
+		for (const sf::Vector2i& tile : mDirtyNavTiles)
+		{
+			const bool open = hasNavNode(tile.x, tile.y);
+			if (mpNavGrid)
+			{
+				mpNavGrid->setSolid(tile.x, tile.y, !open);
+			}
+			if (mpJumpPointGrid)
+			{
+				mpJumpPointGrid->setOpen(tile.x, tile.y, open);
+			}
+			if (mpNavHierarchy)
+			{
+				mDirtyNavClusters.push_back(mpNavHierarchy->getCluster(tile.y * mpTMX->getWidth() + tile.x));
+			}
+		}
+		mDirtyNavTiles.clear();
+
+		mNavRevision = getNextNavRevision();
+	}
+
+	const CsrGraph& TileMap::getSearchGraph() const
+	{
+		if (!mpSearchGraph)
+		{
+			mpSearchGraph = std::make_unique<CsrGraph>(*mpNavGraph);
+		}
+		return *mpSearchGraph;
+	}
+
+	const OccupancyGrid& TileMap::getNavGrid() const
+	{
+		if (!mpNavGrid)
+		{
+			const TMX& tmx = *mpTMX;
+			const sf::FloatRect bounds = getWorld().getPixelToWorldTransform().transformRect({ 0, 0, (float)tmx.getTileWidth() * tmx.getWidth(), (float)tmx.getTileHeight() * tmx.getHeight() });
+			mpNavGrid = std::make_unique<OccupancyGrid>(bounds, tmx.getWidth(), tmx.getHeight());
+			for (int y = 0; y < tmx.getHeight(); ++y)
+			{
+				for (int x = 0; x < tmx.getWidth(); ++x)
+				{
+					mpNavGrid->setSolid(x, y, !hasNavNode(x, y));
+				}
+			}
+		}
+		return *mpNavGrid;
+	}
+
+	const JumpPointGrid& TileMap::getJumpPointGrid() const
+	{
+		if (!mpJumpPointGrid)
+		{
+			mpJumpPointGrid = std::make_unique<JumpPointGrid>(getNavGrid());
+		}
+		return *mpJumpPointGrid;
+	}
+
+	const HierarchicalNavGraph& TileMap::getNavHierarchy() const
+	{
+		if (!mpNavHierarchy)
+		{
+			mpNavHierarchy = std::make_unique<HierarchicalNavGraph>(getJumpPointGrid(), NAV_CLUSTER_SIZE);
+		}
+		else if (!mDirtyNavClusters.empty())
+		{
+			std::sort(mDirtyNavClusters.begin(), mDirtyNavClusters.end());
+			mDirtyNavClusters.erase(std::unique(mDirtyNavClusters.begin(), mDirtyNavClusters.end()), mDirtyNavClusters.end());
+			mpNavHierarchy->update(getJumpPointGrid(), mDirtyNavClusters);
+		}
+		mDirtyNavClusters.clear();
+		return *mpNavHierarchy;
+	}
+
+	int TileMap::getNavRevision() const
+	{
+		return mNavRevision;
+	}
+
 	void TileMap::setDrawColliderEnabled(bool enabled)
 	{
 		mDrawFlags = enabled ? mDrawFlags | COLLIDER : mDrawFlags ^ COLLIDER;
@@ -104,24 +1159,29 @@ namespace te
 		return *mpCellSpacePartition;
 	}
 
+	TileMap::NavSearchWorkspace& TileMap::getSearchWorkspace()
+	{
+		return mSearchWorkspace;
+	}
+
 	bool TileMap::intersects(const BoxCollider& o) const
 	{
-		return mpCollider->transform(getWorldTransform()).intersects(o);
+		return getWorldCollider().intersects(o);
 	}
 
 	bool TileMap::intersects(const BoxCollider& o, sf::FloatRect& collision) const
 	{
-		return mpCollider->transform(getWorldTransform()).intersects(o, collision);
+		return getWorldCollider().intersects(o, collision);
 	}
 
 	bool TileMap::intersects(const CompositeCollider& o) const
 	{
-		return mpCollider->transform(getWorldTransform()).intersects(o);
+		return getWorldCollider().intersects(o);
 	}
 
 	bool TileMap::intersects(const CompositeCollider& o, sf::FloatRect& collision) const
 	{
-		return mpCollider->transform(getWorldTransform()).intersects(o, collision);
+		return getWorldCollider().intersects(o, collision);
 	}
 
 	void TileMap::onDraw(sf::RenderTarget& target, sf::RenderStates states) const
@@ -140,20 +1200,24 @@ namespace te
 		}
 	}
 
-	TileMap::Layer::Layer(Game& world, std::vector<sf::VertexArray>&& vas, std::vector<const sf::Texture*>& textures)
+	TileMap::Layer::Layer(Game& world, const TileMap& tileMap, int layerIndex)
 		: BaseGameEntity(world, b2BodyDef())
-		, mVertexArrays(std::move(vas))
-		, mTextures(&textures)
+		, mTileMap(tileMap)
+		, mLayerIndex(layerIndex)
 	{}
 
 	void TileMap::Layer::onDraw(sf::RenderTarget& target, sf::RenderStates states) const
 	{
 		states.transform *= getWorldTransform() * getWorld().getPixelToWorldTransform();
 
-		for (auto iter = mVertexArrays.begin(); iter != mVertexArrays.end(); ++iter)
+		for (auto& chunk : mTileMap.mChunks)
 		{
-			states.texture = (*mTextures)[iter - mVertexArrays.begin()];
-			target.draw(*iter, states);
+			const std::vector<sf::VertexArray>& vertexArrays = chunk.second.layers[mLayerIndex];
+			for (auto iter = vertexArrays.begin(); iter != vertexArrays.end(); ++iter)
+			{
+				states.texture = mTileMap.mTextures[iter - vertexArrays.begin()];
+				target.draw(*iter, states);
+			}
 		}
 	}
 }
@@ -2,12 +2,20 @@
 #define TE_TILE_MAP_H
 
 #include "sparse_graph.h"
+#include "csr_graph.h"
+#include "graph_search_workspace.h"
 #include "tmx.h"
 #include "composite_collider.h"
 #include "cell_space_partition.h"
+#include "wall_grid.h"
+#include "occupancy_grid.h"
+#include "jump_point_search.h"
+#include "hierarchical_nav_graph.h"
 #include "base_game_entity.h"
 
 #include <SFML/Graphics.hpp>
+#include <future>
+#include <map>
 #include <memory>
 #include <vector>
 
@@ -21,17 +29,77 @@ namespace te
 	public:
 		typedef SparseGraph<NavGraphNode, NavGraphEdge> NavGraph;
 		typedef CellSpacePartition<const NavGraph::Node*> NavCellSpace;
+		typedef GraphSearchWorkspace NavSearchWorkspace;
 
-		TileMap(Game& world, TextureManager& textureManager, const TMX& tmx);
+		// Everything a whole map needs but its textures and physics fixtures,
+		// so that it can be built off the main thread
+		struct Build
+		{
+			std::vector<std::vector<sf::VertexArray>> layers;
+			std::vector<sf::FloatRect> colliderRects;
+			std::vector<TMX::Outline> colliderOutlines;
+			std::unique_ptr<CompositeCollider> pCollider;
+			std::vector<char> walkable;
+			std::unique_ptr<NavGraph> pNavGraph;
+			float cellSpaceNeighborhoodRange;
+			std::unique_ptr<NavCellSpace> pCellSpacePartition;
+			std::unique_ptr<WallGrid> pWallGrid;
+			std::unique_ptr<OccupancyGrid> pOccupancy;
+		};
 
-		const std::vector<Wall2f>& getWalls() const;
+		// Compiles the TMX if needed. The transform must be the pixel to world
+		// transform of the game the map is for.
+		static std::unique_ptr<Build> build(TMX& tmx, const sf::Transform& pixelToWorldTransform);
+
+		TileMap(Game& world, TextureManager& textureManager, std::shared_ptr<TMX> pTMX);
+		// Only uploads the textures and attaches the colliders to the world
+		TileMap(Game& world, TextureManager& textureManager, std::shared_ptr<TMX> pTMX, std::unique_ptr<Build> pBuild);
+		// Streams the map in square chunks of chunkSize tiles, keeping the chunks
+		// within loadRadius chunks of the streaming focus resident. The TMX does
+		// not need to be compiled.
+		TileMap(Game& world, TextureManager& textureManager, std::shared_ptr<TMX> pTMX, int chunkSize, int loadRadius);
+
+		bool isStreaming() const;
+		void setStreamingFocus(sf::Vector2f position, bool wait = false);
+
+		int getTile(int layer, int x, int y) const;
+		// Patches the tile's quad, the collider rectangles overlapping it and the
+		// nav graph around it; nothing else is rebuilt
+		void setTile(int layer, int x, int y, int gid);
+
+		std::vector<Wall2f> getWalls() const;
+		// Indexes the walls of getWalls() by the tiles each one crosses
+		const WallGrid& getWallGrid() const;
+		// One bit per tile, set when the tile's centre is inside a collider
+		const OccupancyGrid& getOccupancy() const;
+		// Every collider covers whole tiles, so the occupancy is exact
+		bool isTileAligned() const;
+
+		// Tile by tile tests against the occupancy; see OccupancyGrid::raycast
+		bool isLineOfSight(sf::Vector2f from, sf::Vector2f to, float radius = 0) const;
+		bool raycast(sf::Vector2f from, sf::Vector2f to, float radius, float& outFraction) const;
 		const NavGraph& getNavGraph() const;
+		// The nav graph in compressed rows for searches, rebuilt on first use
+		// after the nav graph changes
+		const CsrGraph& getSearchGraph() const;
+		// One bit per tile, set where the nav graph has no node, rebuilt on
+		// first use after the nav graph changes
+		const OccupancyGrid& getNavGrid() const;
+		// The nav grid packed for jump point search
+		const JumpPointGrid& getJumpPointGrid() const;
+		// The nav grid in clusters for long searches. Clusters whose tiles
+		// changed are rebuilt on first use after the nav graph changes.
+		const HierarchicalNavGraph& getNavHierarchy() const;
+		// Goes up each time the nav graph changes, and differs between maps
+		int getNavRevision() const;
 
 		void setDrawColliderEnabled(bool enabled);
 		void setDrawNavGraphEnabled(bool enabled);
 
 		float getCellSpaceNeighborhoodRange() const;
 		NavCellSpace& getCellSpace();
+		// Shared by the searches of the nav graph, one at a time
+		NavSearchWorkspace& getSearchWorkspace();
 
 		bool intersects(const BoxCollider&) const;
 		bool intersects(const BoxCollider&, sf::FloatRect&) const;
@@ -42,31 +110,130 @@ namespace te
 		class Layer : public BaseGameEntity
 		{
 		public:
-			Layer(Game& world, std::vector<sf::VertexArray>&&, std::vector<const sf::Texture*>&);
+			Layer(Game& world, const TileMap& tileMap, int layerIndex);
 		private:
 			void onDraw(sf::RenderTarget&, sf::RenderStates) const;
 
-			std::vector<sf::VertexArray> mVertexArrays;
-			std::vector<const sf::Texture*>* mTextures;
+			const TileMap& mTileMap;
+			int mLayerIndex;
 		};
 		enum DrawFlags
 		{ COLLIDER = 0x01, NAV_GRAPH = 0x02 };
 
+		// Built off the main thread from the immutable TMX
+		struct ChunkBuild
+		{
+			std::vector<std::vector<sf::VertexArray>> layers;
+			std::vector<sf::FloatRect> colliderRects;
+			std::vector<TMX::Outline> colliderOutlines;
+			std::unique_ptr<CompositeCollider> pCollider;
+			std::vector<char> walkable;
+		};
+
+		struct Chunk
+		{
+			sf::Vector2i coords;
+			int slot;
+			std::vector<std::vector<sf::VertexArray>> layers;
+			// Pixel space collider rectangles, parallel to the collider's boxes and fixtures
+			std::vector<sf::FloatRect> colliderRects;
+			// Pixel space outlines, parallel to the collider's chains and chainFixtures
+			std::vector<TMX::Outline> colliderOutlines;
+			std::unique_ptr<CompositeCollider> pCollider;
+			std::vector<b2Fixture*> fixtures;
+			std::vector<b2Fixture*> chainFixtures;
+			// Built on the first edit: tile to quad per layer, and quad to tile per layer and tileset
+			std::vector<std::vector<int>> tileQuads;
+			std::vector<std::vector<std::vector<int>>> quadTiles;
+		};
+
 		TileMap(const TileMap&) = delete;
 		TileMap& operator=(const TileMap&) = delete;
 
 		virtual void onDraw(sf::RenderTarget&, sf::RenderStates) const;
+		virtual void onUpdate(const sf::Time& dt);
+
+		void attachLayers(int numLayers);
+
+		static ChunkBuild buildChunk(const TMX& tmx, sf::IntRect region, sf::Transform transform);
+		sf::IntRect getChunkRegion(sf::Vector2i coords) const;
+		int getChunkKey(int x, int y) const;
+		int getChunkDistance(sf::Vector2i coords) const;
+		void updateChunks(bool wait);
+		bool requestChunks();
+		bool harvestChunks(bool wait);
+		void attachChunk(sf::Vector2i coords, ChunkBuild&& build);
+		void evictChunk(std::map<int, Chunk>::iterator chunkIter);
+		void rebuildCollider();
+		// Brings the wall grid and world collider up to date with mpCollider,
+		// passing the grid only the walls that changed
+		void rebuildColliderQueries();
+		const CompositeCollider& getWorldCollider() const;
+
+		int getTileNode(int x, int y) const;
+		bool hasNavNode(int x, int y) const;
+		void addNavNode(int x, int y);
+		void removeNavNode(int x, int y);
+		// Patches the nav snapshots built so far with the nodes that changed
+		void updateNavSnapshots();
+
+		void indexQuads(Chunk& chunk) const;
+		void patchQuad(Chunk& chunk, int layer, int x, int y, int oldGid, int gid);
+		sf::IntRect patchCollider(Chunk& chunk, int x, int y);
+		sf::IntRect patchOutlines(Chunk& chunk);
+		void patchNavGraph(const Chunk& chunk, const sf::IntRect& area);
+		// Adds nodes for the walkable tiles connected to those in open
+		void floodNavGraph(std::vector<sf::Vector2i> open);
+		// A map that is not streamed only has nodes for the tiles connected to
+		// its first walkable tile. Drops the regions the removed tiles cut off
+		// from it, or floods the graph again if that tile has changed.
+		void pruneNavGraph(const std::vector<sf::Vector2i>& removed);
+
+		static const int MAX_PENDING_CHUNKS;
+		static const int NAV_CLUSTER_SIZE;
 
 		Game& mWorld;
 
 		std::vector<const sf::Texture*> mTextures;
-		//std::vector<std::vector<sf::VertexArray>> mLayers;
+		std::map<int, Chunk> mChunks;
 		std::unique_ptr<CompositeCollider> mpCollider;
+		// mpCollider under the world transform it was last queried with
+		mutable std::unique_ptr<CompositeCollider> mpWorldCollider;
+		mutable sf::Transform mWorldColliderTransform;
+		std::unique_ptr<WallGrid> mpWallGrid;
+		// Walls taken out of and put into the colliders since the wall grid was updated
+		std::vector<Wall2f> mRemovedWalls;
+		std::vector<Wall2f> mAddedWalls;
+		std::unique_ptr<OccupancyGrid> mpOccupancy;
+		bool mbTileAligned;
 		std::unique_ptr<NavGraph> mpNavGraph;
+		mutable std::unique_ptr<CsrGraph> mpSearchGraph;
+		// Nodes added or removed, and their neighbours, since updateNavSnapshots
+		std::vector<int> mDirtyNavNodes;
+		// Tiles whose nav node came or went since updateNavSnapshots
+		std::vector<sf::Vector2i> mDirtyNavTiles;
+		mutable std::unique_ptr<OccupancyGrid> mpNavGrid;
+		mutable std::unique_ptr<JumpPointGrid> mpJumpPointGrid;
+		mutable std::unique_ptr<HierarchicalNavGraph> mpNavHierarchy;
+		// Clusters of the nav hierarchy with changed tiles, until it is next asked for
+		mutable std::vector<int> mDirtyNavClusters;
+		int mNavRevision;
+		NavSearchWorkspace mSearchWorkspace;
 
 		int mDrawFlags;
 		float mCellSpaceNeighborhoodRange;
 		std::unique_ptr<NavCellSpace> mpCellSpacePartition;
+
+		std::shared_ptr<TMX> mpTMX;
+		int mChunkSize;
+		int mLoadRadius;
+		int mNumChunksX;
+		int mNumChunksY;
+		sf::Vector2i mFocusChunk;
+		std::map<int, std::future<ChunkBuild>> mPendingChunks;
+		std::vector<int> mFreeSlots;
+		// Walkable tiles of a map that is not streamed, used to flood newly reachable areas
+		std::vector<char> mWalkable;
 	};
 }
 
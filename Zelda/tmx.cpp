@@ -3,267 +3,707 @@
 #include "texture_manager.h"
 #include "tile_map.h"
 #include "composite_collider.h"
+#include "chain_collider.h"
 #include "nav_graph_node.h"
 #include "nav_graph_edge.h"
 #include "vector_ops.h"
+#include "map_cache.h"
+#include "parallel.h"
+#include "tmx_reader.h"
 
 #include <SFML/Graphics.hpp>
-#include <rapidxml.hpp>
-#include <rapidxml_utils.hpp>
 
 #include <algorithm>
 #include <array>
-#include <set>
 #include <cmath>
-#include <sstream>
-
-constexpr bool std::less<sf::Vector2f>::operator()(const sf::Vector2f& a, const sf::Vector2f& b) const
-{
-	return a.x < b.x || (a.x == b.x && a.y < b.y);
-}
-
-constexpr bool std::less<te::NavGraphEdge>::operator()(const te::NavGraphEdge& a, const te::NavGraphEdge& b) const
-{
-	return a.getFrom() < b.getFrom() ||
-		(a.getFrom() == b.getFrom() && a.getTo() < b.getTo()) ||
-		(a.getFrom() == b.getFrom() && a.getTo() == b.getTo() && a.getCost() < b.getCost());
-}
+#include <map>
+#include <mutex>
+#include <tuple>
 
 namespace te
 {
-	const int TMX::NULL_TILE = -1;
-	const TMX::TileData TMX::NULL_DATA = TMX::TileData{ NULL_TILE, TMX::ObjectGroup() };
-
-	TMX::TMX(const std::string& filename)
+	const int TMX::MIN_BAND_ROWS = 64;
+	const std::string TMX::COLLISION_GROUP = "Collision";
+	const unsigned int TMX::MAX_TILE_GID = ~TMX::FLIP_FLAGS;
+
+	TMX::TMX(const std::string& filename, int options)
+		: mWidth(0)
+		, mHeight(0)
+		, mTilewidth(0)
+		, mTileheight(0)
+		, mFilename(filename)
+		, mOptions(options)
+		, mbCompiled(false)
 	{
-		rapidxml::file<> tmxFile(filename.c_str());
-		rapidxml::xml_document<> tmx;
-		tmx.parse<0>(tmxFile.data());
-
-		rapidxml::xml_node<char>* pMapNode = tmx.first_node("map");
-		mWidth = std::stoi(pMapNode->first_attribute("width")->value());
-		mHeight = std::stoi(pMapNode->first_attribute("height")->value());
-		mTilewidth = std::stoi(pMapNode->first_attribute("tilewidth")->value());
-		mTileheight = std::stoi(pMapNode->first_attribute("tileheight")->value());
-
-		for (rapidxml::xml_node<char>* pTileset = tmx.first_node("map")->first_node("tileset"); pTileset != 0; pTileset = pTileset->next_sibling("tileset"))
+		if ((mOptions & CACHE) == 0 || !MapCache::read(mFilename, MapCache::getCacheFilename(mFilename), *this))
 		{
-			std::vector<TileData> tiles;
-			for (rapidxml::xml_node<char>* pTile = pTileset->first_node("tile"); pTile != 0; pTile = pTile->next_sibling("tile"))
+			parse(mFilename);
+			if ((mOptions & COMPILE) == 0 && (mOptions & CACHE) != 0)
 			{
-				rapidxml::xml_node<char>* pObjectGroup = pTile->first_node("objectgroup");
-				std::vector<Object> objects;
-				for (rapidxml::xml_node<char>* pObject = pObjectGroup->first_node("object"); pObject != 0; pObject = pObject->next_sibling("object"))
-				{
-					std::vector<Polygon> polygons;
-					for (rapidxml::xml_node<char>* pPolygon = pObject->first_node("polygon"); pPolygon != 0; pPolygon = pPolygon->next_sibling("polygon"))
-					{
-						std::vector<sf::Vector2i> pointsVec;
+				MapCache::write(mFilename, MapCache::getCacheFilename(mFilename), *this);
+			}
+		}
+		buildGidTable();
 
-						std::string pointsStr(pPolygon->first_attribute("points")->value());
-						std::istringstream iss(pointsStr);
-						std::vector<std::string> points{ std::istream_iterator<std::string>{iss}, std::istream_iterator<std::string>{} };
-						for (auto& point : points)
-						{
-							std::stringstream ss(point);
-							std::string xCoord;
-							std::getline(ss, xCoord, ',');
-							std::string yCoord;
-							std::getline(ss, yCoord);
-							pointsVec.push_back({ std::stoi(xCoord), std::stoi(yCoord) });
-						}
+		if ((mOptions & COMPILE) != 0)
+		{
+			compile();
+		}
+	}
 
-						polygons.push_back({ std::move(pointsVec) });
-					}
+	void TMX::parse(const std::string& filename)
+	{
+		TMXReader::read(filename, *this);
+	}
 
-					objects.push_back(Object{
-						std::stoi(pObject->first_attribute("id")->value()),
-						"",
-						std::stoi(pObject->first_attribute("x")->value()),
-						std::stoi(pObject->first_attribute("y")->value()),
-						pObject->first_attribute("width") != 0 ? std::stoi(pObject->first_attribute("width")->value()) : 0,
-						pObject->first_attribute("height") != 0 ? std::stoi(pObject->first_attribute("height")->value()) : 0,
-						std::move(polygons)
-					});
-				}
+	TMX::Tile TMX::packTile(unsigned int gid)
+	{
+		return Tile{ (std::uint32_t)gid };
+	}
 
-				tiles.push_back({
-					std::stoi(pTile->first_attribute("id")->value()),
-					ObjectGroup {
-						"",
-						pObjectGroup->first_attribute("draworder")->value(),
-						std::move(objects)
-					}
-				});
-			}
+	unsigned int TMX::unpackTile(Tile tile)
+	{
+		return tile.bits;
+	}
 
-			rapidxml::xml_node<char>* pImage = pTileset->first_node("image");
-
-			mTilesets.push_back({
-				std::stoi(pTileset->first_attribute("firstgid")->value()),
-				pTileset->first_attribute("name")->value(),
-				std::stoi(pTileset->first_attribute("tilewidth")->value()),
-				std::stoi(pTileset->first_attribute("tileheight")->value()),
-				std::stoi(pTileset->first_attribute("tilecount")->value()), {
-					pImage->first_attribute("source")->value(),
-					std::stoi(pImage->first_attribute("width")->value()),
-				    std::stoi(pImage->first_attribute("height")->value())
-				},
-				std::move(tiles)
-			});
-		}
+	int TMX::getTileGid(Tile tile)
+	{
+		return tile.bits & MAX_TILE_GID;
+	}
 
-		for (rapidxml::xml_node<char>* pLayer = tmx.first_node("map")->first_node("layer"); pLayer != 0; pLayer = pLayer->next_sibling("layer"))
+	// Flips a rectangle within a tile the way Tiled flips the tile: the
+	// diagonal flip first, then the horizontal and vertical ones
+	static sf::FloatRect flipTileRect(sf::FloatRect rect, unsigned int flags, float tileWidth, float tileHeight)
+	{
+		if ((flags & TMX::FLIPPED_DIAGONALLY) != 0)
 		{
-			std::vector<Tile> tiles;
-			for (rapidxml::xml_node<char>* pTile = pLayer->first_node("data")->first_node("tile"); pTile != 0; pTile = pTile->next_sibling("tile"))
-			{
-				tiles.push_back({
-					std::stoi(pTile->first_attribute("gid")->value())
-				});
-			}
-			mLayers.push_back({
-				pLayer->first_attribute("name")->value(),
-				std::stoi(pLayer->first_attribute("width")->value()),
-				std::stoi(pLayer->first_attribute("height")->value()),
-				{std::move(tiles)}
-			});
+			rect = sf::FloatRect(rect.top, rect.left, rect.height, rect.width);
 		}
+		if ((flags & TMX::FLIPPED_HORIZONTALLY) != 0)
+		{
+			rect.left = tileWidth - rect.left - rect.width;
+		}
+		if ((flags & TMX::FLIPPED_VERTICALLY) != 0)
+		{
+			rect.top = tileHeight - rect.top - rect.height;
+		}
+		return rect;
+	}
 
-		for (rapidxml::xml_node<char>* pObjectgroup = tmx.first_node("map")->first_node("objectgroup"); pObjectgroup != 0; pObjectgroup = pObjectgroup->next_sibling("objectgroup"))
+	static sf::Vector2f flipTilePoint(sf::Vector2f point, unsigned int flags, float tileWidth, float tileHeight)
+	{
+		if ((flags & TMX::FLIPPED_DIAGONALLY) != 0)
 		{
-			std::vector<Object> objects;
-			for (rapidxml::xml_node<char>* pObject = pObjectgroup->first_node("object"); pObject != 0; pObject = pObject->next_sibling("object"))
-			{
-				objects.push_back({
-					std::stoi(pObject->first_attribute("id")->value()),
-					pObject->first_attribute("name") != 0 ? pObject->first_attribute("name")->value() : 0,
-					std::stoi(pObject->first_attribute("x")->value()),
-					std::stoi(pObject->first_attribute("y")->value()),
-					pObject->first_attribute("width") != 0 ? std::stoi(pObject->first_attribute("width")->value()) : 0,
-					pObject->first_attribute("height") != 0 ? std::stoi(pObject->first_attribute("height")->value()) : 0
-				});
-			}
-			mObjectGroups.push_back({
-				pObjectgroup->first_attribute("name")->value(),
-				"",
-				std::move(objects)
-			});
+			std::swap(point.x, point.y);
+		}
+		if ((flags & TMX::FLIPPED_HORIZONTALLY) != 0)
+		{
+			point.x = tileWidth - point.x;
+		}
+		if ((flags & TMX::FLIPPED_VERTICALLY) != 0)
+		{
+			point.y = tileHeight - point.y;
 		}
+		return point;
 	}
 
-	static std::vector<TMX::Tileset>::const_iterator getTilesetIterator(int gid, const std::vector<TMX::Tileset>& tilesets)
+	void TMX::buildGidTable()
 	{
-		auto retIt = tilesets.end();
-		for (auto it = tilesets.begin(); it != tilesets.end(); ++it)
+		mGids.assign(1, GidInfo{ -1, -1, false, false, {} });
+		for (int tilesetIndex = 0; tilesetIndex < (int)mTilesets.size(); ++tilesetIndex)
 		{
-			if (gid >= it->firstgid && gid < it->firstgid + it->tilecount)
+			const Tileset& tileset = mTilesets[tilesetIndex];
+			const int columns = std::max(tileset.image.width / std::max(tileset.tilewidth, 1), 1);
+			const int count = tileset.tilecount > 0 ? tileset.tilecount : columns * (tileset.image.height / std::max(tileset.tileheight, 1));
+			if (tileset.firstgid < 1 || count <= 0)
+			{
+				continue;
+			}
+			if ((int)mGids.size() < tileset.firstgid + count)
+			{
+				mGids.resize(tileset.firstgid + count, GidInfo{ -1, -1, false, false, {} });
+			}
+
+			// A later tileset claiming the same GIDs takes precedence
+			for (int localId = 0; localId < count; ++localId)
 			{
-				retIt = it;
+				mGids[tileset.firstgid + localId] = GidInfo{
+					tilesetIndex,
+					-1,
+					false,
+					false,
+					sf::Vector2f((float)(localId % columns) * mTilewidth, (float)(localId / columns) * mTileheight)
+				};
+			}
+			for (int i = 0; i < (int)tileset.tiles.size(); ++i)
+			{
+				const TileData& tileData = tileset.tiles[i];
+				if (tileData.id < 0 || tileData.id >= count) continue;
+				GidInfo& info = mGids[tileset.firstgid + tileData.id];
+				if (info.tileData >= 0) continue;
+				info.tileData = i;
+				info.solid = std::any_of(tileData.objectgroup.objects.begin(), tileData.objectgroup.objects.end(), [](const Object& obj) {
+					return obj.polygons.empty();
+				});
+				info.outlined = std::any_of(tileData.objectgroup.objects.begin(), tileData.objectgroup.objects.end(), [](const Object& obj) {
+					return !obj.polygons.empty();
+				});
 			}
 		}
-		if (retIt == tilesets.end())
+	}
+
+	const TMX::GidInfo& TMX::getGidInfo(int gid) const
+	{
+		if (gid < 0 || gid >= (int)mGids.size() || mGids[gid].tileset < 0)
 		{
 			throw std::out_of_range("GID does not exist for TMX.");
 		}
-		return retIt;
+		return mGids[gid];
 	}
 
-	void TMX::makeVertices(TextureManager& textureManager, std::vector<const sf::Texture*>& textures, std::vector<std::vector<sf::VertexArray>>& layers) const
+	void TMX::loadTextures(TextureManager& textureManager, std::vector<const sf::Texture*>& textures) const
 	{
 		textures.clear();
 		std::transform(mTilesets.begin(), mTilesets.end(), std::back_inserter(textures), [&textureManager](const Tileset& tileset) {
 			return &textureManager.getTexture(textureManager.load(tileset.image.source));
 		});
+	}
+
+	void TMX::makeVertices(TextureManager& textureManager, std::vector<const sf::Texture*>& textures, std::vector<std::vector<sf::VertexArray>>& layers) const
+	{
+		loadTextures(textureManager, textures);
+		makeVertices({ 0, 0, mWidth, mHeight }, layers);
+	}
 
+	void TMX::makeVertices(const sf::IntRect& region, std::vector<std::vector<sf::VertexArray>>& layers) const
+	{
 		layers.clear();
-		std::transform(mLayers.begin(), mLayers.end(), std::back_inserter(layers), [this](const Layer& layer) {
-			std::vector<sf::VertexArray> vertexArrays(mTilesets.size());
-			for (auto& va : vertexArrays) va.setPrimitiveType(sf::Quads);
+		layers.resize(mLayers.size());
+		parallelFor(0, (int)mLayers.size(), 1, [&layers, &region, this](int begin, int end) {
+			for (int i = begin; i < end; ++i)
+			{
+				layers[i] = makeLayerVertices(region, mLayers[i]);
+			}
+		});
+	}
 
-			int tileIndex = 0;
-			for (auto tile : layer.data.tiles)
+	std::vector<sf::VertexArray> TMX::makeLayerVertices(const sf::IntRect& region, const Layer& layer) const
+	{
+		std::vector<sf::VertexArray> vertexArrays(mTilesets.size());
+		for (auto& va : vertexArrays) va.setPrimitiveType(sf::Quads);
+
+		for (int y = region.top; y < region.top + region.height; ++y)
+		{
+			const Tile* pRow = &layer.data.tiles[index(0, y)];
+			for (int x = region.left; x < region.left + region.width; ++x)
 			{
-				if (tile.gid != 0)
+				const int gid = getTileGid(pRow[x]);
+				if (gid == 0)
 				{
-					int x = tileIndex % mWidth;
-					int y = tileIndex / mWidth;
-
-					std::array<sf::Vertex, 4> quad;
-					quad[0].position = sf::Vector2f((float)x * mTilewidth, (float)y * mTileheight);
-					quad[1].position = sf::Vector2f((x + 1.f) * mTilewidth, (float)y * mTileheight);
-					quad[2].position = sf::Vector2f((x + 1.f) * mTilewidth, (y + 1.f) * mTileheight);
-					quad[3].position = sf::Vector2f((float)x * mTilewidth, (y + 1.f) * mTileheight);
-
-					auto tilesetIter = getTilesetIterator(tile.gid, mTilesets);
-					int localId = tile.gid - tilesetIter->firstgid;
-					int tu = localId % (tilesetIter->image.width / tilesetIter->tilewidth);
-					int tv = localId / (tilesetIter->image.width / tilesetIter->tilewidth);
-
-					quad[0].texCoords = sf::Vector2f((float)tu * mTilewidth, (float)tv * mTileheight);
-					quad[1].texCoords = sf::Vector2f((tu + 1.f) * mTilewidth, (float)tv * mTileheight);
-					quad[2].texCoords = sf::Vector2f((tu + 1.f) * mTilewidth, (tv + 1.f) * mTileheight);
-					quad[3].texCoords = sf::Vector2f((float)tu * mTilewidth, (tv + 1.f) * mTileheight);
-
-					int tilesetIndex = tilesetIter - mTilesets.begin();
-					std::for_each(quad.begin(), quad.end(), [&vertexArrays, tilesetIndex](sf::Vertex& v) {
-						vertexArrays[tilesetIndex].append(v);
-					});
+					continue;
 				}
-				++tileIndex;
+
+				std::array<sf::Vertex, 4> quad;
+				makeQuad(x, y, (int)unpackTile(pRow[x]), quad.data());
+
+				int tilesetIndex = getGidInfo(gid).tileset;
+				std::for_each(quad.begin(), quad.end(), [&vertexArrays, tilesetIndex](sf::Vertex& v) {
+					vertexArrays[tilesetIndex].append(v);
+				});
 			}
+		}
 
-			return vertexArrays;
-		});
+		return vertexArrays;
 	}
 
-	const TMX::TileData& TMX::getTileData(int x, int y, const TMX::Layer& layer) const
+	void TMX::makeQuad(int x, int y, int gid, sf::Vertex* pQuad) const
 	{
-		int i = y * mWidth + x;
-		if (i >= mWidth * mHeight)
+		pQuad[0].position = sf::Vector2f((float)x * mTilewidth, (float)y * mTileheight);
+		pQuad[1].position = sf::Vector2f((x + 1.f) * mTilewidth, (float)y * mTileheight);
+		pQuad[2].position = sf::Vector2f((x + 1.f) * mTilewidth, (y + 1.f) * mTileheight);
+		pQuad[3].position = sf::Vector2f((float)x * mTilewidth, (y + 1.f) * mTileheight);
+
+		const unsigned int flags = (unsigned int)gid & FLIP_FLAGS;
+		const sf::Vector2f& texCoords = getGidInfo((int)((unsigned int)gid & ~FLIP_FLAGS)).texCoords;
+		std::array<sf::Vector2f, 4> corners = {
+			texCoords,
+			sf::Vector2f(texCoords.x + mTilewidth, texCoords.y),
+			sf::Vector2f(texCoords.x + mTilewidth, texCoords.y + mTileheight),
+			sf::Vector2f(texCoords.x, texCoords.y + mTileheight)
+		};
+		if ((flags & FLIPPED_DIAGONALLY) != 0)
+		{
+			std::swap(corners[1], corners[3]);
+		}
+		if ((flags & FLIPPED_HORIZONTALLY) != 0)
+		{
+			std::swap(corners[0], corners[1]);
+			std::swap(corners[2], corners[3]);
+		}
+		if ((flags & FLIPPED_VERTICALLY) != 0)
+		{
+			std::swap(corners[0], corners[3]);
+			std::swap(corners[1], corners[2]);
+		}
+		for (int i = 0; i < 4; ++i)
+		{
+			pQuad[i].texCoords = corners[i];
+		}
+	}
+
+	int TMX::getTile(int layer, int x, int y) const
+	{
+		if (layer < 0 || layer >= (int)mLayers.size() || x < 0 || x >= mWidth || y < 0 || y >= mHeight)
 		{
 			throw std::out_of_range("Tile coordinates are out of bounds.");
 		}
-		const Tile& tile = layer.data.tiles[i];
-		if (tile.gid == 0)
+		return (int)unpackTile(mLayers[layer].data.tiles[index(x, y)]);
+	}
+
+	void TMX::setTile(int layer, int x, int y, int gid)
+	{
+		getTile(layer, x, y);
+		const int id = (int)((unsigned int)gid & ~FLIP_FLAGS);
+		if (id != 0)
 		{
-			return TMX::NULL_DATA;
+			getGidInfo(id);
 		}
-		auto tilesetIter = getTilesetIterator(tile.gid, mTilesets);
-		const int localId = tile.gid - tilesetIter->firstgid;
-		const std::vector<TileData>& tiles = tilesetIter->tiles;
-		auto result = std::find_if(tiles.begin(), tiles.end(), [localId](const TileData& data) {
-			return localId == data.id;
+
+		mLayers[layer].data.tiles[index(x, y)] = packTile((unsigned int)gid);
+		mbCompiled = false;
+		mOptions &= ~CACHE;
+	}
+
+	int TMX::getTilesetIndex(int gid) const
+	{
+		return getGidInfo((int)((unsigned int)gid & ~FLIP_FLAGS)).tileset;
+	}
+
+	bool TMX::hasColliderOutlines(int gid) const
+	{
+		const int id = (int)((unsigned int)gid & ~FLIP_FLAGS);
+		return id != 0 && getGidInfo(id).outlined;
+	}
+
+	bool TMX::isTileAligned() const
+	{
+		for (const ObjectGroup& group : mObjectGroups)
+		{
+			if (group.name == COLLISION_GROUP && !group.objects.empty()) return false;
+		}
+		for (const GidInfo& info : mGids)
+		{
+			if (info.tileData < 0) continue;
+			if (info.outlined) return false;
+			for (const Object& obj : mTilesets[info.tileset].tiles[info.tileData].objectgroup.objects)
+			{
+				if (obj.x != 0 || obj.y != 0 || obj.width != mTilewidth || obj.height != mTileheight) return false;
+			}
+		}
+		return true;
+	}
+
+	const std::vector<sf::FloatRect>& TMX::getColliderRects() const
+	{
+		return mColliderRects;
+	}
+
+	const std::vector<TMX::Outline>& TMX::getColliderOutlines() const
+	{
+		return mColliderOutlines;
+	}
+
+	void TMX::compile()
+	{
+		if (mbCompiled)
+		{
+			return;
+		}
+
+		// Rows are gathered in bands in parallel; merging afterwards joins rectangles across bands
+		mColliderRects.clear();
+		std::mutex mutex;
+		parallelFor(0, mHeight, MIN_BAND_ROWS, [&mutex, this](int top, int bottom) {
+			std::vector<sf::FloatRect> band;
+			makeColliderRects({ 0, top, mWidth, bottom - top }, band, false);
+			std::lock_guard<std::mutex> lock(mutex);
+			mColliderRects.insert(mColliderRects.end(), band.begin(), band.end());
 		});
-		if (result == tiles.end())
+		mergeColliderRects(mColliderRects);
+		makeColliderOutlines({ 0, 0, mWidth, mHeight }, mColliderOutlines);
+
+		buildNavGraphData(mColliderRects, mColliderOutlines, mNavGraphData);
+		mbCompiled = true;
+
+		if ((mOptions & CACHE) != 0)
 		{
-			return TMX::NULL_DATA;
+			MapCache::write(mFilename, MapCache::getCacheFilename(mFilename), *this);
 		}
-		return *result;
 	}
 
-	CompositeCollider* TMX::makeCollider(const sf::Transform& sourceTransform) const
+	bool TMX::isCompiled() const
 	{
-		CompositeCollider* pCollider = new CompositeCollider();
-		std::for_each(mLayers.begin(), mLayers.end(), [pCollider, &sourceTransform, this](const Layer& layer) {
-			for (int y = 0; y < mHeight; ++y)
+		return mbCompiled;
+	}
+
+	// Replaces the rectangles by a greedy decomposition of the area they cover.
+	// The area is cut into cells along every rectangle edge; from the first
+	// unclaimed cell in row order a rectangle grows right as far as it can,
+	// then down while the whole run below is unclaimed.
+	void TMX::mergeColliderRects(std::vector<sf::FloatRect>& rects)
+	{
+		if (rects.empty())
+		{
+			return;
+		}
+
+		std::vector<float> xs, ys;
+		for (const sf::FloatRect& rect : rects)
+		{
+			xs.push_back(rect.left);
+			xs.push_back(rect.left + rect.width);
+			ys.push_back(rect.top);
+			ys.push_back(rect.top + rect.height);
+		}
+		std::sort(xs.begin(), xs.end());
+		xs.erase(std::unique(xs.begin(), xs.end()), xs.end());
+		std::sort(ys.begin(), ys.end());
+		ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+
+		auto xIndex = [&xs](float x) { return (int)(std::lower_bound(xs.begin(), xs.end(), x) - xs.begin()); };
+		auto yIndex = [&ys](float y) { return (int)(std::lower_bound(ys.begin(), ys.end(), y) - ys.begin()); };
+
+		enum { EMPTY, COVERED, CLAIMED };
+		const int width = (int)xs.size() - 1, height = (int)ys.size() - 1;
+		std::vector<char> cells((size_t)std::max(width, 0) * std::max(height, 0), EMPTY);
+		for (const sf::FloatRect& rect : rects)
+		{
+			const int right = xIndex(rect.left + rect.width), bottom = yIndex(rect.top + rect.height);
+			for (int y = yIndex(rect.top); y < bottom; ++y)
+			{
+				for (int x = xIndex(rect.left); x < right; ++x)
+				{
+					cells[y * width + x] = COVERED;
+				}
+			}
+		}
+
+		rects.clear();
+		for (int y = 0; y < height; ++y)
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				if (cells[y * width + x] != COVERED)
+				{
+					continue;
+				}
+
+				int right = x + 1;
+				while (right < width && cells[y * width + right] == COVERED) ++right;
+
+				int bottom = y + 1;
+				while (bottom < height && std::all_of(&cells[bottom * width + x], &cells[bottom * width + right], [](char cell) { return cell == COVERED; })) ++bottom;
+
+				for (int row = y; row < bottom; ++row)
+				{
+					std::fill(&cells[row * width + x], &cells[row * width + right], (char)CLAIMED);
+				}
+				rects.push_back({ xs[x], ys[y], xs[right] - xs[x], ys[bottom] - ys[y] });
+			}
+		}
+	}
+
+	void TMX::makeColliderRects(const sf::IntRect& region, std::vector<sf::FloatRect>& rects, bool merge) const
+	{
+		for (const Layer& layer : mLayers)
+		{
+			for (int y = region.top; y < region.top + region.height; ++y)
+			{
+				const Tile* pRow = &layer.data.tiles[index(0, y)];
+				for (int x = region.left; x < region.left + region.width; ++x)
+				{
+					const int gid = getTileGid(pRow[x]);
+					if (gid == 0)
+					{
+						continue;
+					}
+					const GidInfo& info = getGidInfo(gid);
+					if (!info.solid)
+					{
+						continue;
+					}
+					const unsigned int flags = unpackTile(pRow[x]) & FLIP_FLAGS;
+					const float left = (float)x * mTilewidth;
+					const float top = (float)y * mTileheight;
+					for (const Object& obj : mTilesets[info.tileset].tiles[info.tileData].objectgroup.objects)
+					{
+						if (obj.polygons.empty())
+						{
+							sf::FloatRect rect((float)obj.x, (float)obj.y, (float)obj.width, (float)obj.height);
+							if (flags != 0)
+							{
+								rect = flipTileRect(rect, flags, (float)mTilewidth, (float)mTileheight);
+							}
+							rects.push_back({ left + rect.left, top + rect.top, rect.width, rect.height });
+						}
+					}
+				}
+			}
+		}
+
+		if (merge)
+		{
+			mergeColliderRects(rects);
+		}
+	}
+
+	void TMX::makeWalkable(const sf::IntRect& region, std::vector<char>& walkable) const
+	{
+		// Colliders of neighbouring tiles may reach into the region, so gather a one tile margin
+		const int left = std::max(region.left - 1, 0);
+		const int top = std::max(region.top - 1, 0);
+		const int right = std::min(region.left + region.width + 1, mWidth);
+		const int bottom = std::min(region.top + region.height + 1, mHeight);
+		std::vector<sf::FloatRect> rects;
+		makeColliderRects({ left, top, right - left, bottom - top }, rects);
+		std::vector<Outline> outlines;
+		makeColliderOutlines({ left, top, right - left, bottom - top }, outlines);
+
+		makeWalkable(rects, outlines, region, walkable);
+	}
+
+	void TMX::makeColliderOutlines(const sf::IntRect& region, std::vector<Outline>& outlines) const
+	{
+		typedef std::pair<sf::Vector2f, sf::Vector2f> Edge;
+		auto lessPoint = [](const sf::Vector2f& a, const sf::Vector2f& b) {
+			return std::tie(a.x, a.y) < std::tie(b.x, b.y);
+		};
+		auto lessEdge = [&lessPoint](const Edge& a, const Edge& b) {
+			return lessPoint(a.first, b.first) || (a.first == b.first && lessPoint(a.second, b.second));
+		};
+
+		// Closed shapes are broken into edges wound the same way
+		std::vector<Edge> edges;
+		std::vector<std::vector<sf::Vector2f>> lines;
+		auto addShape = [&edges, &lines](std::vector<sf::Vector2f>& points, bool closed) {
+			points.erase(std::unique(points.begin(), points.end()), points.end());
+			if (!closed)
 			{
-				for (int x = 0; x < mWidth; ++x)
+				if (points.size() >= 2) lines.push_back(points);
+				return;
+			}
+			if (points.size() > 1 && points.front() == points.back()) points.pop_back();
+			float area = 0;
+			for (size_t i = 0; i < points.size(); ++i)
+			{
+				const sf::Vector2f& a = points[i];
+				const sf::Vector2f& b = points[(i + 1) % points.size()];
+				area += a.x * b.y - b.x * a.y;
+			}
+			if (area == 0) return;
+			if (area > 0) std::reverse(points.begin(), points.end());
+			for (size_t i = 0; i < points.size(); ++i)
+			{
+				edges.push_back({ points[i], points[(i + 1) % points.size()] });
+			}
+		};
+
+		std::vector<sf::Vector2f> points;
+		for (const Layer& layer : mLayers)
+		{
+			for (int y = region.top; y < region.top + region.height; ++y)
+			{
+				const Tile* pRow = &layer.data.tiles[index(0, y)];
+				for (int x = region.left; x < region.left + region.width; ++x)
 				{
-					const TMX::TileData& tileData = getTileData(x, y, layer);
-					if (tileData.id != NULL_TILE)
+					const int gid = getTileGid(pRow[x]);
+					if (gid == 0)
+					{
+						continue;
+					}
+					const GidInfo& info = getGidInfo(gid);
+					if (!info.outlined)
+					{
+						continue;
+					}
+					const unsigned int flags = unpackTile(pRow[x]) & FLIP_FLAGS;
+					const sf::Vector2f origin((float)x * mTilewidth, (float)y * mTileheight);
+					for (const Object& obj : mTilesets[info.tileset].tiles[info.tileData].objectgroup.objects)
 					{
-						sf::Transform transform = sourceTransform;
-						transform.translate((float)x * mTilewidth, (float)y * mTileheight);
-						std::for_each(tileData.objectgroup.objects.begin(), tileData.objectgroup.objects.end(), [pCollider, &transform](const Object& obj) {
-							if (obj.polygons.size() == 0) {
-								pCollider->addCollider({ transform.transformRect({ (float)obj.x, (float)obj.y, (float)obj.width, (float)obj.height }) });
+						for (const Polygon& polygon : obj.polygons)
+						{
+							points.clear();
+							for (const sf::Vector2i& point : polygon.points)
+							{
+								const sf::Vector2f local((float)(obj.x + point.x), (float)(obj.y + point.y));
+								points.push_back(origin + flipTilePoint(local, flags, (float)mTilewidth, (float)mTileheight));
 							}
-						});
+							addShape(points, polygon.closed);
+						}
 					}
 				}
 			}
-		});
+		}
+
+		for (const ObjectGroup& group : mObjectGroups)
+		{
+			if (group.name != COLLISION_GROUP)
+			{
+				continue;
+			}
+			for (const Object& obj : group.objects)
+			{
+				const int x = std::max(0, std::min((int)std::floor((float)obj.x / mTilewidth), mWidth - 1));
+				const int y = std::max(0, std::min((int)std::floor((float)obj.y / mTileheight), mHeight - 1));
+				if (!region.contains(x, y))
+				{
+					continue;
+				}
+				const sf::Vector2f origin((float)obj.x, (float)obj.y);
+				if (obj.polygons.empty())
+				{
+					points = { origin, origin + sf::Vector2f(0, (float)obj.height), origin + sf::Vector2f((float)obj.width, (float)obj.height), origin + sf::Vector2f((float)obj.width, 0) };
+					addShape(points, true);
+				}
+				for (const Polygon& polygon : obj.polygons)
+				{
+					points.clear();
+					for (const sf::Vector2i& point : polygon.points)
+					{
+						points.push_back(origin + sf::Vector2f((float)point.x, (float)point.y));
+					}
+					addShape(points, polygon.closed);
+				}
+			}
+		}
+
+		// An edge shared by two shapes runs both ways and lies inside the merged
+		// shape, so both copies are dropped; the remaining edges form loops
+		std::sort(edges.begin(), edges.end(), lessEdge);
+		edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+		std::vector<char> used(edges.size(), 0);
+		for (size_t i = 0; i < edges.size(); ++i)
+		{
+			if (used[i]) continue;
+			auto range = std::equal_range(edges.begin(), edges.end(), Edge(edges[i].second, edges[i].first), lessEdge);
+			if (range.first != range.second)
+			{
+				used[i] = 1;
+				used[range.first - edges.begin()] = 1;
+			}
+		}
+
+		auto findNext = [&edges, &used, &lessPoint](const sf::Vector2f& from) {
+			auto iter = std::lower_bound(edges.begin(), edges.end(), from, [&lessPoint](const Edge& edge, const sf::Vector2f& point) {
+				return lessPoint(edge.first, point);
+			});
+			for (; iter != edges.end() && iter->first == from; ++iter)
+			{
+				if (!used[iter - edges.begin()]) return (int)(iter - edges.begin());
+			}
+			return -1;
+		};
+
+		// Points in the middle of a straight run are left over from the shapes that were joined
+		outlines.clear();
+		auto addOutline = [&outlines](const std::vector<sf::Vector2f>& points, bool loop) {
+			std::vector<sf::Vector2f> kept;
+			const size_t n = points.size();
+			for (size_t j = 0; j < n; ++j)
+			{
+				if (loop || (j > 0 && j + 1 < n))
+				{
+					const sf::Vector2f in = points[j] - points[(j + n - 1) % n];
+					const sf::Vector2f out = points[(j + 1) % n] - points[j];
+					if (in.x * out.y - in.y * out.x == 0 && in.x * out.x + in.y * out.y > 0) continue;
+				}
+				kept.push_back(points[j]);
+			}
+			if (kept.size() >= (loop ? 3u : 2u))
+			{
+				outlines.push_back({ std::move(kept), loop });
+			}
+		};
+
+		for (size_t i = 0; i < edges.size(); ++i)
+		{
+			if (used[i]) continue;
+			points.clear();
+			bool loop = false;
+			for (int curr = (int)i; ; )
+			{
+				used[curr] = 1;
+				points.push_back(edges[curr].first);
+				const sf::Vector2f to = edges[curr].second;
+				if (to == edges[i].first)
+				{
+					loop = true;
+					break;
+				}
+				curr = findNext(to);
+				if (curr == -1)
+				{
+					points.push_back(to);
+					break;
+				}
+			}
+			addOutline(points, loop);
+		}
+
+		// Polylines meeting end to end are joined, turning one round where needed
+		std::multimap<sf::Vector2f, size_t, decltype(lessPoint)> lineEnds(lessPoint);
+		for (size_t i = 0; i < lines.size(); ++i)
+		{
+			lineEnds.insert({ lines[i].front(), i });
+			lineEnds.insert({ lines[i].back(), i });
+		}
+		std::vector<char> joined(lines.size(), 0);
+		auto findLine = [&lineEnds, &joined](const sf::Vector2f& point) {
+			auto range = lineEnds.equal_range(point);
+			for (auto iter = range.first; iter != range.second; ++iter)
+			{
+				if (!joined[iter->second]) return (int)iter->second;
+			}
+			return -1;
+		};
+		for (size_t i = 0; i < lines.size(); ++i)
+		{
+			if (joined[i]) continue;
+			joined[i] = 1;
+			points = lines[i];
+			for (int next; points.front() != points.back() && (next = findLine(points.back())) != -1; )
+			{
+				joined[next] = 1;
+				std::vector<sf::Vector2f>& line = lines[next];
+				if (line.front() != points.back()) std::reverse(line.begin(), line.end());
+				points.insert(points.end(), line.begin() + 1, line.end());
+			}
+			for (int prev; points.front() != points.back() && (prev = findLine(points.front())) != -1; )
+			{
+				joined[prev] = 1;
+				std::vector<sf::Vector2f>& line = lines[prev];
+				if (line.back() != points.front()) std::reverse(line.begin(), line.end());
+				points.insert(points.begin(), line.begin(), line.end() - 1);
+			}
+			addOutline(points, false);
+		}
+	}
+
+	CompositeCollider* TMX::makeCollider(const sf::Transform& transform) const
+	{
+		CompositeCollider* pCollider = new CompositeCollider();
+		for (auto& rect : mColliderRects)
+		{
+			pCollider->addBox(transform.transformRect(rect));
+		}
+		for (auto& outline : mColliderOutlines)
+		{
+			std::vector<sf::Vector2f> points(outline.points.size());
+			std::transform(outline.points.begin(), outline.points.end(), points.begin(), [&transform](const sf::Vector2f& point) {
+				return transform.transformPoint(point);
+			});
+			pCollider->addCollider(ChainCollider(points, outline.loop));
+		}
 		return pCollider;
 	}
 
@@ -272,106 +712,179 @@ namespace te
 		return y * mWidth + x;
 	}
 
-	SparseGraph<NavGraphNode, NavGraphEdge>* TMX::makeNavGraph(const sf::Transform& transform) const
+	void TMX::makeWalkable(const std::vector<sf::FloatRect>& rects, const std::vector<Outline>& outlines, const sf::IntRect& region, std::vector<char>& walkable) const
 	{
-		std::unique_ptr<CompositeCollider> pCollider(makeCollider(transform));
-		NavGraphNode seedNode;
-		seedNode.setIndex(-1);
-		int x = 0, y = 0;
-		while (seedNode.getIndex() == -1 && y < mHeight)
+		std::vector<std::pair<float, float>> loopSpans;
+		for (auto& outline : outlines)
 		{
-			sf::Vector2f coords = transform.transformPoint({ x * mTilewidth + (mTilewidth / 2.f), y * mTileheight + (mTileheight / 2.f) });
-			if (!pCollider->contains(coords.x, coords.y))
+			auto span = std::minmax_element(outline.points.begin(), outline.points.end(), [](const sf::Vector2f& a, const sf::Vector2f& b) {
+				return a.y < b.y;
+			});
+			loopSpans.push_back(outline.loop ? std::make_pair(span.first->y, span.second->y) : std::make_pair(1.f, 0.f));
+		}
+
+		walkable.assign((size_t)region.width * region.height, 1);
+		parallelFor(region.top, region.top + region.height, MIN_BAND_ROWS, [&walkable, &rects, &outlines, &loopSpans, &region, this](int top, int bottom) {
+			for (auto& rect : rects)
 			{
-				seedNode.setIndex(0);
-				seedNode.setPosition(coords);
+				// Tiles whose centre lies inside or on the edge of the rectangle
+				int x0 = std::max((int)std::ceil((rect.left - mTilewidth / 2.f) / mTilewidth), region.left);
+				int x1 = std::min((int)std::floor((rect.left + rect.width - mTilewidth / 2.f) / mTilewidth), region.left + region.width - 1);
+				int y0 = std::max((int)std::ceil((rect.top - mTileheight / 2.f) / mTileheight), top);
+				int y1 = std::min((int)std::floor((rect.top + rect.height - mTileheight / 2.f) / mTileheight), bottom - 1);
+				if (x0 > x1) continue;
+				for (int y = y0; y <= y1; ++y)
+				{
+					std::fill_n(walkable.begin() + (y - region.top) * region.width + (x0 - region.left), x1 - x0 + 1, 0);
+				}
 			}
-			else
+
+			// Tiles whose centre lies inside the loops, by the nonzero winding rule; polylines have no inside
+			std::vector<std::pair<float, int>> crossings;
+			for (int y = top; y < bottom; ++y)
 			{
-				++x;
-				if (x == mWidth)
+				const float centreY = (y + 0.5f) * mTileheight;
+				crossings.clear();
+				for (size_t i = 0; i < outlines.size(); ++i)
 				{
-					x = 0;
-					++y;
+					if (centreY < loopSpans[i].first || centreY > loopSpans[i].second) continue;
+					const std::vector<sf::Vector2f>& points = outlines[i].points;
+					for (size_t j = 0; j < points.size(); ++j)
+					{
+						const sf::Vector2f& a = points[j];
+						const sf::Vector2f& b = points[(j + 1) % points.size()];
+						if ((a.y <= centreY) == (b.y <= centreY)) continue;
+						crossings.push_back({ a.x + (centreY - a.y) / (b.y - a.y) * (b.x - a.x), b.y > a.y ? 1 : -1 });
+					}
+				}
+				std::sort(crossings.begin(), crossings.end());
+
+				int winding = 0;
+				for (size_t i = 0; i + 1 < crossings.size(); ++i)
+				{
+					winding += crossings[i].second;
+					if (winding == 0) continue;
+					int x0 = std::max((int)std::ceil(crossings[i].first / mTilewidth - 0.5f), region.left);
+					int x1 = std::min((int)std::floor(crossings[i + 1].first / mTilewidth - 0.5f), region.left + region.width - 1);
+					if (x0 > x1) continue;
+					std::fill_n(walkable.begin() + (y - region.top) * region.width + (x0 - region.left), x1 - x0 + 1, 0);
 				}
 			}
+		});
+	}
+
+	void TMX::buildNavGraphData(const std::vector<sf::FloatRect>& rects, const std::vector<Outline>& outlines, NavGraphData& data) const
+	{
+		data.positions.clear();
+		data.edgeOffsets.clear();
+		data.edgeTargets.clear();
+
+		std::vector<char> walkable;
+		makeWalkable(rects, outlines, { 0, 0, mWidth, mHeight }, walkable);
+
+		// Only tiles reachable from the first walkable tile become nodes
+		auto seedIter = std::find(walkable.begin(), walkable.end(), 1);
+		if (seedIter == walkable.end())
+		{
+			data.edgeOffsets.push_back(0);
+			return;
 		}
 
-		SparseGraph<NavGraphNode, NavGraphEdge>* pGraph = new SparseGraph<NavGraphNode, NavGraphEdge>();
-		if (seedNode.getIndex() != -1)
-		{
-			int seedIndex = pGraph->addNode(seedNode);
-
-			std::vector<NavGraphNode> allNodes;
-			std::map<sf::Vector2f, int> assigned;
-			assigned.insert(std::make_pair(pGraph->getNode(seedIndex).getPosition(), seedIndex));
-			auto flood = [&, this](int startIndex) {
-				sf::Vector2f pos = pGraph->getNode(startIndex).getPosition();
-				std::vector<int> newIndices;
-
-				const std::array<sf::Vector2f, 4> offsets = {
-					transform.transformPoint(sf::Vector2f((float)mTilewidth, 0)),
-					transform.transformPoint(sf::Vector2f(-(float)mTilewidth, 0)),
-					transform.transformPoint(sf::Vector2f(0, (float)mTileheight)),
-					transform.transformPoint(sf::Vector2f(0, -(float)mTileheight))
-				};
-				std::for_each(offsets.begin(), offsets.end(), [&](const sf::Vector2f& offset) {
-					sf::Vector2f newPos = offset + pos;
-					sf::Vector2f max = transform.transformPoint((float)mWidth * mTilewidth, (float)mHeight * mTileheight);
-					if (assigned.find(newPos) == assigned.end() && !pCollider->contains(newPos.x, newPos.y) && newPos.x > 0 && newPos.x < max.x && newPos.y > 0 && newPos.y < max.y)
-					{
-						NavGraphNode newNode;
-						newNode.setPosition(newPos);
-						int newIndex = pGraph->addNode(newNode);
-						//graph.addEdge(NavGraphEdge(startIndex, newIndex, length(graph.getNode(startIndex).getPosition() - newPos)));
+		const int numTiles = mWidth * mHeight;
+		std::vector<int> nodeIndices(numTiles, -1);
+		std::vector<int> open;
+		open.reserve(numTiles);
+		open.push_back(seedIter - walkable.begin());
+		nodeIndices[open.back()] = 0;
+		for (size_t i = 0; i < open.size(); ++i)
+		{
+			const int tile = open[i];
+			const int x = tile % mWidth, y = tile / mWidth;
+			const std::array<int, 4> neighbors = {
+				x + 1 < mWidth ? tile + 1 : -1,
+				x > 0 ? tile - 1 : -1,
+				y + 1 < mHeight ? tile + mWidth : -1,
+				y > 0 ? tile - mWidth : -1
+			};
+			for (int neighbor : neighbors)
+			{
+				if (neighbor != -1 && walkable[neighbor] && nodeIndices[neighbor] == -1)
+				{
+					nodeIndices[neighbor] = 0;
+					open.push_back(neighbor);
+				}
+			}
+		}
+
+		int numNodes = 0;
+		for (int& index : nodeIndices)
+		{
+			if (index != -1) index = numNodes++;
+		}
 
-						assigned.insert(std::make_pair(newPos, newIndex));
-						newIndices.push_back(newIndex);
+		data.positions.reserve(numNodes);
+		data.edgeOffsets.reserve(numNodes + 1);
+		data.edgeTargets.reserve(numNodes * 8);
+		data.edgeOffsets.push_back(0);
+
+		const std::array<sf::Vector2i, 8> offsets = {
+			sf::Vector2i(1, 0), sf::Vector2i(-1, 0), sf::Vector2i(0, 1), sf::Vector2i(0, -1),
+			sf::Vector2i(1, 1), sf::Vector2i(-1, 1), sf::Vector2i(-1, -1), sf::Vector2i(1, -1)
+		};
+		for (int y = 0; y < mHeight; ++y)
+		{
+			for (int x = 0; x < mWidth; ++x)
+			{
+				if (nodeIndices[index(x, y)] == -1) continue;
+
+				data.positions.push_back(sf::Vector2f(x * mTilewidth + (mTilewidth / 2.f), y * mTileheight + (mTileheight / 2.f)));
+				for (auto& offset : offsets)
+				{
+					int nx = x + offset.x, ny = y + offset.y;
+					if (nx >= 0 && nx < mWidth && ny >= 0 && ny < mHeight && nodeIndices[index(nx, ny)] != -1)
+					{
+						data.edgeTargets.push_back(nodeIndices[index(nx, ny)]);
 					}
-				});
+				}
+				data.edgeOffsets.push_back((int)data.edgeTargets.size());
+			}
+		}
+	}
 
-				// Add diagonal edges
-				std::for_each(newIndices.begin(), newIndices.end(), [&](int newIndex) {
-					sf::Vector2f newPosition = pGraph->getNode(newIndex).getPosition();
-
-					const std::array<sf::Vector2f, 8> neighbors = {
-						transform.transformPoint(sf::Vector2f((float)mTilewidth, 0)),
-						transform.transformPoint(sf::Vector2f(-(float)mTilewidth, 0)),
-						transform.transformPoint(sf::Vector2f(0, (float)mTileheight)),
-						transform.transformPoint(sf::Vector2f(0, -(float)mTileheight)),
-						transform.transformPoint(sf::Vector2f((float)mTilewidth, (float)mTileheight)),
-						transform.transformPoint(sf::Vector2f(-(float)mTilewidth, (float)mTileheight)),
-						transform.transformPoint(sf::Vector2f(-(float)mTilewidth, -(float)mTileheight)),
-						transform.transformPoint(sf::Vector2f((float)mTilewidth, -(float)mTileheight))
-					};
-					std::for_each(neighbors.begin(), neighbors.end(), [&](sf::Vector2f offset) {
-						sf::Vector2f neighbor = newPosition + offset;
-						auto neighborIndexIter = assigned.find(neighbor);
-						if (neighborIndexIter != assigned.end())
-						{
-							pGraph->addEdge(NavGraphEdge(newIndex, neighborIndexIter->second, length(pGraph->getNode(newIndex).getPosition() - neighbor)));
-						}
-					});
-				});
-				return newIndices;
-			};
+	SparseGraph<NavGraphNode, NavGraphEdge>* TMX::makeNavGraph(const sf::Transform& transform) const
+	{
+		SparseGraph<NavGraphNode, NavGraphEdge>* pGraph = new SparseGraph<NavGraphNode, NavGraphEdge>();
+		for (int i = 0; i < mWidth * mHeight; ++i)
+		{
+			pGraph->removeNode(pGraph->addNode(NavGraphNode()));
+		}
 
-			auto flatMapFlood = [&](std::vector<int> indices) {
-				std::vector<int> newIndices;
-				std::for_each(indices.begin(), indices.end(), [&](int index) {
-					std::vector<int> currIndices = flood(index);
-					newIndices.insert(newIndices.end(), currIndices.begin(), currIndices.end());
-				});
-				return newIndices;
-			};
+		const int numNodes = (int)mNavGraphData.positions.size();
+		std::vector<int> tiles(numNodes);
+		for (int i = 0; i < numNodes; ++i)
+		{
+			const sf::Vector2f& position = mNavGraphData.positions[i];
+			tiles[i] = index((int)(position.x / mTilewidth), (int)(position.y / mTileheight));
+
+			NavGraphNode node;
+			node.setPosition(transform.transformPoint(position));
+			pGraph->restoreNode(tiles[i], node);
+		}
 
-			std::vector<int> newIndices = flatMapFlood({ seedIndex });
-			while (newIndices.size() > 0)
+		for (int from = 0; from < numNodes; ++from)
+		{
+			for (int i = mNavGraphData.edgeOffsets[from]; i < mNavGraphData.edgeOffsets[from + 1]; ++i)
 			{
-				newIndices = flatMapFlood(newIndices);
+				// Each undirected edge is stored in both directions; SparseGraph adds the reverse itself
+				int to = mNavGraphData.edgeTargets[i];
+				if (from < to)
+				{
+					const NavGraphNode& fromNode = pGraph->getNode(tiles[from]);
+					const NavGraphNode& toNode = pGraph->getNode(tiles[to]);
+					pGraph->addEdge(NavGraphEdge(tiles[from], tiles[to], distance(fromNode.getPosition(), toNode.getPosition())));
+				}
 			}
 		}
-		pGraph->pruneEdges();
 		return pGraph;
 	}
 
@@ -395,8 +908,22 @@ namespace te
 		return mTileheight;
 	}
 
+	int TMX::getNumLayers() const
+	{
+		return mLayers.size();
+	}
+
 	std::vector<TMX::ObjectGroup> TMX::getObjectGroups() const
 	{
 		return mObjectGroups;
 	}
+
+	std::vector<std::string> TMX::getTilesetImages() const
+	{
+		std::vector<std::string> images;
+		std::transform(mTilesets.begin(), mTilesets.end(), std::back_inserter(images), [](const Tileset& tileset) {
+			return tileset.image.source;
+		});
+		return images;
+	}
 }
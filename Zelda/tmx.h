@@ -3,6 +3,7 @@
 
 #include "sparse_graph.h"
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <memory>
@@ -16,12 +17,15 @@ namespace te
 	class CompositeCollider;
 	class NavGraphNode;
 	class NavGraphEdge;
+	class MapCache;
 
 	class TMX
 	{
 	public:
+		// A polyline is an open polygon
 		struct Polygon {
 			std::vector<sf::Vector2i> points;
+			bool closed;
 		};
 		struct Object {
 			int id;
@@ -37,21 +41,84 @@ namespace te
 			std::string draworder;
 			std::vector<Object> objects;
 		};
+		// Pixel space collision outline; loops are wound so wall normals face out of the solid
+		struct Outline {
+			std::vector<sf::Vector2f> points;
+			bool loop;
+		};
+
+		enum Options
+		{
+			CACHE   = 0x01,
+			COMPILE = 0x02,
+
+			DEFAULT = CACHE | COMPILE
+		};
+
+		// Tiled stores a tile's flips in the top bits of its GID. GIDs passed
+		// to and returned from TMX carry these flags.
+		enum Flags : unsigned int
+		{
+			FLIPPED_HORIZONTALLY = 0x80000000u,
+			FLIPPED_VERTICALLY   = 0x40000000u,
+			FLIPPED_DIAGONALLY   = 0x20000000u,
 
-		TMX(const std::string& filename);
+			FLIP_FLAGS = FLIPPED_HORIZONTALLY | FLIPPED_VERTICALLY | FLIPPED_DIAGONALLY
+		};
+
+		TMX(const std::string& filename, int options = DEFAULT);
+
+		void compile();
+		bool isCompiled() const;
+
+		void loadTextures(TextureManager& textureManager, std::vector<const sf::Texture*>& textures) const;
 		void makeVertices(TextureManager& textureManager, std::vector<const sf::Texture*>& textures, std::vector<std::vector<sf::VertexArray>>& layers) const;
 		CompositeCollider* makeCollider(const sf::Transform& transform = sf::Transform::Identity) const;
 
+		// Nodes are indexed by tile (y * width + x); tiles that are not part of the graph are removed nodes
 		SparseGraph<NavGraphNode, NavGraphEdge>* makeNavGraph(const sf::Transform& transform = sf::Transform::Identity) const;
 
+		// Region builders only read the parsed map, so they are safe to call from worker threads
+		void makeVertices(const sf::IntRect& region, std::vector<std::vector<sf::VertexArray>>& layers) const;
+		void makeColliderRects(const sf::IntRect& region, std::vector<sf::FloatRect>& rects, bool merge = true) const;
+		void makeWalkable(const sf::IntRect& region, std::vector<char>& walkable) const;
+		void makeQuad(int x, int y, int gid, sf::Vertex* pQuad) const;
+
+		// Polygon and polyline collision objects of tiles, and every object of
+		// the map's COLLISION_GROUP object groups whose origin lies in the
+		// region. Closed shapes are merged into loops along shared edges.
+		void makeColliderOutlines(const sf::IntRect& region, std::vector<Outline>& outlines) const;
+		void makeWalkable(const std::vector<sf::FloatRect>& rects, const std::vector<Outline>& outlines, const sf::IntRect& region, std::vector<char>& walkable) const;
+
+		static void mergeColliderRects(std::vector<sf::FloatRect>& rects);
+
+		static const std::string COLLISION_GROUP;
+
+		int getTile(int layer, int x, int y) const;
+		// Once a tile is changed the compiled collider and nav graph no longer
+		// describe the map, and the map is no longer written to the cache.
+		void setTile(int layer, int x, int y, int gid);
+		int getTilesetIndex(int gid) const;
+		bool hasColliderOutlines(int gid) const;
+		// True when every collision object is a rectangle covering its whole
+		// tile, so the map's collision is exactly its set of solid tiles
+		bool isTileAligned() const;
+		const std::vector<sf::FloatRect>& getColliderRects() const;
+		const std::vector<Outline>& getColliderOutlines() const;
+
 		int getWidth() const;
 		int getHeight() const;
 		int getTileWidth() const;
 		int getTileHeight() const;
+		int getNumLayers() const;
 
 		std::vector<ObjectGroup> getObjectGroups() const;
+		std::vector<std::string> getTilesetImages() const;
 
 	private:
+		friend class MapCache;
+		friend class TMXReader;
+
 		struct Image {
 			std::string source;
 			int width;
@@ -70,8 +137,10 @@ namespace te
 			Image image;
 			std::vector<TileData> tiles;
 		};
+		// Layer tiles keep Tiled's 32-bit layout: the GID in the low 29 bits
+		// and the flip flags in the top 3.
 		struct Tile {
-			int gid;
+			std::uint32_t bits;
 		};
 		struct Data {
 			std::vector<Tile> tiles;
@@ -82,15 +151,39 @@ namespace te
 			int height;
 			Data data;
 		};
+		// Nav graph in compressed sparse row form, node positions in pixel space
+		struct NavGraphData {
+			std::vector<sf::Vector2f> positions;
+			std::vector<int> edgeOffsets;
+			std::vector<int> edgeTargets;
+		};
 
-		static const int NULL_TILE;
-		static const TileData NULL_DATA;
+		// Smallest number of rows handed to a worker when a pass is split into row bands
+		static const int MIN_BAND_ROWS;
 
-		//std::vector<Tileset>::const_iterator getTilesetIterator(int gid) const;
-		friend std::vector<Tileset>::const_iterator getTilesetIterator(int, const std::vector<Tileset>&);
-		const TileData& getTileData(int x, int y, const Layer& layer) const;
+		// What the build passes need to know about a GID, so they never search the tilesets
+		struct GidInfo {
+			int tileset;
+			int tileData;
+			bool solid;
+			bool outlined;
+			sf::Vector2f texCoords;
+		};
+
+		static const unsigned int MAX_TILE_GID;
+
+		static Tile packTile(unsigned int gid);
+		static unsigned int unpackTile(Tile tile);
+		static int getTileGid(Tile tile);
+
+		void buildGidTable();
+		const GidInfo& getGidInfo(int gid) const;
 		int index(int x, int y) const;
 
+		void parse(const std::string& filename);
+		std::vector<sf::VertexArray> makeLayerVertices(const sf::IntRect& region, const Layer& layer) const;
+		void buildNavGraphData(const std::vector<sf::FloatRect>& rects, const std::vector<Outline>& outlines, NavGraphData& data) const;
+
 		int mWidth;
 		int mHeight;
 		int mTilewidth;
@@ -98,6 +191,14 @@ namespace te
 		std::vector<Tileset> mTilesets;
 		std::vector<Layer> mLayers;
 		std::vector<ObjectGroup> mObjectGroups;
+		std::vector<GidInfo> mGids;
+
+		std::string mFilename;
+		int mOptions;
+		bool mbCompiled;
+		std::vector<sf::FloatRect> mColliderRects;
+		std::vector<Outline> mColliderOutlines;
+		NavGraphData mNavGraphData;
 	};
 }
 
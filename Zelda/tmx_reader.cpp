@@ -0,0 +1,799 @@
+#include "tmx_reader.h"
+#include "tmx.h"
+#include "inflate.h"
+#include "xml_parse.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+namespace te
+{
+	// Pull tokenizer for the subset of XML that Tiled writes: elements,
+	// attributes, text, comments, processing instructions and CDATA. Text is
+	// handed out in spans of the read buffer, so element content of any size
+	// is never held in memory at once.
+	class XmlStream
+	{
+	public:
+		enum Event { START, END, TEXT, DONE };
+
+		struct Attribute
+		{
+			std::string name;
+			std::string value;
+		};
+
+		XmlStream(const std::string& filename)
+			: mFile(filename, std::ios::binary)
+			, mBuffer(BUFFER_SIZE)
+			, mPos(0)
+			, mEnd(0)
+			, mName()
+			, mAttributes()
+			, mNumAttributes(0)
+			, mOpenElements()
+			, mbPendingEnd(false)
+			, mpText(nullptr)
+			, mTextLength(0)
+			, mbInCData(false)
+			, mNumCDataBrackets(0)
+		{
+			if (!mFile)
+			{
+				throw std::runtime_error("cannot open file " + filename);
+			}
+		}
+
+		Event next()
+		{
+			if (mbPendingEnd)
+			{
+				mbPendingEnd = false;
+				mOpenElements.pop_back();
+				return END;
+			}
+
+			while (true)
+			{
+				if (mbInCData)
+				{
+					if (readCData()) return TEXT;
+					continue;
+				}
+
+				int c = peek();
+				if (c == EOF)
+				{
+					if (!mOpenElements.empty()) throw std::runtime_error("Unexpected end of file in <" + mOpenElements.back() + ">.");
+					return DONE;
+				}
+
+				if (c != '<')
+				{
+					const char* pBegin = mBuffer.data() + mPos;
+					const char* pStop = static_cast<const char*>(std::memchr(pBegin, '<', mEnd - mPos));
+					mTextLength = (pStop ? pStop : mBuffer.data() + mEnd) - pBegin;
+					mpText = pBegin;
+					mPos += mTextLength;
+					return TEXT;
+				}
+
+				++mPos;
+				c = peek();
+				if (c == '?')
+				{
+					skipPast("?>");
+				}
+				else if (c == '!')
+				{
+					++mPos;
+					if (tryConsume("--")) skipPast("-->");
+					else if (tryConsume("[CDATA[")) mbInCData = true;
+					else skipPast(">");
+				}
+				else if (c == '/')
+				{
+					++mPos;
+					readName(mName);
+					skipSpace();
+					expect('>');
+					if (mOpenElements.empty() || mOpenElements.back() != mName)
+					{
+						throw std::runtime_error("Mismatched closing tag </" + mName + ">.");
+					}
+					mOpenElements.pop_back();
+					return END;
+				}
+				else
+				{
+					readName(mName);
+					readAttributes();
+					mOpenElements.push_back(mName);
+					return START;
+				}
+			}
+		}
+
+		const std::string& getName() const { return mName; }
+		size_t getNumAttributes() const { return mNumAttributes; }
+		const Attribute& getAttribute(size_t i) const { return mAttributes[i]; }
+		const char* getText() const { return mpText; }
+		size_t getTextLength() const { return mTextLength; }
+		size_t getDepth() const { return mOpenElements.size(); }
+
+	private:
+		static const size_t BUFFER_SIZE = 64 * 1024;
+
+		int peek()
+		{
+			if (mPos == mEnd)
+			{
+				mFile.read(mBuffer.data(), mBuffer.size());
+				mPos = 0;
+				mEnd = (size_t)mFile.gcount();
+				if (mEnd == 0) return EOF;
+			}
+			return (unsigned char)mBuffer[mPos];
+		}
+
+		int get()
+		{
+			int c = peek();
+			if (c != EOF) ++mPos;
+			return c;
+		}
+
+		void expect(char expected)
+		{
+			if (get() != expected)
+			{
+				throw std::runtime_error(std::string("Malformed XML: expected '") + expected + "'.");
+			}
+		}
+
+		static bool isSpace(int c)
+		{
+			return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+		}
+
+		static bool isNameChar(int c)
+		{
+			return c != EOF && !isSpace(c) && c != '=' && c != '>' && c != '/' && c != '<' && c != '"' && c != '\'';
+		}
+
+		void skipSpace()
+		{
+			while (isSpace(peek())) ++mPos;
+		}
+
+		// Only called right after '<!', where the candidates differ in their first character
+		bool tryConsume(const char* str)
+		{
+			if (peek() != *str) return false;
+			for (; *str; ++str)
+			{
+				if (get() != *str) throw std::runtime_error("Malformed XML declaration.");
+			}
+			return true;
+		}
+
+		void skipPast(const char* terminator)
+		{
+			const size_t length = std::strlen(terminator);
+			size_t matched = 0;
+			while (matched < length)
+			{
+				int c = get();
+				if (c == EOF) throw std::runtime_error("Unexpected end of file.");
+				if (c == terminator[matched]) ++matched;
+				else matched = (c == terminator[0]) ? 1 : 0;
+			}
+		}
+
+		// Hands out the next span of CDATA content, false once its ']]>' is
+		// consumed. Brackets that may start the terminator are held back until
+		// the character after them shows whether they do.
+		bool readCData()
+		{
+			static const char BRACKETS[] = "]]";
+
+			int c = peek();
+			if (c == EOF) throw std::runtime_error("Unexpected end of file.");
+
+			if (mNumCDataBrackets > 0)
+			{
+				if (c == '>' && mNumCDataBrackets == 2)
+				{
+					++mPos;
+					mNumCDataBrackets = 0;
+					mbInCData = false;
+					return false;
+				}
+				if (c == ']' && mNumCDataBrackets < 2)
+				{
+					++mPos;
+					++mNumCDataBrackets;
+					return readCData();
+				}
+
+				// A third bracket releases the first; anything else releases them all
+				mpText = BRACKETS;
+				mTextLength = c == ']' ? 1 : mNumCDataBrackets;
+				mNumCDataBrackets -= (int)mTextLength;
+				return true;
+			}
+
+			if (c == ']')
+			{
+				++mPos;
+				mNumCDataBrackets = 1;
+				return readCData();
+			}
+
+			const char* pBegin = mBuffer.data() + mPos;
+			const char* pStop = static_cast<const char*>(std::memchr(pBegin, ']', mEnd - mPos));
+			mTextLength = (pStop ? pStop : mBuffer.data() + mEnd) - pBegin;
+			mpText = pBegin;
+			mPos += mTextLength;
+			return true;
+		}
+
+		void readName(std::string& name)
+		{
+			name.clear();
+			while (isNameChar(peek())) name.push_back((char)get());
+			if (name.empty()) throw std::runtime_error("Malformed XML: expected a name.");
+		}
+
+		void readAttributes()
+		{
+			mNumAttributes = 0;
+			while (true)
+			{
+				skipSpace();
+				int c = peek();
+				if (c == '/')
+				{
+					++mPos;
+					expect('>');
+					mbPendingEnd = true;
+					return;
+				}
+				if (c == '>')
+				{
+					++mPos;
+					return;
+				}
+
+				if (mNumAttributes == mAttributes.size()) mAttributes.emplace_back();
+				Attribute& attribute = mAttributes[mNumAttributes++];
+				readName(attribute.name);
+				skipSpace();
+				expect('=');
+				skipSpace();
+				int quote = get();
+				if (quote != '"' && quote != '\'') throw std::runtime_error("Malformed XML: unquoted attribute value.");
+				attribute.value.clear();
+				for (c = get(); c != quote; c = get())
+				{
+					if (c == EOF) throw std::runtime_error("Unexpected end of file.");
+					if (c == '&') readEntity(attribute.value);
+					else attribute.value.push_back((char)c);
+				}
+			}
+		}
+
+		void readEntity(std::string& out)
+		{
+			char entity[12];
+			size_t length = 0;
+			for (int c = get(); c != ';'; c = get())
+			{
+				if (c == EOF || length == sizeof(entity) - 1) throw std::runtime_error("Malformed XML entity.");
+				entity[length++] = (char)c;
+			}
+			entity[length] = '\0';
+
+			if (std::strcmp(entity, "amp") == 0) out.push_back('&');
+			else if (std::strcmp(entity, "lt") == 0) out.push_back('<');
+			else if (std::strcmp(entity, "gt") == 0) out.push_back('>');
+			else if (std::strcmp(entity, "quot") == 0) out.push_back('"');
+			else if (std::strcmp(entity, "apos") == 0) out.push_back('\'');
+			else if (entity[0] == '#')
+			{
+				unsigned long code = entity[1] == 'x' ? std::strtoul(entity + 2, nullptr, 16) : std::strtoul(entity + 1, nullptr, 10);
+				// UTF-8 encode
+				if (code < 0x80) out.push_back((char)code);
+				else if (code < 0x800) { out.push_back((char)(0xc0 | (code >> 6))); out.push_back((char)(0x80 | (code & 0x3f))); }
+				else if (code < 0x10000) { out.push_back((char)(0xe0 | (code >> 12))); out.push_back((char)(0x80 | ((code >> 6) & 0x3f))); out.push_back((char)(0x80 | (code & 0x3f))); }
+				else { out.push_back((char)(0xf0 | (code >> 18))); out.push_back((char)(0x80 | ((code >> 12) & 0x3f))); out.push_back((char)(0x80 | ((code >> 6) & 0x3f))); out.push_back((char)(0x80 | (code & 0x3f))); }
+			}
+			else throw std::runtime_error(std::string("Unknown XML entity &") + entity + ";.");
+		}
+
+		std::ifstream mFile;
+		std::vector<char> mBuffer;
+		size_t mPos;
+		size_t mEnd;
+
+		std::string mName;
+		std::vector<Attribute> mAttributes;
+		size_t mNumAttributes;
+		std::vector<std::string> mOpenElements;
+		bool mbPendingEnd;
+
+		const char* mpText;
+		size_t mTextLength;
+		bool mbInCData;
+		// Closing brackets read inside CDATA and not yet handed out
+		int mNumCDataBrackets;
+	};
+
+	class TMXReader::Handler
+	{
+	public:
+		Handler(XmlStream& stream, TMX& tmx)
+			: mStream(stream)
+			, mTMX(tmx)
+			, mElements()
+			, mEncoding(NONE)
+			, mbCompressed(false)
+			, mbZlib(false)
+			, mbMapRead(false)
+			, mbImageRead(false)
+			, mTileId(0)
+			, mDataCount(0)
+			, mDataPos(0)
+			, mGid(0)
+			, mbInGid(false)
+			, mBase64Buffer(0)
+			, mBase64Bits(0)
+			, mbBase64Done(false)
+			, mCompressed()
+		{}
+
+		void run()
+		{
+			for (XmlStream::Event event = mStream.next(); event != XmlStream::DONE; event = mStream.next())
+			{
+				switch (event)
+				{
+				case XmlStream::START: startElement(); break;
+				case XmlStream::END: endElement(); break;
+				case XmlStream::TEXT: text(mStream.getText(), mStream.getTextLength()); break;
+				default: break;
+				}
+			}
+			if (!mbMapRead)
+			{
+				throw std::runtime_error("Missing element 'map' in TMX file.");
+			}
+		}
+
+	private:
+		enum Element { MAP, TILESET, IMAGE, TILE, TILE_OBJECTGROUP, OBJECTGROUP, OBJECT, POLYGON, LAYER, DATA, DATA_TILE, OTHER };
+		enum Encoding { NONE, XML, CSV, BASE64 };
+
+		// Bytes per GID in base64 layer data
+		static const size_t GID_SIZE = 4;
+
+		const std::string* find(const char* name) const
+		{
+			for (size_t i = 0; i < mStream.getNumAttributes(); ++i)
+			{
+				const XmlStream::Attribute& attribute = mStream.getAttribute(i);
+				if (attribute.name == name) return &attribute.value;
+			}
+			return nullptr;
+		}
+
+		std::runtime_error makeError(const char* what, const char* name) const
+		{
+			return std::runtime_error(std::string(what) + " '" + name + "' on <" + mStream.getName() + ">.");
+		}
+
+		const std::string& getString(const char* name) const
+		{
+			const std::string* pValue = find(name);
+			if (pValue == nullptr) throw makeError("Missing attribute", name);
+			return *pValue;
+		}
+
+		std::string getString(const char* name, const char* fallback) const
+		{
+			const std::string* pValue = find(name);
+			return pValue != nullptr ? *pValue : fallback;
+		}
+
+		template <class T>
+		T parseNumber(const char* name, const std::string& value, bool (*parse)(const char*&, const char*, T&)) const
+		{
+			const char* p = value.data();
+			const char* pEnd = p + value.size();
+			T result;
+			if (!parse(p, pEnd, result) || p != pEnd) throw makeError("Malformed number in attribute", name);
+			return result;
+		}
+
+		int getInt(const char* name) const
+		{
+			return parseNumber<int>(name, getString(name), parseInt);
+		}
+
+		int getInt(const char* name, int fallback) const
+		{
+			const std::string* pValue = find(name);
+			return pValue != nullptr ? parseNumber<int>(name, *pValue, parseInt) : fallback;
+		}
+
+		// Object geometry may be fractional; it is truncated as the rest of the map is in whole pixels
+		int getCoordinate(const char* name, int fallback) const
+		{
+			const std::string* pValue = find(name);
+			if (pValue == nullptr)
+			{
+				if (fallback < 0) throw makeError("Missing attribute", name);
+				return fallback;
+			}
+			return (int)parseNumber<float>(name, *pValue, parseFloat);
+		}
+
+		Element getParent() const
+		{
+			return mElements.empty() ? OTHER : mElements.back();
+		}
+
+		void startElement()
+		{
+			const std::string& name = mStream.getName();
+			const Element parent = getParent();
+			Element element = OTHER;
+
+			if (mStream.getDepth() == 1)
+			{
+				if (name != "map") throw std::runtime_error("Missing element 'map' in TMX file.");
+				mTMX.mWidth = getInt("width");
+				mTMX.mHeight = getInt("height");
+				mTMX.mTilewidth = getInt("tilewidth");
+				mTMX.mTileheight = getInt("tileheight");
+				mbMapRead = true;
+				element = MAP;
+			}
+			else if (parent == MAP && name == "tileset")
+			{
+				TMX::Tileset tileset;
+				tileset.firstgid = getInt("firstgid");
+				tileset.name = getString("name");
+				tileset.tilewidth = getInt("tilewidth");
+				tileset.tileheight = getInt("tileheight");
+				tileset.tilecount = getInt("tilecount", 0);
+				mTMX.mTilesets.push_back(std::move(tileset));
+				mbImageRead = false;
+				element = TILESET;
+			}
+			else if (parent == TILESET && name == "image")
+			{
+				TMX::Image& image = mTMX.mTilesets.back().image;
+				image.source = getString("source");
+				image.width = getInt("width");
+				image.height = getInt("height");
+				mbImageRead = true;
+				element = IMAGE;
+			}
+			else if (parent == TILESET && name == "tile")
+			{
+				mTileId = getInt("id");
+				element = TILE;
+			}
+			else if (parent == TILE && name == "objectgroup")
+			{
+				mTMX.mTilesets.back().tiles.push_back({ mTileId, TMX::ObjectGroup{ "", getString("draworder", ""), {} } });
+				element = TILE_OBJECTGROUP;
+			}
+			else if (parent == MAP && name == "objectgroup")
+			{
+				mTMX.mObjectGroups.push_back({ getString("name"), "", {} });
+				element = OBJECTGROUP;
+			}
+			else if ((parent == TILE_OBJECTGROUP || parent == OBJECTGROUP) && name == "object")
+			{
+				TMX::ObjectGroup& group = parent == OBJECTGROUP ? mTMX.mObjectGroups.back() : mTMX.mTilesets.back().tiles.back().objectgroup;
+				group.objects.push_back({
+					getInt("id"),
+					parent == OBJECTGROUP ? getString("name", "") : "",
+					getCoordinate("x", -1),
+					getCoordinate("y", -1),
+					getCoordinate("width", 0),
+					getCoordinate("height", 0),
+					{}
+				});
+				element = OBJECT;
+			}
+			else if (parent == OBJECT && (name == "polygon" || name == "polyline"))
+			{
+				const Element groupElement = mElements[mElements.size() - 2];
+				TMX::ObjectGroup& group = groupElement == OBJECTGROUP ? mTMX.mObjectGroups.back() : mTMX.mTilesets.back().tiles.back().objectgroup;
+				const std::string& points = getString("points");
+				TMX::Polygon polygon;
+				polygon.closed = name == "polygon";
+				if (!parsePoints(points.data(), points.data() + points.size(), polygon.points))
+				{
+					throw makeError("Malformed points in attribute", "points");
+				}
+				group.objects.back().polygons.push_back(std::move(polygon));
+				element = POLYGON;
+			}
+			else if (parent == MAP && name == "layer")
+			{
+				TMX::Layer layer;
+				layer.name = getString("name");
+				layer.width = getInt("width");
+				layer.height = getInt("height");
+				mTMX.mLayers.push_back(std::move(layer));
+				mEncoding = NONE;
+				element = LAYER;
+			}
+			else if (parent == LAYER && name == "data")
+			{
+				startData();
+				element = DATA;
+			}
+			else if (parent == DATA && name == "tile" && mEncoding == XML)
+			{
+				TMX::Data& data = mTMX.mLayers.back().data;
+				if (data.tiles.size() == mDataCount) throw std::runtime_error("XML layer data does not match layer size.");
+				const std::string* pGid = find("gid");
+				unsigned long gid = 0;
+				if (pGid != nullptr)
+				{
+					for (char c : *pGid)
+					{
+						if (c < '0' || c > '9' || !accumulateGid(gid, c)) throw makeError("Malformed number in attribute", "gid");
+					}
+				}
+				data.tiles.push_back(TMX::packTile((unsigned int)gid));
+				element = DATA_TILE;
+			}
+
+			mElements.push_back(element);
+		}
+
+		void endElement()
+		{
+			const Element element = mElements.back();
+			mElements.pop_back();
+
+			if (element == TILESET && !mbImageRead)
+			{
+				throw std::runtime_error("Missing element 'image' on <tileset>.");
+			}
+			if (element == LAYER && mEncoding == NONE)
+			{
+				throw std::runtime_error("Missing element 'data' on <layer>.");
+			}
+			if (element == DATA)
+			{
+				finishData();
+			}
+		}
+
+		void startData()
+		{
+			TMX::Layer& layer = mTMX.mLayers.back();
+			mDataCount = (size_t)layer.width * layer.height;
+			mDataPos = 0;
+
+			const std::string* pEncoding = find("encoding");
+			const std::string compression = getString("compression", "");
+			if (pEncoding == nullptr)
+			{
+				mEncoding = XML;
+				layer.data.tiles.reserve(mDataCount);
+				return;
+			}
+
+			mGid = 0;
+			if (*pEncoding == "csv")
+			{
+				mEncoding = CSV;
+				mbInGid = false;
+			}
+			else if (*pEncoding == "base64")
+			{
+				mEncoding = BASE64;
+				mBase64Buffer = 0;
+				mBase64Bits = 0;
+				mbBase64Done = false;
+			}
+			else
+			{
+				throw std::runtime_error("Unsupported layer encoding: " + *pEncoding);
+			}
+
+			mbCompressed = !compression.empty();
+			if (mbCompressed)
+			{
+				if (mEncoding != BASE64 || (compression != "zlib" && compression != "gzip"))
+				{
+					throw std::runtime_error("Unsupported layer compression: " + compression);
+				}
+				mbZlib = compression == "zlib";
+				mCompressed.clear();
+			}
+			layer.data.tiles.resize(mDataCount);
+		}
+
+		void text(const char* pText, size_t length)
+		{
+			if (getParent() != DATA) return;
+
+			if (mEncoding == CSV)
+			{
+				std::vector<TMX::Tile>& tiles = mTMX.mLayers.back().data.tiles;
+				for (const char* p = pText; p != pText + length; ++p)
+				{
+					char c = *p;
+					if (c >= '0' && c <= '9')
+					{
+						if (!accumulateGid(mGid, c)) throw std::runtime_error("Malformed CSV layer data.");
+						mbInGid = true;
+					}
+					else if (c == ',' || c == ' ' || c == '\t' || c == '\n' || c == '\r')
+					{
+						if (mbInGid) pushCSVGid(tiles);
+					}
+					else
+					{
+						throw std::runtime_error("Malformed CSV layer data.");
+					}
+				}
+			}
+			else if (mEncoding == BASE64)
+			{
+				decodeBase64(pText, length);
+			}
+		}
+
+		// Appends a decimal digit to gid; false if it no longer fits in 32 bits
+		static bool accumulateGid(unsigned long& gid, char digit)
+		{
+			const unsigned long value = (unsigned long)(digit - '0');
+			if (gid > (0xffffffffUL - value) / 10) return false;
+			gid = gid * 10 + value;
+			return true;
+		}
+
+		void pushCSVGid(std::vector<TMX::Tile>& tiles)
+		{
+			if (mDataPos == mDataCount) throw std::runtime_error("CSV layer data does not match layer size.");
+			tiles[mDataPos++] = TMX::packTile((unsigned int)mGid);
+			mGid = 0;
+			mbInGid = false;
+		}
+
+		void decodeBase64(const char* pText, size_t length)
+		{
+			static const struct Table {
+				signed char values[256];
+				Table() {
+					std::fill(std::begin(values), std::end(values), (signed char)-1);
+					const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+					for (int i = 0; i < 64; ++i) values[(unsigned char)alphabet[i]] = (signed char)i;
+				}
+			} table;
+
+			for (const char* p = pText; p != pText + length; ++p)
+			{
+				if (*p == '=') mbBase64Done = true;
+				signed char value = table.values[(unsigned char)*p];
+				if (value < 0)
+				{
+					if (*p == '=' || *p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') continue;
+					throw std::runtime_error("Invalid character in base64 layer data.");
+				}
+				if (mbBase64Done) throw std::runtime_error("Invalid character in base64 layer data.");
+
+				mBase64Buffer = (mBase64Buffer << 6) | (unsigned int)value;
+				mBase64Bits += 6;
+				if (mBase64Bits >= 8)
+				{
+					mBase64Bits -= 8;
+					unsigned char byte = (unsigned char)(mBase64Buffer >> mBase64Bits);
+					if (mbCompressed)
+					{
+						mCompressed.push_back(byte);
+					}
+					else
+					{
+						pushGidByte(byte);
+					}
+				}
+			}
+		}
+
+		// Assembles the little-endian GIDs of base64 layer data a byte at a time
+		void pushGidByte(unsigned char byte)
+		{
+			if (mDataPos == mDataCount * GID_SIZE) throw std::runtime_error("Base64 layer data is larger than the layer.");
+			mGid |= (unsigned long)byte << (8 * (mDataPos % GID_SIZE));
+			if (++mDataPos % GID_SIZE == 0)
+			{
+				mTMX.mLayers.back().data.tiles[mDataPos / GID_SIZE - 1] = TMX::packTile((unsigned int)mGid);
+				mGid = 0;
+			}
+		}
+
+		void finishData()
+		{
+			std::vector<TMX::Tile>& tiles = mTMX.mLayers.back().data.tiles;
+			if (mEncoding == XML)
+			{
+				if (tiles.size() != mDataCount) throw std::runtime_error("XML layer data does not match layer size.");
+				return;
+			}
+			if (mEncoding == CSV)
+			{
+				if (mbInGid) pushCSVGid(tiles);
+				if (mDataPos != mDataCount) throw std::runtime_error("CSV layer data does not match layer size.");
+				return;
+			}
+
+			const size_t byteCount = mDataCount * GID_SIZE;
+			if (!mbCompressed)
+			{
+				if (mDataPos != byteCount)
+				{
+					throw std::runtime_error("Base64 layer data does not match layer size.");
+				}
+				return;
+			}
+
+			// Packed as it is inflated, so the layer is never held four bytes a tile
+			auto sink = [this](const unsigned char* pData, size_t length) {
+				for (size_t i = 0; i < length; ++i) pushGidByte(pData[i]);
+			};
+			const size_t inflated = mbZlib
+				? inflateZlib(mCompressed.data(), mCompressed.size(), byteCount, sink)
+				: inflateGzip(mCompressed.data(), mCompressed.size(), byteCount, sink);
+			std::vector<unsigned char>().swap(mCompressed);
+			if (inflated != byteCount)
+			{
+				throw std::runtime_error("Base64 layer data does not match layer size.");
+			}
+		}
+
+		XmlStream& mStream;
+		TMX& mTMX;
+		std::vector<Element> mElements;
+
+		Encoding mEncoding;
+		bool mbCompressed;
+		bool mbZlib;
+		bool mbMapRead;
+		bool mbImageRead;
+		int mTileId;
+		size_t mDataCount;
+		size_t mDataPos;
+
+		unsigned long mGid;
+		bool mbInGid;
+
+		unsigned int mBase64Buffer;
+		int mBase64Bits;
+		bool mbBase64Done;
+		std::vector<unsigned char> mCompressed;
+	};
+
+	void TMXReader::read(const std::string& filename, TMX& tmx)
+	{
+		XmlStream stream(filename);
+		Handler handler(stream, tmx);
+		handler.run();
+	}
+}
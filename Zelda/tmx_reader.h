@@ -0,0 +1,26 @@
+#ifndef TE_TMX_READER_H
+#define TE_TMX_READER_H
+
+#include <string>
+
+namespace te
+{
+	class TMX;
+
+	// Reads a TMX file in a single forward pass through a fixed-size buffer,
+	// without building a document tree. Layer data is decoded as it streams
+	// in, straight into the final tile grid, so peak memory stays close to
+	// the parsed map (plus the compressed bytes of a zlib/gzip layer).
+	class TMXReader
+	{
+	public:
+		static void read(const std::string& filename, TMX& tmx);
+
+	private:
+		class Handler;
+
+		TMXReader() = delete;
+	};
+}
+
+#endif
@@ -1,5 +1,6 @@
 #include "wall.h"
 #include "vector_ops.h"
+#include <algorithm>
 #include <cmath>
 
 namespace te
@@ -30,4 +31,35 @@ namespace te
 		float radiusSq = radius * radius;
 		return distanceSq(position, mFrom) <= radiusSq || distanceSq(position, mTo) <= radiusSq;
 	}
+
+	// Squared distance from the point to the segment starting at from along dir
+	static float distanceToSegmentSq(sf::Vector2f point, sf::Vector2f from, sf::Vector2f dir)
+	{
+		const float lenSq = lengthSq(dir);
+		const sf::Vector2f toPoint = point - from;
+		const float t = lenSq > 0 ? std::max(0.f, std::min((toPoint.x * dir.x + toPoint.y * dir.y) / lenSq, 1.f)) : 0.f;
+		return lengthSq(toPoint - dir * t);
+	}
+
+	static float cross(sf::Vector2f a, sf::Vector2f b)
+	{
+		return a.x * b.y - a.y * b.x;
+	}
+
+	bool Wall2f::intersects(sf::Vector2f from, sf::Vector2f to, float radius) const
+	{
+		const sf::Vector2f wallDir = mTo - mFrom;
+		const sf::Vector2f sweepDir = to - from;
+		if (cross(wallDir, from - mFrom) * cross(wallDir, to - mFrom) < 0 &&
+			cross(sweepDir, mFrom - from) * cross(sweepDir, mTo - from) < 0)
+		{
+			return true;
+		}
+
+		const float radiusSq = radius * radius;
+		return distanceToSegmentSq(from, mFrom, wallDir) < radiusSq ||
+			distanceToSegmentSq(to, mFrom, wallDir) < radiusSq ||
+			distanceToSegmentSq(mFrom, from, sweepDir) < radiusSq ||
+			distanceToSegmentSq(mTo, from, sweepDir) < radiusSq;
+	}
 }
@@ -15,6 +15,9 @@ namespace te
 		sf::Vector2f getNormal() const;
 
 		bool intersects(sf::Vector2f position, float radius) const;
+		// True when a circle of radius swept from one point to the other
+		// crosses the wall or comes closer to it than radius
+		bool intersects(sf::Vector2f from, sf::Vector2f to, float radius) const;
 	private:
 		sf::Vector2f mFrom;
 		sf::Vector2f mTo;
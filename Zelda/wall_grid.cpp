@@ -0,0 +1,455 @@
+#include "wall_grid.h"
+#include "parallel.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_set>
+
+namespace te
+{
+	namespace
+	{
+		// A sweep unpacked for the wall tests
+		struct SweepData
+		{
+			float ax, ay;
+			float bx, by;
+			float ex, ey;
+			float invLengthSq;
+			float radiusSq;
+		};
+
+		SweepData unpack(const WallGrid::Sweep& sweep)
+		{
+			SweepData s;
+			s.ax = sweep.from.x;
+			s.ay = sweep.from.y;
+			s.bx = sweep.to.x;
+			s.by = sweep.to.y;
+			s.ex = s.bx - s.ax;
+			s.ey = s.by - s.ay;
+			const float lengthSq = s.ex * s.ex + s.ey * s.ey;
+			s.invLengthSq = lengthSq > 0 ? 1 / lengthSq : 0;
+			s.radiusSq = sweep.radius * sweep.radius;
+			return s;
+		}
+
+#ifdef TE_SSE
+		struct SweepLanes
+		{
+			__m128 ax, ay;
+			__m128 bx, by;
+			__m128 ex, ey;
+			__m128 invLengthSq;
+			__m128 radiusSq;
+		};
+
+		SweepLanes broadcast(const SweepData& s)
+		{
+			return { _mm_set1_ps(s.ax), _mm_set1_ps(s.ay), _mm_set1_ps(s.bx), _mm_set1_ps(s.by),
+				_mm_set1_ps(s.ex), _mm_set1_ps(s.ey), _mm_set1_ps(s.invLengthSq), _mm_set1_ps(s.radiusSq) };
+		}
+
+		// Squared distance from (px, py) to the segment from (fx, fy) along (dx, dy)
+		inline __m128 distanceToSegmentSq(__m128 px, __m128 py, __m128 fx, __m128 fy, __m128 dx, __m128 dy, __m128 invLengthSq)
+		{
+			const __m128 wx = _mm_sub_ps(px, fx);
+			const __m128 wy = _mm_sub_ps(py, fy);
+			__m128 t = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(wx, dx), _mm_mul_ps(wy, dy)), invLengthSq);
+			t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), _mm_set1_ps(1));
+			const __m128 cx = _mm_sub_ps(wx, _mm_mul_ps(t, dx));
+			const __m128 cy = _mm_sub_ps(wy, _mm_mul_ps(t, dy));
+			return _mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy));
+		}
+
+		inline __m128 cross(__m128 ax, __m128 ay, __m128 bx, __m128 by)
+		{
+			return _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx));
+		}
+
+		// Four walls at a time, lanes that hit are set
+		inline int hitMask(const SweepLanes& s, __m128 fx, __m128 fy, __m128 dx, __m128 dy, __m128 invLengthSq)
+		{
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 tx = _mm_add_ps(fx, dx);
+			const __m128 ty = _mm_add_ps(fy, dy);
+
+			const __m128 o1 = cross(dx, dy, _mm_sub_ps(s.ax, fx), _mm_sub_ps(s.ay, fy));
+			const __m128 o2 = cross(dx, dy, _mm_sub_ps(s.bx, fx), _mm_sub_ps(s.by, fy));
+			const __m128 o3 = cross(s.ex, s.ey, _mm_sub_ps(fx, s.ax), _mm_sub_ps(fy, s.ay));
+			const __m128 o4 = cross(s.ex, s.ey, _mm_sub_ps(tx, s.ax), _mm_sub_ps(ty, s.ay));
+			const __m128 crosses = _mm_and_ps(_mm_cmplt_ps(_mm_mul_ps(o1, o2), zero), _mm_cmplt_ps(_mm_mul_ps(o3, o4), zero));
+
+			__m128 nearest = distanceToSegmentSq(s.ax, s.ay, fx, fy, dx, dy, invLengthSq);
+			nearest = _mm_min_ps(nearest, distanceToSegmentSq(s.bx, s.by, fx, fy, dx, dy, invLengthSq));
+			nearest = _mm_min_ps(nearest, distanceToSegmentSq(fx, fy, s.ax, s.ay, s.ex, s.ey, s.invLengthSq));
+			nearest = _mm_min_ps(nearest, distanceToSegmentSq(tx, ty, s.ax, s.ay, s.ex, s.ey, s.invLengthSq));
+
+			return _mm_movemask_ps(_mm_or_ps(crosses, _mm_cmplt_ps(nearest, s.radiusSq)));
+		}
+#else
+		inline float distanceToSegmentSq(float px, float py, float fx, float fy, float dx, float dy, float invLengthSq)
+		{
+			const float wx = px - fx, wy = py - fy;
+			const float t = std::max(0.f, std::min((wx * dx + wy * dy) * invLengthSq, 1.f));
+			const float cx = wx - t * dx, cy = wy - t * dy;
+			return cx * cx + cy * cy;
+		}
+
+		inline bool hits(const SweepData& s, float fx, float fy, float dx, float dy, float invLengthSq)
+		{
+			const float tx = fx + dx, ty = fy + dy;
+			const float o1 = dx * (s.ay - fy) - dy * (s.ax - fx);
+			const float o2 = dx * (s.by - fy) - dy * (s.bx - fx);
+			const float o3 = s.ex * (fy - s.ay) - s.ey * (fx - s.ax);
+			const float o4 = s.ex * (ty - s.ay) - s.ey * (tx - s.ax);
+			if (o1 * o2 < 0 && o3 * o4 < 0) return true;
+
+			return distanceToSegmentSq(s.ax, s.ay, fx, fy, dx, dy, invLengthSq) < s.radiusSq ||
+				distanceToSegmentSq(s.bx, s.by, fx, fy, dx, dy, invLengthSq) < s.radiusSq ||
+				distanceToSegmentSq(fx, fy, s.ax, s.ay, s.ex, s.ey, s.invLengthSq) < s.radiusSq ||
+				distanceToSegmentSq(tx, ty, s.ax, s.ay, s.ex, s.ey, s.invLengthSq) < s.radiusSq;
+		}
+#endif
+	}
+
+	WallGrid::WallGrid(const sf::FloatRect& bounds, int cellsX, int cellsY)
+		: mBounds(bounds)
+		, mNumCellsX(std::max(cellsX, 1))
+		, mNumCellsY(std::max(cellsY, 1))
+		, mCellSizeX(bounds.width / std::max(cellsX, 1))
+		, mCellSizeY(bounds.height / std::max(cellsY, 1))
+		, mRows(mNumCellsY)
+		, mWalls()
+		, mFreeWalls()
+	{
+		for (auto& row : mRows)
+		{
+			row.offsets.assign(mNumCellsX + 1, 0);
+		}
+	}
+
+	template <class Fn>
+	void WallGrid::forEachCell(const Wall2f& wall, Fn fn) const
+	{
+		const sf::Vector2f from = wall.getFrom(), to = wall.getTo();
+		int x = cellX(from.x), y = cellY(from.y);
+		const int endX = cellX(to.x), endY = cellY(to.y);
+
+		// Walls reaching past the grid were clamped into the outer cells, which
+		// their bounding box covers
+		if (!mBounds.contains(from) || !mBounds.contains(to))
+		{
+			for (int cy = std::min(y, endY); cy <= std::max(y, endY); ++cy)
+			{
+				for (int cx = std::min(x, endX); cx <= std::max(x, endX); ++cx)
+				{
+					fn(cx, cy);
+				}
+			}
+			return;
+		}
+
+		// Steps to whichever cell boundary the segment crosses first, or both
+		// when they are too close to tell apart. A step is only taken towards
+		// the end cell, so rounding cannot carry it past.
+		const float TIE = 1e-4f;
+		const sf::Vector2f dir = to - from;
+		const int stepX = endX > x ? 1 : -1, stepY = endY > y ? 1 : -1;
+		const float deltaX = dir.x != 0 ? mCellSizeX / std::abs(dir.x) : INFINITY;
+		const float deltaY = dir.y != 0 ? mCellSizeY / std::abs(dir.y) : INFINITY;
+		float nextX = dir.x != 0 ? (mBounds.left + (x + (stepX > 0 ? 1 : 0)) * mCellSizeX - from.x) / dir.x : INFINITY;
+		float nextY = dir.y != 0 ? (mBounds.top + (y + (stepY > 0 ? 1 : 0)) * mCellSizeY - from.y) / dir.y : INFINITY;
+
+		fn(x, y);
+		while (x != endX || y != endY)
+		{
+			const bool stepsX = y == endY || (x != endX && nextX <= nextY + TIE);
+			const bool stepsY = x == endX || (y != endY && nextY <= nextX + TIE);
+			if (stepsX && stepsY)
+			{
+				// Through or near a corner, so either neighbour may hold part of it
+				fn(x + stepX, y);
+				fn(x, y + stepY);
+			}
+			if (stepsX)
+			{
+				x += stepX;
+				nextX += deltaX;
+			}
+			if (stepsY)
+			{
+				y += stepY;
+				nextY += deltaY;
+			}
+			fn(x, y);
+		}
+	}
+
+	void WallGrid::build(const std::vector<Wall2f>& walls)
+	{
+		mWalls = walls;
+		mFreeWalls.clear();
+
+		// Count, then fill each cell's range
+		for (auto& row : mRows)
+		{
+			std::fill(row.offsets.begin(), row.offsets.end(), 0);
+		}
+		for (auto& wall : walls)
+		{
+			forEachCell(wall, [this](int x, int y) { ++mRows[y].offsets[x + 1]; });
+		}
+
+		std::vector<std::vector<int>> next(mNumCellsY);
+		for (int y = 0; y < mNumCellsY; ++y)
+		{
+			Row& row = mRows[y];
+			for (size_t x = 1; x < row.offsets.size(); ++x)
+			{
+				row.offsets[x] += row.offsets[x - 1];
+			}
+			row.walls.resize(row.offsets.back());
+			next[y].assign(row.offsets.begin(), row.offsets.end() - 1);
+		}
+		for (int i = 0; i < (int)walls.size(); ++i)
+		{
+			forEachCell(walls[i], [this, &next, i](int x, int y) { mRows[y].walls[next[y][x]++] = i; });
+		}
+
+		for (auto& row : mRows)
+		{
+			fillRow(row);
+		}
+	}
+
+	void WallGrid::update(const std::vector<Wall2f>& removed, const std::vector<Wall2f>& added)
+	{
+		auto less = [](const Wall2f& a, const Wall2f& b) {
+			const sf::Vector2f aFrom = a.getFrom(), aTo = a.getTo(), bFrom = b.getFrom(), bTo = b.getTo();
+			return std::tie(aFrom.x, aFrom.y, aTo.x, aTo.y) < std::tie(bFrom.x, bFrom.y, bTo.x, bTo.y);
+		};
+
+		// A wall both removed and added stays as it is
+		std::vector<Wall2f> sortedRemoved(removed), sortedAdded(added);
+		std::sort(sortedRemoved.begin(), sortedRemoved.end(), less);
+		std::sort(sortedAdded.begin(), sortedAdded.end(), less);
+		std::vector<Wall2f> toRemove, toAdd;
+		std::set_difference(sortedRemoved.begin(), sortedRemoved.end(), sortedAdded.begin(), sortedAdded.end(), std::back_inserter(toRemove), less);
+		std::set_difference(sortedAdded.begin(), sortedAdded.end(), sortedRemoved.begin(), sortedRemoved.end(), std::back_inserter(toAdd), less);
+
+		// Ids leaving and entering each cell, as (y, x, id)
+		std::vector<std::tuple<int, int, int>> removedEntries, addedEntries;
+		std::unordered_set<int> removedIds;
+		for (auto& wall : toRemove)
+		{
+			// Every wall is listed in the cell its start is in
+			const Row& row = mRows[cellY(wall.getFrom().y)];
+			const int x = cellX(wall.getFrom().x);
+			auto found = std::find_if(row.walls.begin() + row.offsets[x], row.walls.begin() + row.offsets[x + 1], [this, &wall, &less, &removedIds](int id) {
+				return !less(mWalls[id], wall) && !less(wall, mWalls[id]) && removedIds.count(id) == 0;
+			});
+			if (found == row.walls.begin() + row.offsets[x + 1])
+			{
+				throw std::runtime_error("Removed wall is not in the wall grid.");
+			}
+			const int id = *found;
+			removedIds.insert(id);
+			mFreeWalls.push_back(id);
+			forEachCell(wall, [&removedEntries, id](int cx, int cy) { removedEntries.emplace_back(cy, cx, id); });
+		}
+		for (auto& wall : toAdd)
+		{
+			int id;
+			if (!mFreeWalls.empty())
+			{
+				id = mFreeWalls.back();
+				mFreeWalls.pop_back();
+				mWalls[id] = wall;
+			}
+			else
+			{
+				id = (int)mWalls.size();
+				mWalls.push_back(wall);
+			}
+			forEachCell(wall, [&addedEntries, id](int cx, int cy) { addedEntries.emplace_back(cy, cx, id); });
+		}
+		std::sort(removedEntries.begin(), removedEntries.end());
+		std::sort(addedEntries.begin(), addedEntries.end());
+
+		// Each row touched is rewritten cell by cell, dropping the ids leaving
+		// a cell and appending those entering it
+		auto removedIter = removedEntries.begin(), addedIter = addedEntries.begin();
+		std::vector<int> offsets, walls;
+		while (removedIter != removedEntries.end() || addedIter != addedEntries.end())
+		{
+			const int y = std::min(removedIter != removedEntries.end() ? std::get<0>(*removedIter) : mNumCellsY,
+				addedIter != addedEntries.end() ? std::get<0>(*addedIter) : mNumCellsY);
+			Row& row = mRows[y];
+			offsets.assign(1, 0);
+			walls.clear();
+			for (int x = 0; x < mNumCellsX; ++x)
+			{
+				const auto removedBegin = removedIter;
+				while (removedIter != removedEntries.end() && std::get<0>(*removedIter) == y && std::get<1>(*removedIter) == x)
+				{
+					++removedIter;
+				}
+				for (int i = row.offsets[x]; i < row.offsets[x + 1]; ++i)
+				{
+					const int id = row.walls[i];
+					if (std::none_of(removedBegin, removedIter, [id](const std::tuple<int, int, int>& entry) { return std::get<2>(entry) == id; }))
+					{
+						walls.push_back(id);
+					}
+				}
+				while (addedIter != addedEntries.end() && std::get<0>(*addedIter) == y && std::get<1>(*addedIter) == x)
+				{
+					walls.push_back(std::get<2>(*addedIter++));
+				}
+				offsets.push_back((int)walls.size());
+			}
+			row.offsets.swap(offsets);
+			row.walls.swap(walls);
+			fillRow(row);
+		}
+	}
+
+	void WallGrid::fillRow(Row& row) const
+	{
+		const size_t numEntries = row.walls.size();
+		row.fromX.resize(numEntries);
+		row.fromY.resize(numEntries);
+		row.dirX.resize(numEntries);
+		row.dirY.resize(numEntries);
+		row.invLengthSq.resize(numEntries);
+		for (size_t i = 0; i < numEntries; ++i)
+		{
+			const Wall2f& wall = mWalls[row.walls[i]];
+			const sf::Vector2f dir = wall.getTo() - wall.getFrom();
+			const float lengthSq = dir.x * dir.x + dir.y * dir.y;
+			row.fromX[i] = wall.getFrom().x;
+			row.fromY[i] = wall.getFrom().y;
+			row.dirX[i] = dir.x;
+			row.dirY[i] = dir.y;
+			row.invLengthSq[i] = lengthSq > 0 ? 1 / lengthSq : 0;
+		}
+	}
+
+	const Wall2f& WallGrid::getWall(int id) const
+	{
+		return mWalls[id];
+	}
+
+	template <class Fn>
+	bool WallGrid::forEachSpan(sf::Vector2f a, sf::Vector2f b, float radius, Fn fn) const
+	{
+		// Each row of cells is visited over the span of the segment, widened by
+		// the radius, that passes through the row
+		const int top = cellY(std::min(a.y, b.y) - radius);
+		const int bottom = cellY(std::max(a.y, b.y) + radius);
+		for (int y = top; y <= bottom; ++y)
+		{
+			// Walls past the edge of the grid were clamped into the outer cells,
+			// so the outer rows reach out indefinitely
+			const float rowTop = y == 0 ? -INFINITY : mBounds.top + y * mCellSizeY - radius;
+			const float rowBottom = y == mNumCellsY - 1 ? INFINITY : mBounds.top + (y + 1) * mCellSizeY + radius;
+
+			float t0 = 0, t1 = 1;
+			if (a.y != b.y)
+			{
+				t0 = (rowTop - a.y) / (b.y - a.y);
+				t1 = (rowBottom - a.y) / (b.y - a.y);
+				if (t0 > t1) std::swap(t0, t1);
+				t0 = std::max(t0, 0.f);
+				t1 = std::min(t1, 1.f);
+			}
+			if (t0 > t1) continue;
+
+			const float x0 = a.x + (b.x - a.x) * t0, x1 = a.x + (b.x - a.x) * t1;
+			const int left = cellX(std::min(x0, x1) - radius);
+			const int right = cellX(std::max(x0, x1) + radius);
+			const Row& row = mRows[y];
+			const int begin = row.offsets[left];
+			const int end = row.offsets[right + 1];
+			if (begin < end && fn(row, begin, end)) return true;
+		}
+		return false;
+	}
+
+	void WallGrid::query(sf::Vector2f a, sf::Vector2f b, float radius, std::vector<int>& outWalls) const
+	{
+		outWalls.clear();
+		forEachSpan(a, b, radius, [&outWalls](const Row& row, int begin, int end) {
+			outWalls.insert(outWalls.end(), row.walls.begin() + begin, row.walls.begin() + end);
+			return false;
+		});
+		std::sort(outWalls.begin(), outWalls.end());
+		outWalls.erase(std::unique(outWalls.begin(), outWalls.end()), outWalls.end());
+	}
+
+	bool WallGrid::isObstructed(const Sweep& sweep) const
+	{
+		const SweepData s = unpack(sweep);
+#ifdef TE_SSE
+		const SweepLanes lanes = broadcast(s);
+		return forEachSpan(sweep.from, sweep.to, sweep.radius, [&lanes](const Row& row, int begin, int end) {
+			int i = begin;
+			for (; i + 4 <= end; i += 4)
+			{
+				if (hitMask(lanes, _mm_loadu_ps(&row.fromX[i]), _mm_loadu_ps(&row.fromY[i]), _mm_loadu_ps(&row.dirX[i]), _mm_loadu_ps(&row.dirY[i]), _mm_loadu_ps(&row.invLengthSq[i])))
+					return true;
+			}
+			if (i < end)
+			{
+				// Repeat the last wall to fill the lanes
+				const int j1 = std::min(i + 1, end - 1), j2 = std::min(i + 2, end - 1), j3 = end - 1;
+				if (hitMask(lanes,
+					_mm_setr_ps(row.fromX[i], row.fromX[j1], row.fromX[j2], row.fromX[j3]),
+					_mm_setr_ps(row.fromY[i], row.fromY[j1], row.fromY[j2], row.fromY[j3]),
+					_mm_setr_ps(row.dirX[i], row.dirX[j1], row.dirX[j2], row.dirX[j3]),
+					_mm_setr_ps(row.dirY[i], row.dirY[j1], row.dirY[j2], row.dirY[j3]),
+					_mm_setr_ps(row.invLengthSq[i], row.invLengthSq[j1], row.invLengthSq[j2], row.invLengthSq[j3])))
+					return true;
+			}
+			return false;
+		});
+#else
+		return forEachSpan(sweep.from, sweep.to, sweep.radius, [&s](const Row& row, int begin, int end) {
+			for (int i = begin; i < end; ++i)
+			{
+				if (hits(s, row.fromX[i], row.fromY[i], row.dirX[i], row.dirY[i], row.invLengthSq[i]))
+					return true;
+			}
+			return false;
+		});
+#endif
+	}
+
+	void WallGrid::isObstructed(const std::vector<Sweep>& sweeps, std::vector<char>& outObstructed) const
+	{
+		outObstructed.resize(sweeps.size());
+		parallelFor(0, (int)sweeps.size(), 256, [this, &sweeps, &outObstructed](int begin, int end) {
+			for (int i = begin; i < end; ++i)
+			{
+				outObstructed[i] = isObstructed(sweeps[i]);
+			}
+		});
+	}
+
+	int WallGrid::cellX(float x) const
+	{
+		const float cell = std::floor((x - mBounds.left) / mCellSizeX);
+		return cell < 0 ? 0 : (cell >= mNumCellsX ? mNumCellsX - 1 : (int)cell);
+	}
+
+	int WallGrid::cellY(float y) const
+	{
+		const float cell = std::floor((y - mBounds.top) / mCellSizeY);
+		return cell < 0 ? 0 : (cell >= mNumCellsY ? mNumCellsY - 1 : (int)cell);
+	}
+}
@@ -0,0 +1,92 @@
+#ifndef TE_WALL_GRID_H
+#define TE_WALL_GRID_H
+
+#include "wall.h"
+
+#include <SFML/Graphics.hpp>
+
+#include <vector>
+
+namespace te
+{
+	// Uniform grid over a set of walls. A wall is listed in every cell its
+	// segment passes through, so a query only looks at the cells along the
+	// swept segment.
+	class WallGrid
+	{
+	public:
+		// A circle of radius swept from one point to the other
+		struct Sweep
+		{
+			sf::Vector2f from;
+			sf::Vector2f to;
+			float radius;
+		};
+
+		WallGrid(const sf::FloatRect& bounds, int cellsX, int cellsY);
+
+		// Replaces the walls; wall i of walls gets id i
+		void build(const std::vector<Wall2f>& walls);
+		// Takes out walls equal to those removed and puts in those added; only
+		// the rows of cells they pass through are rebuilt. Added walls reuse the
+		// ids of removed ones.
+		void update(const std::vector<Wall2f>& removed, const std::vector<Wall2f>& added);
+
+		const Wall2f& getWall(int id) const;
+
+		// Ids, each once and in ascending order, of every wall in a cell within
+		// radius of the segment a to b
+		void query(sf::Vector2f a, sf::Vector2f b, float radius, std::vector<int>& outWalls) const;
+
+		// Exact: true when the sweep crosses a wall or comes closer to one
+		// than its radius, as Wall2f::intersects
+		bool isObstructed(const Sweep& sweep) const;
+		// Resizes outObstructed to one flag per sweep. Large batches are split
+		// across workers.
+		void isObstructed(const std::vector<Sweep>& sweeps, std::vector<char>& outObstructed) const;
+
+	private:
+		// The walls of one row of cells, so a run of cells is a contiguous run of walls
+		struct Row
+		{
+			// Walls of cell x are walls[offsets[x]] up to walls[offsets[x + 1]]
+			std::vector<int> offsets;
+			std::vector<int> walls;
+
+			// Parallel to walls
+			std::vector<float> fromX;
+			std::vector<float> fromY;
+			std::vector<float> dirX;
+			std::vector<float> dirY;
+			// Zero for zero length walls
+			std::vector<float> invLengthSq;
+		};
+
+		int cellX(float x) const;
+		int cellY(float y) const;
+
+		// Calls fn(x, y) with each cell the wall passes through
+		template <class Fn>
+		void forEachCell(const Wall2f& wall, Fn fn) const;
+		// Calls fn(row, begin, end) with each run of entries in a row whose
+		// cells lie along the sweep, stopping early when fn returns true
+		template <class Fn>
+		bool forEachSpan(sf::Vector2f a, sf::Vector2f b, float radius, Fn fn) const;
+
+		// Fills the row's wall data from its offsets and walls
+		void fillRow(Row& row) const;
+
+		sf::FloatRect mBounds;
+		int mNumCellsX;
+		int mNumCellsY;
+		float mCellSizeX;
+		float mCellSizeY;
+
+		std::vector<Row> mRows;
+		// By id; the ids in mFreeWalls hold no wall
+		std::vector<Wall2f> mWalls;
+		std::vector<int> mFreeWalls;
+	};
+}
+
+#endif
@@ -0,0 +1,207 @@
+#include "xml_parse.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace te
+{
+	static bool isDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	static bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+
+	static std::runtime_error makeError(const XmlNode& node, const char* what, const char* name)
+	{
+		return std::runtime_error(std::string(what) + " '" + name + "' on <" + std::string(node.name(), node.name_size()) + ">.");
+	}
+
+	const XmlNode& getXmlChild(const XmlNode& node, const char* name)
+	{
+		const XmlNode* pChild = node.first_node(name);
+		if (pChild == nullptr)
+		{
+			throw makeError(node, "Missing element", name);
+		}
+		return *pChild;
+	}
+
+	const XmlAttribute* findXmlAttribute(const XmlNode& node, const char* name)
+	{
+		const size_t nameSize = std::strlen(name);
+		for (const XmlAttribute* pAttribute = node.first_attribute(); pAttribute != nullptr; pAttribute = pAttribute->next_attribute())
+		{
+			if (pAttribute->name_size() == nameSize && std::memcmp(pAttribute->name(), name, nameSize) == 0)
+			{
+				return pAttribute;
+			}
+		}
+		return nullptr;
+	}
+
+	static const XmlAttribute& getXmlAttribute(const XmlNode& node, const char* name)
+	{
+		const XmlAttribute* pAttribute = findXmlAttribute(node, name);
+		if (pAttribute == nullptr)
+		{
+			throw makeError(node, "Missing attribute", name);
+		}
+		return *pAttribute;
+	}
+
+	template <class T>
+	static T parseXmlNumber(const XmlNode& node, const XmlAttribute& attribute, bool (*parse)(const char*&, const char*, T&))
+	{
+		const char* p = attribute.value();
+		const char* pEnd = p + attribute.value_size();
+		T value;
+		if (!parse(p, pEnd, value) || p != pEnd)
+		{
+			throw makeError(node, "Malformed number in attribute", attribute.name());
+		}
+		return value;
+	}
+
+	const char* getXmlString(const XmlNode& node, const char* name)
+	{
+		return getXmlAttribute(node, name).value();
+	}
+
+	const char* getXmlString(const XmlNode& node, const char* name, const char* fallback)
+	{
+		const XmlAttribute* pAttribute = findXmlAttribute(node, name);
+		return pAttribute != nullptr ? pAttribute->value() : fallback;
+	}
+
+	int getXmlInt(const XmlNode& node, const char* name)
+	{
+		return parseXmlNumber<int>(node, getXmlAttribute(node, name), parseInt);
+	}
+
+	int getXmlInt(const XmlNode& node, const char* name, int fallback)
+	{
+		const XmlAttribute* pAttribute = findXmlAttribute(node, name);
+		return pAttribute != nullptr ? parseXmlNumber<int>(node, *pAttribute, parseInt) : fallback;
+	}
+
+	float getXmlFloat(const XmlNode& node, const char* name)
+	{
+		return parseXmlNumber<float>(node, getXmlAttribute(node, name), parseFloat);
+	}
+
+	float getXmlFloat(const XmlNode& node, const char* name, float fallback)
+	{
+		const XmlAttribute* pAttribute = findXmlAttribute(node, name);
+		return pAttribute != nullptr ? parseXmlNumber<float>(node, *pAttribute, parseFloat) : fallback;
+	}
+
+	void getXmlPoints(const XmlNode& node, const char* name, std::vector<sf::Vector2i>& points)
+	{
+		const XmlAttribute& attribute = getXmlAttribute(node, name);
+		if (!parsePoints(attribute.value(), attribute.value() + attribute.value_size(), points))
+		{
+			throw makeError(node, "Malformed points in attribute", name);
+		}
+	}
+
+	bool parseInt(const char*& p, const char* pEnd, int& value)
+	{
+		const char* q = p;
+		bool negative = false;
+		if (q != pEnd && (*q == '-' || *q == '+'))
+		{
+			negative = *q++ == '-';
+		}
+		if (q == pEnd || !isDigit(*q))
+		{
+			return false;
+		}
+
+		long long result = 0;
+		for (; q != pEnd && isDigit(*q); ++q)
+		{
+			result = result * 10 + (*q - '0');
+			if (result > (long long)std::numeric_limits<int>::max() + 1)
+			{
+				return false;
+			}
+		}
+		if (negative) result = -result;
+		if (result > std::numeric_limits<int>::max())
+		{
+			return false;
+		}
+
+		value = (int)result;
+		p = q;
+		return true;
+	}
+
+	bool parseFloat(const char*& p, const char* pEnd, float& value)
+	{
+		const char* q = p;
+		bool negative = false;
+		if (q != pEnd && (*q == '-' || *q == '+'))
+		{
+			negative = *q++ == '-';
+		}
+
+		double result = 0;
+		int numDigits = 0;
+		for (; q != pEnd && isDigit(*q); ++q, ++numDigits)
+		{
+			result = result * 10 + (*q - '0');
+		}
+		if (q != pEnd && *q == '.')
+		{
+			double scale = 0.1;
+			for (++q; q != pEnd && isDigit(*q); ++q, ++numDigits, scale *= 0.1)
+			{
+				result += (*q - '0') * scale;
+			}
+		}
+		if (numDigits == 0)
+		{
+			return false;
+		}
+
+		if (q != pEnd && (*q == 'e' || *q == 'E'))
+		{
+			const char* pExponent = q + 1;
+			int exponent;
+			if (parseInt(pExponent, pEnd, exponent))
+			{
+				result *= std::pow(10.0, exponent);
+				q = pExponent;
+			}
+		}
+
+		value = (float)(negative ? -result : result);
+		p = q;
+		return true;
+	}
+
+	bool parsePoints(const char* p, const char* pEnd, std::vector<sf::Vector2i>& points)
+	{
+		points.clear();
+		while (true)
+		{
+			while (p != pEnd && isSpace(*p)) ++p;
+			if (p == pEnd) return true;
+
+			float x, y;
+			if (!parseFloat(p, pEnd, x) || p == pEnd || *p++ != ',' || !parseFloat(p, pEnd, y) || (p != pEnd && !isSpace(*p)))
+			{
+				return false;
+			}
+			points.push_back({ (int)x, (int)y });
+		}
+	}
+}
@@ -0,0 +1,36 @@
+#ifndef TE_XML_PARSE_H
+#define TE_XML_PARSE_H
+
+#include <SFML/System/Vector2.hpp>
+#include <rapidxml.hpp>
+
+#include <vector>
+
+namespace te
+{
+	typedef rapidxml::xml_node<char> XmlNode;
+	typedef rapidxml::xml_attribute<char> XmlAttribute;
+
+	// Reads values straight out of a document parsed in place by rapidxml.
+	// Numbers are parsed from the buffer without temporary strings, and a
+	// missing required child or attribute throws std::runtime_error naming
+	// the element instead of dereferencing null.
+	const XmlNode& getXmlChild(const XmlNode& node, const char* name);
+	const XmlAttribute* findXmlAttribute(const XmlNode& node, const char* name);
+
+	const char* getXmlString(const XmlNode& node, const char* name);
+	const char* getXmlString(const XmlNode& node, const char* name, const char* fallback);
+	int getXmlInt(const XmlNode& node, const char* name);
+	int getXmlInt(const XmlNode& node, const char* name, int fallback);
+	float getXmlFloat(const XmlNode& node, const char* name);
+	float getXmlFloat(const XmlNode& node, const char* name, float fallback);
+	// Parses a Tiled point list ("x,y x,y ..."), truncating coordinates to integers
+	void getXmlPoints(const XmlNode& node, const char* name, std::vector<sf::Vector2i>& points);
+
+	// Advance p past the number on success; leave it untouched on failure
+	bool parseInt(const char*& p, const char* pEnd, int& value);
+	bool parseFloat(const char*& p, const char* pEnd, float& value);
+	bool parsePoints(const char* p, const char* pEnd, std::vector<sf::Vector2i>& points);
+}
+
+#endif
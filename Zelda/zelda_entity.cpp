@@ -33,6 +33,11 @@ namespace te
 		return mSteering;
 	}
 
+	bool ZeldaEntity::handleMessage(const Telegram& msg)
+	{
+		return mBrain.handleMessage(msg);
+	}
+
 	void ZeldaEntity::onDraw(sf::RenderTarget& target, sf::RenderStates states) const
 	{
 		states.transform *= getWorldTransform();
@@ -20,6 +20,8 @@ namespace te
 		GoalThink& getBrain();
 		SteeringBehaviors& getSteering();
 
+		bool handleMessage(const Telegram& msg);
+
 	private:
 		void onDraw(sf::RenderTarget&, sf::RenderStates) const;
 		void onUpdate(const sf::Time& dt);
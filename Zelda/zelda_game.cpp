@@ -9,6 +9,10 @@
 
 namespace te
 {
+	const int ZeldaGame::STREAMING_THRESHOLD = 256 * 256;
+	const int ZeldaGame::STREAMING_CHUNK_SIZE = 32;
+	const int ZeldaGame::STREAMING_LOAD_RADIUS = 2;
+
 	std::unique_ptr<ZeldaGame> ZeldaGame::make(Application& app, TextureManager& textureManager, const std::string& fileName, const sf::Transform& pixelToWorld)
 	{
 		return std::unique_ptr<ZeldaGame>(new ZeldaGame(app, textureManager, fileName, pixelToWorld));
@@ -19,6 +23,8 @@ namespace te
 		, mTextureManager(textureManager)
 		, mPlayerID(-1)
 		, mpCamera(nullptr)
+		, mpLoader(nullptr)
+		, mpPreloader(nullptr)
 	{
 		mTextureManager.loadSpritesheet("textures/inigo_spritesheet.xml");
 		mTextureManager.loadAnimations("textures/inigo_animation.xml");
@@ -27,13 +33,58 @@ namespace te
 
 	void ZeldaGame::loadMap(const std::string& fileName)
 	{
-		TMX tmx(fileName);
-		setTileMap(std::make_unique<TileMap>(*this, mTextureManager, tmx));
+		if (mpPreloader && mpPreloader->getFilename() == fileName)
+		{
+			mpLoader = std::move(mpPreloader);
+		}
+		else
+		{
+			mpLoader = MapLoader::make(fileName, STREAMING_THRESHOLD, getPixelToWorldTransform());
+		}
+	}
+
+	void ZeldaGame::preloadMap(const std::string& fileName)
+	{
+		if (!mpPreloader || mpPreloader->getFilename() != fileName)
+		{
+			mpPreloader = MapLoader::make(fileName, STREAMING_THRESHOLD, getPixelToWorldTransform());
+		}
+	}
+
+	bool ZeldaGame::isLoading() const
+	{
+		return mpLoader != nullptr;
+	}
+
+	float ZeldaGame::getLoadingProgress() const
+	{
+		return mpLoader ? mpLoader->getProgress() : 1.f;
+	}
+
+	void ZeldaGame::finishLoading()
+	{
+		std::unique_ptr<MapLoader> pLoader = std::move(mpLoader);
+		MapLoader::Map map = pLoader->finish(mTextureManager);
+		std::shared_ptr<TMX> pTMX = map.pTMX;
+
+		if (getEntityManager().hasEntity(mPlayerID))
+		{
+			getSceneGraph().detachNode(getEntityManager().getEntityFromID(mPlayerID));
+		}
+
+		if (map.pBuild)
+		{
+			setTileMap(std::make_unique<TileMap>(*this, mTextureManager, pTMX, std::move(map.pBuild)));
+		}
+		else
+		{
+			setTileMap(std::make_unique<TileMap>(*this, mTextureManager, pTMX, STREAMING_CHUNK_SIZE, STREAMING_LOAD_RADIUS));
+		}
 		getMap().setDrawColliderEnabled(true);
 		getMap().setDrawNavGraphEnabled(true);
 
 		TMX::Object* pPlayer = nullptr;
-		std::vector<TMX::ObjectGroup> objectGroups = tmx.getObjectGroups();
+		std::vector<TMX::ObjectGroup> objectGroups = pTMX->getObjectGroups();
 		for (auto& objectGroup : objectGroups)
 		{
 			for (auto& object : objectGroup.objects)
@@ -49,6 +100,7 @@ namespace te
 
 		auto upPlayer = Player::make(*this, *pPlayer);
 		mPlayerID = upPlayer->getID();
+		getMap().setStreamingFocus(upPlayer->getPosition(), true);
 		getSceneGraph().attachNode(std::move(upPlayer));
 
 		mpCamera = std::make_unique<Camera>(getEntityManager(), mPlayerID, sf::Vector2f(16 * 24.f, 9 * 24.f));
@@ -56,6 +108,8 @@ namespace te
 
 	void ZeldaGame::processInput(const sf::Event& evt)
 	{
+		if (isLoading()) return;
+
 		if (!sf::Joystick::isConnected(0))
 		{
 			bool w = sf::Keyboard::isKeyPressed(sf::Keyboard::W);
@@ -78,6 +132,18 @@ namespace te
 		}
 	}
 
+	void ZeldaGame::update(const sf::Time& dt)
+	{
+		if (mpLoader)
+		{
+			if (!mpLoader->isReady()) return;
+			finishLoading();
+		}
+
+		getMap().setStreamingFocus(getEntityManager().getEntityFromID(mPlayerID).getPosition());
+		Game::update(dt);
+	}
+
 	void ZeldaGame::draw(sf::RenderTarget& target, sf::RenderStates states) const
 	{
 		states.transform.scale(0.5f, 0.5f) *= getWorldToPixelTransform();
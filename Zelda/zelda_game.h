@@ -3,6 +3,7 @@
 
 #include "game.h"
 #include "player.h"
+#include "map_loader.h"
 
 namespace te
 {
@@ -17,17 +18,36 @@ namespace te
 		static std::unique_ptr<ZeldaGame> make(Application& app, TextureManager& textureManager, const std::string& fileName, const sf::Transform& pixelToWorldTransform);
 
 		void processInput(const sf::Event& evt);
+		void update(const sf::Time& dt);
+
+		bool isLoading() const;
+		float getLoadingProgress() const;
+
+		// Starts loading a map in the background. Until it is ready the game
+		// shows the loading screen and the current map is neither updated nor
+		// drawn.
+		void loadMap(const std::string& fileName);
+		// Starts loading a map that loadMap is expected to ask for next
+		void preloadMap(const std::string& fileName);
 
 	private:
 		ZeldaGame(Application& app, TextureManager& textureManager, const std::string& fileName, const sf::Transform& pixelToWorld);
 
 		void draw(sf::RenderTarget& target, sf::RenderStates states) const;
-		void loadMap(const std::string& fileName);
+		void finishLoading();
+
+		// Maps with more tiles than this are streamed in chunks around the player
+		static const int STREAMING_THRESHOLD;
+		static const int STREAMING_CHUNK_SIZE;
+		static const int STREAMING_LOAD_RADIUS;
 
 		TextureManager& mTextureManager;
 
 		int mPlayerID;
 		std::unique_ptr<Camera> mpCamera;
+
+		std::unique_ptr<MapLoader> mpLoader;
+		std::unique_ptr<MapLoader> mpPreloader;
 	};
 }
 